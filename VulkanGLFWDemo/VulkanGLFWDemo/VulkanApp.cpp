@@ -296,25 +296,6 @@ VkSurfaceFormatKHR VulkanGLFWApp::chooseSwapSurfaceFormat(const std::vector<VkSu
 	return availableFormats[0];
 }
 
-VkPresentModeKHR VulkanGLFWApp::chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes)
-{
-	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-
-	for (const auto& availablePresentMode : availablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return availablePresentMode;
-		}
-		else if (availablePresentMode == VK_PRESENT_MODE_FIFO_KHR) {
-			break;
-		}
-		else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-			bestMode = availablePresentMode;
-		}
-	}
-
-	return bestMode;
-}
-
 VkExtent2D VulkanGLFWApp::chooseSwapExtent(const VkSurfaceCapabilitiesKHR & capabilities)
 {
 	if (capabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
@@ -337,14 +318,11 @@ void VulkanGLFWApp::createSwapChain()
 	SwapChainSupportDetails swapChainSupport = querySwapChainSupport(m_PhysicalDevice);
 
 	VkSurfaceFormatKHR surfaceFormat = chooseSwapSurfaceFormat(swapChainSupport.formats);
-	VkPresentModeKHR presentMode = chooseSwapPresentMode(swapChainSupport.presentModes);
+	VkPresentModeKHR presentMode = m_PresentPacer.ChoosePresentMode(swapChainSupport.presentModes);
 	VkExtent2D extent = chooseSwapExtent(swapChainSupport.capabilities);
 
 
-	uint32_t imageCount = swapChainSupport.capabilities.minImageCount + 1;
-	if (swapChainSupport.capabilities.maxImageCount > 0 && imageCount > swapChainSupport.capabilities.maxImageCount) {
-		imageCount = swapChainSupport.capabilities.maxImageCount;
-	}
+	uint32_t imageCount = m_PresentPacer.ChooseImageCount(swapChainSupport.capabilities, presentMode);
 
 	VkSwapchainCreateInfoKHR createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -375,7 +353,8 @@ void VulkanGLFWApp::createSwapChain()
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	// Lets the driver hand resources over from the previous swap chain, which gets retired
+	createInfo.oldSwapchain = m_SwapChain;
 
 	if (vkCreateSwapchainKHR(m_Device, &createInfo, nullptr, &m_SwapChain) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
@@ -386,6 +365,15 @@ void VulkanGLFWApp::createSwapChain()
 	vkGetSwapchainImagesKHR(m_Device, m_SwapChain, &imageCount, m_SwapChainImages.data());
 	m_SwapChainImageFormat = surfaceFormat.format;
 	m_SwapChainExtent = extent;
+
+	m_PresentPacer.OnSwapChainCreated(presentMode);
+
+	// A windowed surface has no monitor of its own, the primary one is the best guess for its refresh
+	GLFWmonitor* monitor = glfwGetWindowMonitor(m_Window);
+	const GLFWvidmode* videoMode = glfwGetVideoMode(monitor ? monitor : glfwGetPrimaryMonitor());
+	if (videoMode && videoMode->refreshRate > 0) {
+		m_PresentPacer.SetRefreshPeriod(1000000000ull / static_cast<uint64_t>(videoMode->refreshRate));
+	}
 }
 
 void VulkanGLFWApp::createImageViews()
@@ -510,6 +498,7 @@ void VulkanGLFWApp::createGraphicsPipeline()
 	scissor.offset = { 0, 0 };
 	scissor.extent = m_SwapChainExtent;
 
+	// Viewport and scissor are dynamic, so the pipeline survives swap chain resizes
 	VkPipelineViewportStateCreateInfo viewportState = {};
 	viewportState.sType = VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO;
 	viewportState.viewportCount = 1;
@@ -565,15 +554,15 @@ void VulkanGLFWApp::createGraphicsPipeline()
 	colorBlending.blendConstants[2] = 0.0f; // Optional
 	colorBlending.blendConstants[3] = 0.0f; // Optional
 
-	//VkDynamicState dynamicStates[] = {
-	//	VK_DYNAMIC_STATE_VIEWPORT,
-	//	VK_DYNAMIC_STATE_LINE_WIDTH
-	//};
+	VkDynamicState dynamicStates[] = {
+		VK_DYNAMIC_STATE_VIEWPORT,
+		VK_DYNAMIC_STATE_SCISSOR
+	};
 
-	//VkPipelineDynamicStateCreateInfo dynamicState = {};
-	//dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
-	//dynamicState.dynamicStateCount = 2;
-	//dynamicState.pDynamicStates = dynamicStates;
+	VkPipelineDynamicStateCreateInfo dynamicState = {};
+	dynamicState.sType = VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO;
+	dynamicState.dynamicStateCount = 2;
+	dynamicState.pDynamicStates = dynamicStates;
 
 	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
 	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
@@ -598,7 +587,7 @@ void VulkanGLFWApp::createGraphicsPipeline()
 	pipelineInfo.pMultisampleState = &multisampling;
 	pipelineInfo.pDepthStencilState = nullptr; // Optional
 	pipelineInfo.pColorBlendState = &colorBlending;
-	pipelineInfo.pDynamicState = nullptr; // Optional
+	pipelineInfo.pDynamicState = &dynamicState;
 	pipelineInfo.layout = m_PipelineLayout;
 	pipelineInfo.renderPass = m_RenderPass;
 	pipelineInfo.subpass = 0;
@@ -662,7 +651,7 @@ void VulkanGLFWApp::createCommandPool()
 	VkCommandPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO;
 	poolInfo.queueFamilyIndex = queueFamilyIndices.GraphicsFamilyIndex;
-	poolInfo.flags = 0; // Optional
+	poolInfo.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT; // Frame command buffers are re-recorded every frame
 
 	if (vkCreateCommandPool(m_Device, &poolInfo, nullptr, &m_CommandPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create command pool!");
@@ -672,105 +661,161 @@ void VulkanGLFWApp::createCommandPool()
 
 void VulkanGLFWApp::createCommandBuffers()
 {
-	m_CommandBuffers.resize(m_SwapChainImages.size());
+	m_Frames.resize(m_FramesInFlight);
+
+	std::vector<VkCommandBuffer> commandBuffers(m_Frames.size());
 
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = m_CommandPool;
 	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandBufferCount = (uint32_t)m_CommandBuffers.size();
+	allocInfo.commandBufferCount = (uint32_t)commandBuffers.size();
 
-	if (vkAllocateCommandBuffers(m_Device, &allocInfo, m_CommandBuffers.data()) != VK_SUCCESS) {
+	if (vkAllocateCommandBuffers(m_Device, &allocInfo, commandBuffers.data()) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate command buffers!");
 	}
 
+	for (size_t i = 0; i < m_Frames.size(); i++) {
+		m_Frames[i].commandBuffer = commandBuffers[i];
+	}
+
 }
 
-void VulkanGLFWApp::bindCommandBuffers()
+void VulkanGLFWApp::recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex)
 {
-	for (size_t i = 0; i < m_CommandBuffers.size(); i++) {
-		VkCommandBufferBeginInfo beginInfo = {};
-		beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-		beginInfo.flags = VK_COMMAND_BUFFER_USAGE_SIMULTANEOUS_USE_BIT;
-		beginInfo.pInheritanceInfo = nullptr; // Optional
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.pInheritanceInfo = nullptr; // Optional
 
-		vkBeginCommandBuffer(m_CommandBuffers[i], &beginInfo);
+	vkBeginCommandBuffer(commandBuffer, &beginInfo);
 
-		VkRenderPassBeginInfo renderPassInfo = {};
-		renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
-		renderPassInfo.renderPass = m_RenderPass;
-		renderPassInfo.framebuffer = m_SwapChainFramebuffers[i];
-		renderPassInfo.renderArea.offset = { 0, 0 };
-		renderPassInfo.renderArea.extent = m_SwapChainExtent;
+	VkRenderPassBeginInfo renderPassInfo = {};
+	renderPassInfo.sType = VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO;
+	renderPassInfo.renderPass = m_RenderPass;
+	renderPassInfo.framebuffer = m_SwapChainFramebuffers[imageIndex];
+	renderPassInfo.renderArea.offset = { 0, 0 };
+	renderPassInfo.renderArea.extent = m_SwapChainExtent;
 
-		VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
-		renderPassInfo.clearValueCount = 1;
-		renderPassInfo.pClearValues = &clearColor;
+	VkClearValue clearColor = { 0.0f, 0.0f, 0.0f, 1.0f };
+	renderPassInfo.clearValueCount = 1;
+	renderPassInfo.pClearValues = &clearColor;
 
-		vkCmdBeginRenderPass(m_CommandBuffers[i], &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
-		vkCmdBindPipeline(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
+	vkCmdBeginRenderPass(commandBuffer, &renderPassInfo, VK_SUBPASS_CONTENTS_INLINE);
+	vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipeline);
 
-		VkBuffer vertexBuffers[] = { m_VertexBuffer };
-		VkDeviceSize offsets[] = { 0 };
+	VkViewport viewport = {};
+	viewport.width = (float)m_SwapChainExtent.width;
+	viewport.height = (float)m_SwapChainExtent.height;
+	viewport.minDepth = 0.0f;
+	viewport.maxDepth = 1.0f;
+	vkCmdSetViewport(commandBuffer, 0, 1, &viewport);
 
-		vkCmdBindVertexBuffers(m_CommandBuffers[i], 0, 1, vertexBuffers, offsets);
-		vkCmdBindIndexBuffer(m_CommandBuffers[i], m_IndexBuffer, 0, VK_INDEX_TYPE_UINT16);
+	VkRect2D scissor = {};
+	scissor.extent = m_SwapChainExtent;
+	vkCmdSetScissor(commandBuffer, 0, 1, &scissor);
 
-		vkCmdBindDescriptorSets(m_CommandBuffers[i], VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+	VkBuffer vertexBuffers[] = { m_VertexBuffer };
+	VkDeviceSize offsets[] = { 0 };
 
+	vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+	vkCmdBindIndexBuffer(commandBuffer, m_IndexBuffer, 0, VK_INDEX_TYPE_UINT16);
 
-		vkCmdDrawIndexed(m_CommandBuffers[i], static_cast<uint32_t>(m_Indices.size()), 1, 0, 0, 0);
-		//vkCmdDraw(m_CommandBuffers[i], static_cast<uint32_t>(m_Vertices.size()), 1, 0, 0);
-		vkCmdEndRenderPass(m_CommandBuffers[i]);
-		if (vkEndCommandBuffer(m_CommandBuffers[i]) != VK_SUCCESS) {
-			throw std::runtime_error("failed to record command buffer!");
-		}
+	vkCmdBindDescriptorSets(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, m_PipelineLayout, 0, 1, &m_Frames[m_CurrentFrame].descriptorSet, 0, nullptr);
+
+
+	vkCmdDrawIndexed(commandBuffer, static_cast<uint32_t>(m_Indices.size()), 1, 0, 0, 0);
+	//vkCmdDraw(commandBuffer, static_cast<uint32_t>(m_Vertices.size()), 1, 0, 0);
+	vkCmdEndRenderPass(commandBuffer);
+	if (vkEndCommandBuffer(commandBuffer) != VK_SUCCESS) {
+		throw std::runtime_error("failed to record command buffer!");
 	}
 }
 
-void VulkanGLFWApp::createSemaphores()
+void VulkanGLFWApp::createSyncObjects()
 {
+	m_ImagesInFlight.resize(m_SwapChainImages.size(), VK_NULL_HANDLE);
+
 	VkSemaphoreCreateInfo semaphoreInfo = {};
 	semaphoreInfo.sType = VK_STRUCTURE_TYPE_SEMAPHORE_CREATE_INFO;
-	if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_ImageAvailableSemaphore) != VK_SUCCESS ||
-		vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_RenderFinishedSemaphore) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create semaphores!");
+
+	// Created signaled so the first wait of every frame slot returns immediately
+	VkFenceCreateInfo fenceInfo = {};
+	fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+	fenceInfo.flags = VK_FENCE_CREATE_SIGNALED_BIT;
+
+	for (size_t i = 0; i < m_Frames.size(); i++) {
+		if (vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Frames[i].imageAvailableSemaphore) != VK_SUCCESS ||
+			vkCreateSemaphore(m_Device, &semaphoreInfo, nullptr, &m_Frames[i].renderFinishedSemaphore) != VK_SUCCESS ||
+			vkCreateFence(m_Device, &fenceInfo, nullptr, &m_Frames[i].inFlightFence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create synchronization objects for a frame!");
+		}
 	}
 }
 
 void VulkanGLFWApp::drawFrame()
 {
+	FrameData& frame = m_Frames[m_CurrentFrame];
+
+	// Only block when the GPU is still working on the frame that used this slot m_FramesInFlight frames ago
+	vkWaitForFences(m_Device, 1, &frame.inFlightFence, VK_TRUE, std::numeric_limits<uint64_t>::max());
 
-	//vkQueueWaitIdle(m_PresentQueue);
+	// Frames complete in submission order on the graphics queue
+	m_CompletedFrames = std::max(m_CompletedFrames, frame.submittedFrame);
+	releaseRetiredSwapChains(false);
+
+	// All resize events since the last frame end up in a single recreation
+	if (m_bSwapChainDirty) {
+		recreateSwapChain();
+		if (m_bSwapChainDirty) return;
+	}
+
+	// Runtime uploads recorded since the last frame go out ahead of it
+	flushUploads();
+	retireUploads();
 
 	uint32_t imageIndex;
 
-	VkResult result = vkAcquireNextImageKHR(m_Device, m_SwapChain, std::numeric_limits<uint64_t>::max(), m_ImageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
+	VkResult result = vkAcquireNextImageKHR(m_Device, m_SwapChain, std::numeric_limits<uint64_t>::max(), frame.imageAvailableSemaphore, VK_NULL_HANDLE, &imageIndex);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR) {
-		recreateSwapChain();
+		m_bSwapChainDirty = true;
 		return;
 	}
 	else if (result != VK_SUCCESS && result != VK_SUBOPTIMAL_KHR) {
 		throw std::runtime_error("failed to acquire swap chain image!");
 	}
 
+	// The swap chain may hand out images out of order, wait for the frame still rendering to this one
+	if (m_ImagesInFlight[imageIndex] != VK_NULL_HANDLE) {
+		vkWaitForFences(m_Device, 1, &m_ImagesInFlight[imageIndex], VK_TRUE, std::numeric_limits<uint64_t>::max());
+	}
+	m_ImagesInFlight[imageIndex] = frame.inFlightFence;
+
+	updateUniformBuffer(m_CurrentFrame);
+
+	vkResetCommandBuffer(frame.commandBuffer, 0);
+	recordCommandBuffer(frame.commandBuffer, imageIndex);
+
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 
-	VkSemaphore waitSemaphores[] = { m_ImageAvailableSemaphore };
+	VkSemaphore waitSemaphores[] = { frame.imageAvailableSemaphore };
 	VkPipelineStageFlags waitStages[] = { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT };
 	submitInfo.waitSemaphoreCount = 1;
 	submitInfo.pWaitSemaphores = waitSemaphores;
 	submitInfo.pWaitDstStageMask = waitStages;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &m_CommandBuffers[imageIndex];
-	VkSemaphore signalSemaphores[] = { m_RenderFinishedSemaphore };
+	submitInfo.pCommandBuffers = &frame.commandBuffer;
+	VkSemaphore signalSemaphores[] = { frame.renderFinishedSemaphore };
 	submitInfo.signalSemaphoreCount = 1;
 	submitInfo.pSignalSemaphores = signalSemaphores;
 
-	if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE) != VK_SUCCESS) {
+	vkResetFences(m_Device, 1, &frame.inFlightFence);
+
+	if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, frame.inFlightFence) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
+	frame.submittedFrame = ++m_SubmittedFrames;
 
 	VkPresentInfoKHR presentInfo = {};
 	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
@@ -783,27 +828,49 @@ void VulkanGLFWApp::drawFrame()
 	presentInfo.pImageIndices = &imageIndex;
 	presentInfo.pResults = nullptr; // Optional
 
+	m_CurrentFrame = (m_CurrentFrame + 1) % m_FramesInFlight;
+
 	result = vkQueuePresentKHR(m_PresentQueue, &presentInfo);
 	if (result == VK_ERROR_OUT_OF_DATE_KHR || result == VK_SUBOPTIMAL_KHR) {
-		recreateSwapChain();
+		m_bSwapChainDirty = true;
 	}
 	else if (result != VK_SUCCESS) {
 		throw std::runtime_error("failed to present swap chain image!");
 	}
+	else if (m_PresentPacer.TrackPresent()) {
+		// Only VSync falls back to another mode
+		std::cout << "missed vblanks, presenting with FIFO_RELAXED" << std::endl;
+		m_bSwapChainDirty = true;
+	}
 
-	vkQueueWaitIdle(m_PresentQueue);
+	updateFrameRate();
+}
+
+void VulkanGLFWApp::updateFrameRate()
+{
+	if (!m_bShowFrameRate) return;
+
+	m_FpsFrameCount++;
+
+	auto currentTime = std::chrono::steady_clock::now();
+	float elapsed = std::chrono::duration<float>(currentTime - m_FpsStartTime).count();
+	if (elapsed >= 1.0f) {
+		// The window belongs to this thread, the title can be set between frames
+		char title[128];
+		snprintf(title, sizeof(title), "FramePresenterVulkan - %.1f fps (%u frames in flight)", m_FpsFrameCount / elapsed, m_FramesInFlight);
+		glfwSetWindowTitle(m_Window, title);
+		m_FpsStartTime = currentTime;
+		m_FpsFrameCount = 0;
+	}
 }
 
 void VulkanGLFWApp::cleanupSwapChain()
 {
+	releaseRetiredSwapChains(true);
+
 	for (size_t i = 0; i < m_SwapChainFramebuffers.size(); i++) {
 		vkDestroyFramebuffer(m_Device, m_SwapChainFramebuffers[i], nullptr);
 	}
-	vkFreeCommandBuffers(m_Device, m_CommandPool, static_cast<uint32_t>(m_CommandBuffers.size()), m_CommandBuffers.data());
-
-	vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
-	vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
-	vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
 	for (size_t i = 0; i < m_SwapChainImageViews.size(); i++) {
 		vkDestroyImageView(m_Device, m_SwapChainImageViews[i], nullptr);
 	}
@@ -812,17 +879,57 @@ void VulkanGLFWApp::cleanupSwapChain()
 
 void VulkanGLFWApp::recreateSwapChain()
 {
-	vkDeviceWaitIdle(m_Device);
+	// Minimized, try again once the window has a size
+	int width = 0, height = 0;
+	glfwGetFramebufferSize(m_Window, &width, &height);
+	if (width == 0 || height == 0) return;
+
+	m_bSwapChainDirty = false;
+
+	// No device idle: the old swap chain and the objects built on its images are released
+	// once the frames submitted so far have completed
+	RetiredSwapChain retired;
+	retired.lastFrame = m_SubmittedFrames;
+	retired.swapChain = m_SwapChain;
+	retired.imageViews.swap(m_SwapChainImageViews);
+	retired.framebuffers.swap(m_SwapChainFramebuffers);
+	m_RetiredSwapChains.push_back(std::move(retired));
+
+	VkFormat oldFormat = m_SwapChainImageFormat;
+	createSwapChain();
 
-	cleanupSwapChain();
-	createCommandBuffers();
+	if (m_SwapChainImageFormat != oldFormat) {
+		// Only the render pass and pipeline depend on the format, hardly ever happens
+		vkDeviceWaitIdle(m_Device);
+		vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+		vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
+		createRenderPass();
+		createGraphicsPipeline();
+	}
 
-	createSwapChain();
 	createImageViews();
-	createRenderPass();
-	createGraphicsPipeline();
 	createFramebuffers();
-	
+
+	m_ImagesInFlight.assign(m_SwapChainImages.size(), VK_NULL_HANDLE);
+}
+
+void VulkanGLFWApp::releaseRetiredSwapChains(bool bAll)
+{
+	while (!m_RetiredSwapChains.empty()) {
+		RetiredSwapChain& retired = m_RetiredSwapChains.front();
+		if (!bAll && retired.lastFrame > m_CompletedFrames) break;
+
+		for (size_t i = 0; i < retired.framebuffers.size(); i++) {
+			vkDestroyFramebuffer(m_Device, retired.framebuffers[i], nullptr);
+		}
+		for (size_t i = 0; i < retired.imageViews.size(); i++) {
+			vkDestroyImageView(m_Device, retired.imageViews[i], nullptr);
+		}
+		vkDestroySwapchainKHR(m_Device, retired.swapChain, nullptr);
+
+		m_RetiredSwapChains.pop_front();
+	}
 }
 
 void VulkanGLFWApp::createVertexBuffer()
@@ -852,10 +959,8 @@ void VulkanGLFWApp::createVertexBuffer()
 
 	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_VERTEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_VertexBuffer, m_VertexBufferMemory);
 
-	copyBuffer(stagingBuffer, m_VertexBuffer, bufferSize);
-
-	vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-	vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+	copyBuffer(beginUpload(), stagingBuffer, m_VertexBuffer, bufferSize);
+	releaseAfterUpload(stagingBuffer, stagingBufferMemory);
 }
 
 void VulkanGLFWApp::createIndexBuffer()
@@ -873,16 +978,19 @@ void VulkanGLFWApp::createIndexBuffer()
 
 	createBuffer(bufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_IndexBuffer, m_IndexBufferMemory);
 
-	copyBuffer(stagingBuffer, m_IndexBuffer, bufferSize);
-
-	vkDestroyBuffer(m_Device, stagingBuffer, nullptr);
-	vkFreeMemory(m_Device, stagingBufferMemory, nullptr);
+	copyBuffer(beginUpload(), stagingBuffer, m_IndexBuffer, bufferSize);
+	releaseAfterUpload(stagingBuffer, stagingBufferMemory);
 }
 
-void VulkanGLFWApp::createUniformBuffer()
+void VulkanGLFWApp::createUniformBuffers()
 {
 	VkDeviceSize bufferSize = sizeof(UniformBufferObject);
-	createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_UniformBuffer, m_UniformBufferMemory);
+	for (size_t i = 0; i < m_Frames.size(); i++) {
+		createBuffer(bufferSize, VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Frames[i].uniformBuffer, m_Frames[i].uniformBufferMemory);
+
+		// Stays mapped, each frame writes its own buffer while the GPU may still read the others
+		vkMapMemory(m_Device, m_Frames[i].uniformBufferMemory, 0, bufferSize, 0, &m_Frames[i].uniformBufferMapped);
+	}
 }
 
 uint32_t VulkanGLFWApp::findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties)
@@ -927,17 +1035,13 @@ void VulkanGLFWApp::createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, Vk
 	vkBindBufferMemory(m_Device, buffer, bufferMemory, 0);
 }
 
-void VulkanGLFWApp::copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void VulkanGLFWApp::copyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
 {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
 	VkBufferCopy copyRegion = {};
 	copyRegion.size = size;
 	vkCmdCopyBuffer(commandBuffer, srcBuffer, dstBuffer, 1, &copyRegion);
-
-	endSingleTimeCommands(commandBuffer);
 }
-void VulkanGLFWApp::updateUniformBuffer()
+void VulkanGLFWApp::updateUniformBuffer(uint32_t frameIndex)
 {
 	/*static auto startTime = std::chrono::high_resolution_clock::now();
 	auto currentTime = std::chrono::high_resolution_clock::now();
@@ -955,47 +1059,145 @@ void VulkanGLFWApp::updateUniformBuffer()
 	ubo.proj = glm::perspective(glm::radians(45.0f), m_SwapChainExtent.width / (float)m_SwapChainExtent.height, 0.1f, 10.0f);
 	ubo.proj[1][1] *= -1;
 
-	void* data;
-	vkMapMemory(m_Device, m_UniformBufferMemory, 0, sizeof(ubo), 0, &data);
-	memcpy(data, &ubo, sizeof(ubo));
-	vkUnmapMemory(m_Device, m_UniformBufferMemory);
+	memcpy(m_Frames[frameIndex].uniformBufferMapped, &ubo, sizeof(ubo));
 
 }
 
-VkCommandBuffer VulkanGLFWApp::beginSingleTimeCommands()
+VkCommandBuffer VulkanGLFWApp::beginUpload()
 {
-	VkCommandBufferAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
-	allocInfo.commandPool = m_CommandPool;
-	allocInfo.commandBufferCount = 1;
+	if (m_bUploadRecording) {
+		return m_CurrentUpload.commandBuffer;
+	}
 
-	VkCommandBuffer commandBuffer;
-	vkAllocateCommandBuffers(m_Device, &allocInfo, &commandBuffer);
+	retireUploads();
+
+	if (!m_FreeUploads.empty()) {
+		m_CurrentUpload = std::move(m_FreeUploads.back());
+		m_FreeUploads.pop_back();
+	}
+	else {
+		VkCommandBufferAllocateInfo allocInfo = {};
+		allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
+		allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+		allocInfo.commandPool = m_CommandPool;
+		allocInfo.commandBufferCount = 1;
+
+		if (vkAllocateCommandBuffers(m_Device, &allocInfo, &m_CurrentUpload.commandBuffer) != VK_SUCCESS) {
+			throw std::runtime_error("failed to allocate upload command buffer!");
+		}
+
+		VkFenceCreateInfo fenceInfo = {};
+		fenceInfo.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
+
+		if (vkCreateFence(m_Device, &fenceInfo, nullptr, &m_CurrentUpload.fence) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create upload fence!");
+		}
+	}
 
-	
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
 	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
 
-	vkBeginCommandBuffer(commandBuffer, &beginInfo);
+	vkBeginCommandBuffer(m_CurrentUpload.commandBuffer, &beginInfo);
+	m_bUploadRecording = true;
 
-	return commandBuffer;
+	return m_CurrentUpload.commandBuffer;
 }
 
-void VulkanGLFWApp::endSingleTimeCommands(VkCommandBuffer commandBuffer)
+void VulkanGLFWApp::releaseAfterUpload(VkBuffer stagingBuffer, VkDeviceMemory stagingBufferMemory)
 {
-	vkEndCommandBuffer(commandBuffer);
+	m_CurrentUpload.stagingBuffers.push_back(stagingBuffer);
+	m_CurrentUpload.stagingBufferMemories.push_back(stagingBufferMemory);
+}
+
+uint64_t VulkanGLFWApp::flushUploads()
+{
+	if (!m_bUploadRecording) {
+		return m_LastSubmittedUpload;
+	}
+
+	// Later submissions on the queue see the uploaded data without waiting on the fence
+	VkMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_MEMORY_BARRIER;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(
+		m_CurrentUpload.commandBuffer,
+		VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_VERTEX_INPUT_BIT | VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0,
+		1, &barrier,
+		0, nullptr,
+		0, nullptr
+	);
+
+	vkEndCommandBuffer(m_CurrentUpload.commandBuffer);
+	vkResetFences(m_Device, 1, &m_CurrentUpload.fence);
 
 	VkSubmitInfo submitInfo = {};
 	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
 	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = &commandBuffer;
+	submitInfo.pCommandBuffers = &m_CurrentUpload.commandBuffer;
+
+	if (vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, m_CurrentUpload.fence) != VK_SUCCESS) {
+		throw std::runtime_error("failed to submit upload command buffer!");
+	}
 
-	vkQueueSubmit(m_GraphicsQueue, 1, &submitInfo, VK_NULL_HANDLE);
-	vkQueueWaitIdle(m_GraphicsQueue);
+	m_CurrentUpload.token = ++m_LastSubmittedUpload;
+	m_PendingUploads.push_back(std::move(m_CurrentUpload));
+	m_CurrentUpload = UploadBatch();
+	m_bUploadRecording = false;
 
-	vkFreeCommandBuffers(m_Device, m_CommandPool, 1, &commandBuffer);
+	return m_LastSubmittedUpload;
+}
+
+bool VulkanGLFWApp::isUploadComplete(uint64_t token)
+{
+	retireUploads();
+	return token <= m_LastCompletedUpload;
+}
+
+void VulkanGLFWApp::waitForUpload(uint64_t token)
+{
+	// Tokens are handed out in submission order, so waiting on the matching batch covers all earlier ones
+	for (size_t i = 0; i < m_PendingUploads.size(); i++) {
+		if (m_PendingUploads[i].token >= token) {
+			vkWaitForFences(m_Device, 1, &m_PendingUploads[i].fence, VK_TRUE, std::numeric_limits<uint64_t>::max());
+			break;
+		}
+	}
+	retireUploads();
+}
+
+void VulkanGLFWApp::retireUploads()
+{
+	while (!m_PendingUploads.empty()) {
+		UploadBatch& batch = m_PendingUploads.front();
+		if (vkGetFenceStatus(m_Device, batch.fence) != VK_SUCCESS) break;
+
+		for (size_t i = 0; i < batch.stagingBuffers.size(); i++) {
+			vkDestroyBuffer(m_Device, batch.stagingBuffers[i], nullptr);
+			vkFreeMemory(m_Device, batch.stagingBufferMemories[i], nullptr);
+		}
+		batch.stagingBuffers.clear();
+		batch.stagingBufferMemories.clear();
+		m_LastCompletedUpload = batch.token;
+
+		m_FreeUploads.push_back(std::move(batch));
+		m_PendingUploads.pop_front();
+	}
+}
+
+void VulkanGLFWApp::destroyUploads()
+{
+	flushUploads();
+	waitForUpload(m_LastSubmittedUpload);
+
+	// Command buffers go away with the pool
+	for (size_t i = 0; i < m_FreeUploads.size(); i++) {
+		vkDestroyFence(m_Device, m_FreeUploads[i].fence, nullptr);
+	}
+	m_FreeUploads.clear();
 }
 
 void VulkanGLFWApp::createDescriptorSetLayout()
@@ -1029,15 +1231,15 @@ void VulkanGLFWApp::createDescriptorPool()
 {
 	std::array<VkDescriptorPoolSize, 2> poolSizes = {};
 	poolSizes[0].type = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	poolSizes[0].descriptorCount = 1;
+	poolSizes[0].descriptorCount = m_FramesInFlight;
 	poolSizes[1].type = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	poolSizes[1].descriptorCount = 1;
+	poolSizes[1].descriptorCount = m_FramesInFlight;
 
 	VkDescriptorPoolCreateInfo poolInfo = {};
 	poolInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO;
 	poolInfo.poolSizeCount = static_cast<uint32_t>(poolSizes.size());
 	poolInfo.pPoolSizes = poolSizes.data();
-	poolInfo.maxSets = 1;
+	poolInfo.maxSets = m_FramesInFlight;
 
 	if (vkCreateDescriptorPool(m_Device, &poolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create descriptor pool!");
@@ -1045,48 +1247,53 @@ void VulkanGLFWApp::createDescriptorPool()
 
 }
 
-void VulkanGLFWApp::createDescriptorSet()
+void VulkanGLFWApp::createDescriptorSets()
 {
-	VkDescriptorSetLayout layouts[] = { m_DescriptorSetLayout };
+	std::vector<VkDescriptorSetLayout> layouts(m_Frames.size(), m_DescriptorSetLayout);
 	VkDescriptorSetAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO;
 	allocInfo.descriptorPool = m_DescriptorPool;
-	allocInfo.descriptorSetCount = 1;
-	allocInfo.pSetLayouts = layouts;
+	allocInfo.descriptorSetCount = static_cast<uint32_t>(layouts.size());
+	allocInfo.pSetLayouts = layouts.data();
 
-	if (vkAllocateDescriptorSets(m_Device, &allocInfo, &m_DescriptorSet) != VK_SUCCESS) {
+	std::vector<VkDescriptorSet> descriptorSets(layouts.size());
+	if (vkAllocateDescriptorSets(m_Device, &allocInfo, descriptorSets.data()) != VK_SUCCESS) {
 		throw std::runtime_error("failed to allocate descriptor set!");
 	}
 
-	VkDescriptorBufferInfo bufferInfo = {};
-	bufferInfo.buffer = m_UniformBuffer;
-	bufferInfo.offset = 0;
-	bufferInfo.range = sizeof(UniformBufferObject);
+	for (size_t i = 0; i < m_Frames.size(); i++) {
+		m_Frames[i].descriptorSet = descriptorSets[i];
+
+		VkDescriptorBufferInfo bufferInfo = {};
+		bufferInfo.buffer = m_Frames[i].uniformBuffer;
+		bufferInfo.offset = 0;
+		bufferInfo.range = sizeof(UniformBufferObject);
 
-	VkDescriptorImageInfo imageInfo = {};
-	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-	imageInfo.imageView = m_TextureImageView;
-	imageInfo.sampler = m_TextureSampler;
+		VkDescriptorImageInfo imageInfo = {};
+		imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		imageInfo.imageView = m_TextureImageView;
+		imageInfo.sampler = m_TextureSampler;
 
-	std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
+		std::array<VkWriteDescriptorSet, 2> descriptorWrites = {};
 
-	descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[0].dstSet =m_DescriptorSet;
-	descriptorWrites[0].dstBinding = 0;
-	descriptorWrites[0].dstArrayElement = 0;
-	descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
-	descriptorWrites[0].descriptorCount = 1;
-	descriptorWrites[0].pBufferInfo = &bufferInfo;
+		descriptorWrites[0].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[0].dstSet = m_Frames[i].descriptorSet;
+		descriptorWrites[0].dstBinding = 0;
+		descriptorWrites[0].dstArrayElement = 0;
+		descriptorWrites[0].descriptorType = VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER;
+		descriptorWrites[0].descriptorCount = 1;
+		descriptorWrites[0].pBufferInfo = &bufferInfo;
 
-	descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
-	descriptorWrites[1].dstSet = m_DescriptorSet;
-	descriptorWrites[1].dstBinding = 1;
-	descriptorWrites[1].dstArrayElement = 0;
-	descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
-	descriptorWrites[1].descriptorCount = 1;
-	descriptorWrites[1].pImageInfo = &imageInfo;
+		descriptorWrites[1].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+		descriptorWrites[1].dstSet = m_Frames[i].descriptorSet;
+		descriptorWrites[1].dstBinding = 1;
+		descriptorWrites[1].dstArrayElement = 0;
+		descriptorWrites[1].descriptorType = VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER;
+		descriptorWrites[1].descriptorCount = 1;
+		descriptorWrites[1].pImageInfo = &imageInfo;
 
-	vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+		vkUpdateDescriptorSets(m_Device, static_cast<uint32_t>(descriptorWrites.size()), descriptorWrites.data(), 0, nullptr);
+	}
 
 }
 
@@ -1120,9 +1327,10 @@ void VulkanGLFWApp::createTextureImage()
 		m_TextureImage, m_TextureImageMemory);
 
 
-	transitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	copyBufferToImage(m_TexStagingBuffer, m_TextureImage, static_cast<uint32_t>(m_nWidth), static_cast<uint32_t>(m_nHeight));
-	transitionImageLayout(m_TextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	VkCommandBuffer commandBuffer = beginUpload();
+	transitionImageLayout(commandBuffer, m_TextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	copyBufferToImage(commandBuffer, m_TexStagingBuffer, m_TextureImage, static_cast<uint32_t>(m_nWidth), static_cast<uint32_t>(m_nHeight));
+	transitionImageLayout(commandBuffer, m_TextureImage, VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
 
 }
 
@@ -1163,10 +1371,8 @@ void VulkanGLFWApp::createImage(uint32_t width, uint32_t height, VkFormat format
 	vkBindImageMemory(m_Device, image, imageMemory, 0);
 }
 
-void VulkanGLFWApp::transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
+void VulkanGLFWApp::transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout)
 {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.oldLayout = oldLayout;
@@ -1210,15 +1416,10 @@ void VulkanGLFWApp::transitionImageLayout(VkImage image, VkFormat format, VkImag
 		0, nullptr,
 		1, &barrier
 	);
-
-
-	endSingleTimeCommands(commandBuffer);
 }
 
-void VulkanGLFWApp::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
+void VulkanGLFWApp::copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height)
 {
-	VkCommandBuffer commandBuffer = beginSingleTimeCommands();
-
 	VkBufferImageCopy region = {};
 	region.bufferOffset = 0;
 	region.bufferRowLength = 0;
@@ -1244,8 +1445,6 @@ void VulkanGLFWApp::copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t w
 		1,
 		&region
 	);
-
-	endSingleTimeCommands(commandBuffer);
 }
 
 void VulkanGLFWApp::createTextureImageView()
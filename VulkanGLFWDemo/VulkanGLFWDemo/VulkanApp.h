@@ -2,10 +2,12 @@
 
 #include <iostream>
 #include <vector>
+#include <deque>
 #include <set>
 #include <mutex>
 #include <thread>
 #include <cstring>
+#include <cstdio>
 #include <algorithm>
 #include <fstream>
 #include <array>
@@ -19,6 +21,7 @@
 #include <GLFW/glfw3.h>
 
 #include <vulkan/vulkan.h>
+#include "VulkanPresentPacer.h"
 
 #pragma comment ( lib, "glfw3.lib")
 #pragma comment ( lib, "vulkan-1.lib")
@@ -26,8 +29,16 @@
 class VulkanGLFWApp
 {
 public:
-	VulkanGLFWApp(int nWidth, int nHeight) :
-		m_nWidth(nWidth), m_nHeight(nHeight)
+	// Same policies and pacing as FVulkanSwapChain
+	using PresentPolicy = EVulkanPresentPolicy;
+
+	// nFramesInFlight: how many frames the CPU may record ahead of the GPU (1 - 3)
+	// bShowFrameRate: shows the frame rate and frames in flight in the window title, once a second
+	VulkanGLFWApp(int nWidth, int nHeight, int nFramesInFlight = 2, PresentPolicy presentPolicy = PresentPolicy::LowLatency, bool bShowFrameRate = false) :
+		m_nWidth(nWidth), m_nHeight(nHeight),
+		m_PresentPacer(presentPolicy),
+		m_FramesInFlight(static_cast<uint32_t>(std::min(std::max(nFramesInFlight, 1), MAX_FRAMES_IN_FLIGHT))),
+		m_bShowFrameRate(bShowFrameRate)
 	{
 		bReady = false;
 		pthMsgLoop = new std::thread(ThreadProc, this);
@@ -102,20 +113,23 @@ private:
 
 		createVertexBuffer();
 		createIndexBuffer();
-		createUniformBuffer();
+		createUniformBuffers();
+
+		// Everything above went into one command buffer, the first frame is ordered after it on the queue
+		flushUploads();
 
 		
 		
-		createDescriptorSet();
+		createDescriptorSets();
 
-		bindCommandBuffers();
-		createSemaphores();
+		createSyncObjects();
 
 	}
 
 	void mainLoop() {
 
-		updateUniformBuffer();
+		m_FpsStartTime = std::chrono::steady_clock::now();
+		m_FpsFrameCount = 0;
 
 		while (!glfwWindowShouldClose(m_Window)) {
 			glfwPollEvents();
@@ -129,6 +143,11 @@ private:
 	void cleanup() {
 
 		cleanupSwapChain();
+		destroyUploads();
+
+		vkDestroyPipeline(m_Device, m_GraphicsPipeline, nullptr);
+		vkDestroyPipelineLayout(m_Device, m_PipelineLayout, nullptr);
+		vkDestroyRenderPass(m_Device, m_RenderPass, nullptr);
 
 		vkDestroySampler(m_Device, m_TextureSampler, nullptr);
 		vkDestroyImageView(m_Device, m_TextureImageView, nullptr);
@@ -142,8 +161,10 @@ private:
 
 		vkDestroyDescriptorPool(m_Device, m_DescriptorPool, nullptr);
 		vkDestroyDescriptorSetLayout(m_Device, m_DescriptorSetLayout, nullptr);
-		vkDestroyBuffer(m_Device, m_UniformBuffer, nullptr);
-		vkFreeMemory(m_Device, m_UniformBufferMemory, nullptr);
+		for (size_t i = 0; i < m_Frames.size(); i++) {
+			vkDestroyBuffer(m_Device, m_Frames[i].uniformBuffer, nullptr);
+			vkFreeMemory(m_Device, m_Frames[i].uniformBufferMemory, nullptr);
+		}
 
 		vkDestroyBuffer(m_Device, m_IndexBuffer, nullptr);
 		vkFreeMemory(m_Device, m_IndexBufferMemory, nullptr);
@@ -151,8 +172,11 @@ private:
 		vkDestroyBuffer(m_Device, m_VertexBuffer, nullptr);
 		vkFreeMemory(m_Device, m_VertexBufferMemory, nullptr);
 
-		vkDestroySemaphore(m_Device, m_RenderFinishedSemaphore, nullptr);
-		vkDestroySemaphore(m_Device, m_ImageAvailableSemaphore, nullptr);
+		for (size_t i = 0; i < m_Frames.size(); i++) {
+			vkDestroySemaphore(m_Device, m_Frames[i].renderFinishedSemaphore, nullptr);
+			vkDestroySemaphore(m_Device, m_Frames[i].imageAvailableSemaphore, nullptr);
+			vkDestroyFence(m_Device, m_Frames[i].inFlightFence, nullptr);
+		}
 		vkDestroyCommandPool(m_Device, m_CommandPool, nullptr);
 		
 		DestroyDebugReportCallbackEXT(m_Instance, debug_callback, nullptr);
@@ -185,6 +209,41 @@ private:
 		glm::mat4 proj;
 	};
 
+	static const int MAX_FRAMES_IN_FLIGHT = 3;
+
+	// Everything the CPU writes while recording a frame, duplicated per frame in flight
+	struct FrameData {
+		VkCommandBuffer commandBuffer;
+		VkSemaphore imageAvailableSemaphore;
+		VkSemaphore renderFinishedSemaphore;
+		VkFence inFlightFence;
+
+		VkBuffer uniformBuffer;
+		VkDeviceMemory uniformBufferMemory;
+		void* uniformBufferMapped;
+		VkDescriptorSet descriptorSet;
+
+		uint64_t submittedFrame = 0;
+	};
+
+	// A replaced swap chain with its views and framebuffers, alive until lastFrame has completed
+	struct RetiredSwapChain {
+		uint64_t lastFrame;
+		VkSwapchainKHR swapChain;
+		std::vector<VkImageView> imageViews;
+		std::vector<VkFramebuffer> framebuffers;
+	};
+
+	// Uploads recorded between two flushUploads(), submitted together with one fence.
+	// Staging buffers are destroyed when the batch retires.
+	struct UploadBatch {
+		VkCommandBuffer commandBuffer;
+		VkFence fence;
+		uint64_t token;
+		std::vector<VkBuffer> stagingBuffers;
+		std::vector<VkDeviceMemory> stagingBufferMemories;
+	};
+
 
 private:
 
@@ -205,7 +264,6 @@ private:
 
 	SwapChainSupportDetails querySwapChainSupport(VkPhysicalDevice device);
 	VkSurfaceFormatKHR chooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& availableFormats);
-	VkPresentModeKHR chooseSwapPresentMode(const std::vector<VkPresentModeKHR> availablePresentModes);
 	VkExtent2D chooseSwapExtent(const VkSurfaceCapabilitiesKHR& capabilities);
 
 	void createSwapChain();
@@ -218,37 +276,47 @@ private:
 	void createCommandPool();
 	void createCommandBuffers();
 
-	void bindCommandBuffers();
+	void recordCommandBuffer(VkCommandBuffer commandBuffer, uint32_t imageIndex);
 
-	void createSemaphores();
+	void createSyncObjects();
 	void drawFrame();
+	void updateFrameRate();
 
 	void cleanupSwapChain();
 	void recreateSwapChain();
+	void releaseRetiredSwapChains(bool bAll);
 
+	// Only marks the swap chain, a window drag sends many of these per frame
 	static void onWindowResized(GLFWwindow* window, int width, int height) {
 		if (width == 0 || height == 0) return;
 
 		VulkanGLFWApp* app = reinterpret_cast<VulkanGLFWApp*>(glfwGetWindowUserPointer(window));
-		app->recreateSwapChain();
+		app->m_bSwapChainDirty = true;
 	}
 
 	void createVertexBuffer();
 	void createIndexBuffer();
-	void createUniformBuffer();
+	void createUniformBuffers();
 
 	uint32_t findMemoryType(uint32_t typeFilter, VkMemoryPropertyFlags properties);
 
 	void createBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer& buffer, VkDeviceMemory& bufferMemory);
-	void copyBuffer(VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
-	void updateUniformBuffer();
-
-	VkCommandBuffer beginSingleTimeCommands();
-	void endSingleTimeCommands(VkCommandBuffer commandBuffer);
+	void copyBuffer(VkCommandBuffer commandBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void updateUniformBuffer(uint32_t frameIndex);
+
+	// Upload context: copies and layout transitions are recorded into the current upload command buffer
+	// and go to the GPU with the next flushUploads(), which returns the token to wait on.
+	VkCommandBuffer beginUpload();
+	void releaseAfterUpload(VkBuffer stagingBuffer, VkDeviceMemory stagingBufferMemory);
+	uint64_t flushUploads();
+	bool isUploadComplete(uint64_t token);
+	void waitForUpload(uint64_t token);
+	void retireUploads();
+	void destroyUploads();
 
 	void createDescriptorSetLayout();
 	void createDescriptorPool();
-	void createDescriptorSet();
+	void createDescriptorSets();
 
 	void createTextureImage();
 
@@ -256,8 +324,8 @@ private:
 		VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
 		VkImage& image, VkDeviceMemory& imageMemory);
 
-	void transitionImageLayout(VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void copyBufferToImage(VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
+	void transitionImageLayout(VkCommandBuffer commandBuffer, VkImage image, VkFormat format, VkImageLayout oldLayout, VkImageLayout newLayout);
+	void copyBufferToImage(VkCommandBuffer commandBuffer, VkBuffer buffer, VkImage image, uint32_t width, uint32_t height);
 
 	void createTextureImageView();
 	VkImageView createImageView(VkImage image, VkFormat format);
@@ -288,11 +356,16 @@ private:
 		VK_KHR_SWAPCHAIN_EXTENSION_NAME
 	};
 
-	VkSwapchainKHR m_SwapChain;
+	VkSwapchainKHR m_SwapChain = VK_NULL_HANDLE;
+	bool m_bSwapChainDirty = false;
+	std::deque<RetiredSwapChain> m_RetiredSwapChains;
 	std::vector<VkImage> m_SwapChainImages;
 	VkFormat m_SwapChainImageFormat;
 	VkExtent2D m_SwapChainExtent;
 
+	// Picks the present mode and detects missed vblanks under FIFO
+	FVulkanPresentPacer m_PresentPacer;
+
 	std::vector<VkImageView> m_SwapChainImageViews;
 
 	VkRenderPass m_RenderPass;
@@ -303,10 +376,24 @@ private:
 	std::vector<VkFramebuffer> m_SwapChainFramebuffers;
 
 	VkCommandPool m_CommandPool;
-	std::vector<VkCommandBuffer> m_CommandBuffers;
 
-	VkSemaphore m_ImageAvailableSemaphore;
-	VkSemaphore m_RenderFinishedSemaphore;
+	uint32_t m_FramesInFlight;
+	uint32_t m_CurrentFrame = 0;
+	std::vector<FrameData> m_Frames;
+	std::vector<VkFence> m_ImagesInFlight;
+	uint64_t m_SubmittedFrames = 0;
+	uint64_t m_CompletedFrames = 0;
+
+	UploadBatch m_CurrentUpload;
+	bool m_bUploadRecording = false;
+	std::deque<UploadBatch> m_PendingUploads;
+	std::vector<UploadBatch> m_FreeUploads;
+	uint64_t m_LastSubmittedUpload = 0;
+	uint64_t m_LastCompletedUpload = 0;
+
+	bool m_bShowFrameRate;
+	std::chrono::steady_clock::time_point m_FpsStartTime;
+	uint32_t m_FpsFrameCount = 0;
 
 
 	struct Vertex {
@@ -357,11 +444,8 @@ private:
 	VkDeviceMemory m_VertexBufferMemory;
 	VkBuffer m_IndexBuffer;
 	VkDeviceMemory m_IndexBufferMemory;
-	VkBuffer m_UniformBuffer;
-	VkDeviceMemory m_UniformBufferMemory;
 
 	VkDescriptorPool m_DescriptorPool;
-	VkDescriptorSet m_DescriptorSet;
 
 	VkImage m_TextureImage;
 	VkDeviceMemory m_TextureImageMemory;
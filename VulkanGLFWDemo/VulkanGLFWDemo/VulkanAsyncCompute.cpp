@@ -0,0 +1,86 @@
+#include "VulkanAsyncCompute.h"
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanMemory.h"
+#include "VulkanCommandBuffer.h"
+
+FVulkanAsyncCompute::FVulkanAsyncCompute(const FVulkanDevice * InDevice, FVulkanQueue * InComputeQueue)
+	:m_Device(InDevice), m_Queue(InComputeQueue)
+{
+	m_CmdBufferManager.reset(new FVulkanCommandBufferManager(m_Device, m_Queue));
+}
+
+FVulkanAsyncCompute::~FVulkanAsyncCompute()
+{
+	// Graphics work still waiting on a semaphore has to finish before it goes away
+	for (auto& pending : m_PendingSemaphores)
+	{
+		if (pending.CmdBuffer->GetSubmittedSerial() != pending.PrevSerial) {
+			pending.CmdBuffer->WaitForFence();
+		}
+	}
+	m_PendingSemaphores.clear();
+	m_Queue->WaitForSerial(m_Queue->GetLastSubmittedSerial());
+
+	for (auto semaphore : m_Semaphores)
+	{
+		delete semaphore;
+	}
+	m_Semaphores.clear();
+	m_FreeSemaphores.clear();
+
+	m_CmdBufferManager.reset();
+}
+
+FVulkanCommandBuffer * FVulkanAsyncCompute::GetNewCommandBuffer()
+{
+	return m_CmdBufferManager->GetNewCommandBuffer();
+}
+
+uint64_t FVulkanAsyncCompute::Submit(FVulkanCommandBuffer * InComputeCmdBuffer, FVulkanCommandBuffer * InGraphicsCmdBuffer, VkPipelineStageFlags InWaitStage)
+{
+	if (!InComputeCmdBuffer->HasEnded()) return 0;
+
+	FVulkanSemaphore* semaphore = AcquireSemaphore(InGraphicsCmdBuffer);
+	InComputeCmdBuffer->AddSignalSemaphore(semaphore);
+	InGraphicsCmdBuffer->AddWaitSemaphore(InWaitStage, semaphore);
+
+	return m_Queue->Submit(InComputeCmdBuffer);
+}
+
+FVulkanSemaphore * FVulkanAsyncCompute::AcquireSemaphore(FVulkanCommandBuffer * InWaitingCmdBuffer)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// A semaphore can be signaled again once the graphics submission waiting on it has completed
+	while (!m_PendingSemaphores.empty()) {
+		const FPendingSemaphore& oldest = m_PendingSemaphores.front();
+		const uint64_t serial = oldest.CmdBuffer->GetSubmittedSerial();
+		if (serial == oldest.PrevSerial) break;
+
+		FVulkanQueue* waitingQueue = oldest.CmdBuffer->GetOwner()->GetQueue();
+		waitingQueue->RefreshFenceStatus();
+		if (!waitingQueue->IsSerialCompleted(serial)) break;
+
+		m_FreeSemaphores.push_back(oldest.Semaphore);
+		m_PendingSemaphores.pop_front();
+	}
+
+	FVulkanSemaphore* semaphore;
+	if (!m_FreeSemaphores.empty()) {
+		semaphore = m_FreeSemaphores.back();
+		m_FreeSemaphores.pop_back();
+	}
+	else {
+		semaphore = new FVulkanSemaphore(m_Device);
+		m_Semaphores.push_back(semaphore);
+	}
+
+	FPendingSemaphore pending;
+	pending.Semaphore = semaphore;
+	pending.CmdBuffer = InWaitingCmdBuffer;
+	pending.PrevSerial = InWaitingCmdBuffer->GetSubmittedSerial();
+	m_PendingSemaphores.push_back(pending);
+
+	return semaphore;
+}
@@ -0,0 +1,56 @@
+#pragma once
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class FVulkanDevice;
+class FVulkanQueue;
+class FVulkanSemaphore;
+class FVulkanCommandBuffer;
+class FVulkanCommandBufferManager;
+
+// Runs compute work on the compute queue next to the graphics queue.
+// Each submission signals a semaphore that the graphics command buffer consuming the results waits on,
+// so the graphics queue only stalls at the stage that actually reads them.
+// Resources with exclusive sharing need a queue family ownership transfer when the two families differ.
+class FVulkanAsyncCompute
+{
+public:
+	FVulkanAsyncCompute(const FVulkanDevice* InDevice, FVulkanQueue* InComputeQueue);
+	~FVulkanAsyncCompute();
+
+	inline FVulkanQueue* GetQueue() const
+	{
+		return m_Queue;
+	}
+
+	// Command buffer of the compute queue, record the dispatches between Begin() and End()
+	FVulkanCommandBuffer* GetNewCommandBuffer();
+
+	// Submits the ended InComputeCmdBuffer. InGraphicsCmdBuffer waits for it at InWaitStage
+	// and has to be submitted afterwards, its completion recycles the semaphore.
+	uint64_t Submit(FVulkanCommandBuffer* InComputeCmdBuffer, FVulkanCommandBuffer* InGraphicsCmdBuffer, VkPipelineStageFlags InWaitStage);
+
+private:
+	FVulkanSemaphore* AcquireSemaphore(FVulkanCommandBuffer* InWaitingCmdBuffer);
+
+private:
+	struct FPendingSemaphore
+	{
+		FVulkanSemaphore* Semaphore;
+		FVulkanCommandBuffer* CmdBuffer;
+		uint64_t PrevSerial;
+	};
+
+	const FVulkanDevice* m_Device;
+	FVulkanQueue* m_Queue;
+	std::unique_ptr<FVulkanCommandBufferManager> m_CmdBufferManager;
+
+	std::mutex m_Mutex;
+	std::vector<FVulkanSemaphore*> m_Semaphores;
+	std::vector<FVulkanSemaphore*> m_FreeSemaphores;
+	// In submission order, waited on by graphics command buffers that may not have completed yet
+	std::deque<FPendingSemaphore> m_PendingSemaphores;
+};
@@ -3,11 +3,13 @@
 #include "VulkanDevice.h"
 #include "VulkanQueue.h"
 #include "VulkanCommandBuffer.h"
+#include "VulkanDeletionQueue.h"
 #include <stdexcept>
+#include <cstring>
 
 
 FVulkanBufferBase::FVulkanBufferBase(const FVulkanDevice * InDevice, uint64_t InBufferSize)
-	:m_Device(InDevice), m_BufferSize(InBufferSize), m_Buffer(NULL), m_Memory(NULL)
+	:m_Device(InDevice), m_BufferSize(InBufferSize), m_Buffer(NULL)
 {
 	
 }
@@ -17,7 +19,7 @@ FVulkanBufferBase::~FVulkanBufferBase()
 }
 
 
-void FVulkanBufferBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, VkDeviceMemory & bufferMemory)
+void FVulkanBufferBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, FVulkanAllocation & allocation)
 {
 	VkBufferCreateInfo bufferInfo = {};
 	bufferInfo.sType = VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO;
@@ -29,70 +31,65 @@ void FVulkanBufferBase::CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage
 		throw std::runtime_error("failed to create buffer!");
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetBufferMemoryRequirements(m_Device->GetLogicalDevice(), buffer, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FVulkanUtil::FindMemoryType(m_Device->GetPhysicalDevice(), memRequirements.memoryTypeBits, properties);
+	m_Device->GetMemoryManager()->AllocateBufferMemory(buffer, properties, allocation);
+}
 
-	if (vkAllocateMemory(m_Device->GetLogicalDevice(), &allocInfo, nullptr, &bufferMemory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate buffer memory!");
-	}
+void FVulkanBufferBase::DestoryBuffer()
+{
+	if (!m_Buffer) return;
 
-	vkBindBufferMemory(m_Device->GetLogicalDevice(), buffer, bufferMemory, 0);
+	vkDestroyBuffer(m_Device->GetLogicalDevice(), m_Buffer, nullptr);
+	m_Device->GetMemoryManager()->Free(m_Allocation);
+	m_Buffer = NULL;
 }
 
-void FVulkanBufferBase::CopyBuffer(FVulkanCommandBuffer* InCmdBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size)
+void FVulkanBufferBase::CopyBuffer(FVulkanCommandBuffer* InCmdBuffer, VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size, FVulkanSubmitBatch* InBatch)
 {
 
 	InCmdBuffer->Begin();
 
 	VkBufferCopy copyRegion = {};
+	copyRegion.srcOffset = srcOffset;
 	copyRegion.size = size;
 	vkCmdCopyBuffer(InCmdBuffer->GetHandle(), srcBuffer, dstBuffer, 1, &copyRegion);
 
 	InCmdBuffer->End();
-	InCmdBuffer->GetOwner()->GetQueue()->Submit(InCmdBuffer);
+	if (InBatch) {
+		InBatch->Add(InCmdBuffer);
+	}
+	else {
+		InCmdBuffer->GetOwner()->GetQueue()->Submit(InCmdBuffer);
+	}
 }
 
 FVulkanBuffer::FVulkanBuffer(const FVulkanDevice * InDevice, uint64_t InBufferSize, VkBufferUsageFlags InUsage)
 	:FVulkanBufferBase(InDevice, InBufferSize)
 {
-	CreateBuffer(m_BufferSize, InUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Buffer, m_Memory);
+	CreateBuffer(m_BufferSize, InUsage | VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_Buffer, m_Allocation);
 }
 
 FVulkanBuffer::~FVulkanBuffer()
 {
-	vkDestroyBuffer(m_Device->GetLogicalDevice(), m_Buffer, nullptr);
-	vkFreeMemory(m_Device->GetLogicalDevice(), m_Memory, nullptr);
+	DestoryBuffer();
 }
 
-void FVulkanBuffer::UpdateBuffer(FVulkanCommandBuffer * InCmdBuffer, const void * InSrcData, uint64_t InSrcDataSize)
+void FVulkanBuffer::UpdateBuffer(FVulkanCommandBuffer * InCmdBuffer, const void * InSrcData, uint64_t InSrcDataSize, FVulkanSubmitBatch* InBatch)
 {
 	if (InSrcDataSize > m_BufferSize) return;
 
+	FVulkanStagingRingBuffer::FAllocation staging;
+	if (m_Device->GetStagingRing()->Allocate(InSrcDataSize, 4, InCmdBuffer, staging)) {
+		memcpy(staging.MappedData, InSrcData, (size_t)InSrcDataSize);
+		CopyBuffer(InCmdBuffer, staging.Buffer, staging.Offset, m_Buffer, InSrcDataSize, InBatch);
+		return;
+	}
 
-	FVulkanStagingBuffer* stagingBuffer = new FVulkanStagingBuffer(m_Device, InSrcDataSize);
-	stagingBuffer->UpdateFromData(InSrcData, InSrcDataSize);
-
-	class DestoryTask : public FVulkanCommandBuffer::DelayedTask
-	{
-	public:
-		DestoryTask(FVulkanStagingBuffer* buffer) : m_buffer(buffer) {};
-		~DestoryTask() {};
-
-		void DoTask() 
-		{
-			delete m_buffer;
-		};
-	private:
-		FVulkanStagingBuffer* m_buffer;
-	};
-	InCmdBuffer->AddDelayedTask(FVulkanCommandBuffer::DelayedTaskPtr(new DestoryTask(stagingBuffer)));
+	// Doesn't fit in the staging ring, fall back to a buffer of its own
+	FVulkanStagingBuffer stagingBuffer(m_Device, InSrcDataSize);
+	stagingBuffer.UpdateFromData(InSrcData, InSrcDataSize);
+	VkBuffer stagingHandle = stagingBuffer.ReleaseAfter(InCmdBuffer);
 
-	CopyBuffer(InCmdBuffer, stagingBuffer->GetBuffer(), m_Buffer, InSrcDataSize);
+	CopyBuffer(InCmdBuffer, stagingHandle, 0, m_Buffer, InSrcDataSize, InBatch);
 
 	/*VkBuffer stagingBuffer;
 	VkDeviceMemory stagingBufferMemory;
@@ -109,25 +106,139 @@ void FVulkanBuffer::UpdateBuffer(FVulkanCommandBuffer * InCmdBuffer, const void
 	vkFreeMemory(m_Device->GetLogicalDevice(), stagingBufferMemory, nullptr);*/
 }
 
+FVulkanReadbackBuffer::FVulkanReadbackBuffer(const FVulkanDevice * InDevice, uint64_t InBufferSize)
+	:FVulkanBufferBase(InDevice, InBufferSize)
+{
+	CreateBuffer(m_BufferSize, VK_BUFFER_USAGE_TRANSFER_DST_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer, m_Allocation);
+}
+
+FVulkanReadbackBuffer::~FVulkanReadbackBuffer()
+{
+	DestoryBuffer();
+}
+
 FVulkanStagingBuffer::FVulkanStagingBuffer(const FVulkanDevice * InDevice, uint64_t InBufferSize)
 	:FVulkanBufferBase(InDevice, InBufferSize)
 {
-	CreateBuffer(m_BufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer, m_Memory);
+	CreateBuffer(m_BufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer, m_Allocation);
 }
 
 FVulkanStagingBuffer::~FVulkanStagingBuffer()
 {
-	vkDestroyBuffer(m_Device->GetLogicalDevice(), m_Buffer, nullptr);
-	vkFreeMemory(m_Device->GetLogicalDevice(), m_Memory, nullptr);
+	DestoryBuffer();
 }
 
 void FVulkanStagingBuffer::UpdateFromData(const void * InSrcData, uint64_t InSrcDataSize)
 {
 	if (InSrcDataSize > m_BufferSize) return;
 
-	void* dstData;
-	vkMapMemory(m_Device->GetLogicalDevice(), m_Memory, 0, InSrcDataSize, 0, &dstData);
-	memcpy(dstData, InSrcData, (size_t)InSrcDataSize);
-	vkUnmapMemory(m_Device->GetLogicalDevice(), m_Memory);
+	// Host visible heaps are persistently mapped by the memory manager
+	memcpy(m_Allocation.MappedData, InSrcData, (size_t)InSrcDataSize);
+
+}
+
+VkBuffer FVulkanStagingBuffer::ReleaseAfter(FVulkanCommandBuffer * InCmdBuffer)
+{
+	VkBuffer buffer = m_Buffer;
+	if (!buffer) return buffer;
+
+	FVulkanDeletionQueue* deletionQueue = m_Device->GetDeletionQueue();
+	deletionQueue->Enqueue(InCmdBuffer, FVulkanDeletionQueue::EType::Buffer, (uint64_t)buffer);
+	deletionQueue->EnqueueAllocation(InCmdBuffer, m_Allocation);
+
+	m_Buffer = NULL;
+	m_Allocation = FVulkanAllocation();
+	return buffer;
+}
+
+
+FVulkanStagingRingBuffer::FVulkanStagingRingBuffer(const FVulkanDevice * InDevice, uint64_t InBufferSize)
+	:FVulkanBufferBase(InDevice, InBufferSize), m_Head(0), m_Tail(0)
+{
+	CreateBuffer(m_BufferSize, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT, m_Buffer, m_Allocation);
+}
+
+FVulkanStagingRingBuffer::~FVulkanStagingRingBuffer()
+{
+	DestoryBuffer();
+}
+
+bool FVulkanStagingRingBuffer::Allocate(VkDeviceSize InSize, VkDeviceSize InAlignment, FVulkanCommandBuffer * InCmdBuffer, FAllocation & OutAllocation)
+{
+	if (InSize == 0 || InSize > m_BufferSize) return false;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	VkDeviceSize offset = 0;
+	for (;;)
+	{
+		ReclaimCompleted();
+
+		if (TryAllocate(InSize, InAlignment, offset)) break;
+
+		// Ring is full: wait for the oldest upload, unless it is still being recorded
+		const FEntry& oldest = m_Entries.front();
+		if (oldest.CmdBuffer->GetSubmittedSerial() == oldest.PrevSerial) return false;
+
+		oldest.CmdBuffer->GetOwner()->GetQueue()->WaitForSerial(oldest.CmdBuffer->GetSubmittedSerial());
+	}
+
+	uint64_t prevSerial = InCmdBuffer->GetSubmittedSerial();
+	if (m_Entries.size() > 0 && m_Entries.back().CmdBuffer == InCmdBuffer && m_Entries.back().PrevSerial == prevSerial && m_Entries.back().End <= offset) {
+		m_Entries.back().End = offset + InSize;
+	}
+	else {
+		m_Entries.push_back(FEntry{ offset, offset + InSize, InCmdBuffer, prevSerial });
+	}
+	m_Head = offset + InSize;
+
+	OutAllocation.Buffer = m_Buffer;
+	OutAllocation.Offset = offset;
+	OutAllocation.MappedData = static_cast<uint8_t*>(m_Allocation.MappedData) + offset;
+	return true;
+}
+
+bool FVulkanStagingRingBuffer::TryAllocate(VkDeviceSize InSize, VkDeviceSize InAlignment, VkDeviceSize & OutOffset)
+{
+	if (m_Entries.empty()) {
+		m_Head = 0;
+		m_Tail = 0;
+	}
+
+	VkDeviceSize offset = (m_Head + InAlignment - 1) / InAlignment * InAlignment;
+
+	if (m_Entries.empty() || m_Head > m_Tail) {
+		// Used range is [m_Tail, m_Head), free space at the end and in front of m_Tail
+		if (offset + InSize > m_BufferSize) {
+			if (InSize > m_Tail) return false;
+			offset = 0;
+		}
+	}
+	else {
+		// Wrapped around, free space is [m_Head, m_Tail)
+		if (offset + InSize > m_Tail) return false;
+	}
+
+	OutOffset = offset;
+	return true;
+}
+
+void FVulkanStagingRingBuffer::ReclaimCompleted()
+{
+	while (m_Entries.size() > 0)
+	{
+		// Once submitted, a later submission of the same command buffer completing covers this one too
+		const FEntry& entry = m_Entries.front();
+		uint64_t serial = entry.CmdBuffer->GetSubmittedSerial();
+		if (serial == entry.PrevSerial) break;
+
+		FVulkanQueue* queue = entry.CmdBuffer->GetOwner()->GetQueue();
+		if (!queue->IsSerialCompleted(serial)) {
+			queue->RefreshFenceStatus();
+			if (!queue->IsSerialCompleted(serial)) break;
+		}
+		m_Entries.pop_front();
+	}
 
+	m_Tail = m_Entries.size() > 0 ? m_Entries.front().Begin : m_Head;
 }
@@ -1,9 +1,13 @@
 #pragma once
 
+#include <deque>
+#include <mutex>
 #include <vulkan/vulkan.h>
+#include "VulkanMemory.h"
 
 class FVulkanDevice;
 class FVulkanCommandBuffer;
+class FVulkanSubmitBatch;
 
 class FVulkanBufferBase
 {
@@ -18,19 +22,25 @@ public:
 
 	inline VkDeviceMemory GetMemory() const
 	{
-		return m_Memory;
+		return m_Allocation.Memory;
+	}
+
+	inline VkDeviceSize GetMemoryOffset() const
+	{
+		return m_Allocation.Offset;
 	}
 
 protected:
-	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, VkDeviceMemory & bufferMemory);
-	void CopyBuffer(FVulkanCommandBuffer* InCmdBuffer, VkBuffer srcBuffer, VkBuffer dstBuffer, VkDeviceSize size);
+	void CreateBuffer(VkDeviceSize size, VkBufferUsageFlags usage, VkMemoryPropertyFlags properties, VkBuffer & buffer, FVulkanAllocation & allocation);
+	void DestoryBuffer();
+	void CopyBuffer(FVulkanCommandBuffer* InCmdBuffer, VkBuffer srcBuffer, VkDeviceSize srcOffset, VkBuffer dstBuffer, VkDeviceSize size, FVulkanSubmitBatch* InBatch);
 
 
 protected:
 	const FVulkanDevice* m_Device;
 	VkDeviceSize m_BufferSize;
 	VkBuffer m_Buffer;
-	VkDeviceMemory m_Memory;
+	FVulkanAllocation m_Allocation;
 
 };
 
@@ -42,18 +52,83 @@ public:
 
 	void UpdateFromData(const void* InSrcData, uint64_t InSrcDataSize);
 
+	inline void* GetMappedData() const
+	{
+		return m_Allocation.MappedData;
+	}
+
+	// Hands the buffer over to the deletion queue, it stays alive until InCmdBuffer has completed.
+	// Returns the handle for recording, this object no longer owns it.
+	VkBuffer ReleaseAfter(FVulkanCommandBuffer* InCmdBuffer);
+
 private:
 
 };
 
+// Host visible destination for copies back from the GPU, persistently mapped
+class FVulkanReadbackBuffer : public FVulkanBufferBase
+{
+public:
+	FVulkanReadbackBuffer(const FVulkanDevice* InDevice, uint64_t InBufferSize);
+	~FVulkanReadbackBuffer();
+
+	inline const void* GetMappedData() const
+	{
+		return m_Allocation.MappedData;
+	}
+};
+
 class FVulkanBuffer : public FVulkanBufferBase
 {
 public:
 	FVulkanBuffer(const FVulkanDevice* InDevice, uint64_t InBufferSize, VkBufferUsageFlags InUsage);
 	~FVulkanBuffer();
 
-	void UpdateBuffer(FVulkanCommandBuffer* InCmdBuffer, const void* InSrcData, uint64_t InSrcDataSize);
+	// With a batch the copy is queued on it instead of being submitted right away
+	void UpdateBuffer(FVulkanCommandBuffer* InCmdBuffer, const void* InSrcData, uint64_t InSrcDataSize, FVulkanSubmitBatch* InBatch = nullptr);
 
 private:
 
 };
+
+
+// Persistently mapped staging memory shared by all uploads of a device.
+// Space is handed out by bumping a write offset and is given back once the command buffer
+// that reads it has completed, so uploads only stall when the ring is really full.
+// Uploads bigger than the ring (64MB per device) can't go through it, FVulkanTexture::AllocateUploadData
+// gives those a FVulkanStagingBuffer of their own, i.e. one buffer and allocation per upload.
+class FVulkanStagingRingBuffer : public FVulkanBufferBase
+{
+public:
+	FVulkanStagingRingBuffer(const FVulkanDevice* InDevice, uint64_t InBufferSize);
+	~FVulkanStagingRingBuffer();
+
+	struct FAllocation
+	{
+		VkBuffer Buffer;
+		VkDeviceSize Offset;
+		void* MappedData;
+	};
+
+	// Returns false when the request can never fit, e.g. it is bigger than the ring or the
+	// ring is filled by the command buffer that is still being recorded.
+	bool Allocate(VkDeviceSize InSize, VkDeviceSize InAlignment, FVulkanCommandBuffer* InCmdBuffer, FAllocation& OutAllocation);
+
+private:
+	struct FEntry
+	{
+		VkDeviceSize Begin;
+		VkDeviceSize End;
+		FVulkanCommandBuffer* CmdBuffer;
+		// Serial of the command buffer's previous submission, the upload goes out with a later one
+		uint64_t PrevSerial;
+	};
+
+	bool TryAllocate(VkDeviceSize InSize, VkDeviceSize InAlignment, VkDeviceSize& OutOffset);
+	void ReclaimCompleted();
+
+	std::mutex m_Mutex;
+	std::deque<FEntry> m_Entries;
+	VkDeviceSize m_Head;
+	VkDeviceSize m_Tail;
+};
@@ -5,8 +5,8 @@
 #include <stdexcept>
 
 
-FVulkanCommandBuffer::FVulkanCommandBuffer(const FVulkanDevice* InDevice, FVulkanCommandBufferManager* InOwner)
-	:m_Device(InDevice), m_Owner(InOwner), m_State(EState::NotAllocated)
+FVulkanCommandBuffer::FVulkanCommandBuffer(const FVulkanDevice* InDevice, FVulkanCommandBufferManager* InOwner, bool bInIsSecondary)
+	:m_Device(InDevice), m_Owner(InOwner), m_State(EState::NotAllocated), m_SubmittedSerial(0), m_bIsSecondary(bInIsSecondary)
 {
 }
 
@@ -25,24 +25,61 @@ void FVulkanCommandBuffer::AddSignalSemaphore(const FVulkanSemaphore * InSignalS
 	m_SignalSemaphores.push_back(InSignalSemaphore->GetHandle());
 }
 
-void FVulkanCommandBuffer::AddDelayedTask(DelayedTaskPtr InTask)
+void FVulkanCommandBuffer::Begin()
 {
-	m_DelayedTasks.push_back(InTask);
+	VkCommandBufferBeginInfo beginInfo = {};
+	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+
+	vkBeginCommandBuffer(m_Handle, &beginInfo);
+	m_ImageStates.Reset(m_Handle);
+
+	m_State = EState::IsInsideBegin;
 }
 
-void FVulkanCommandBuffer::Begin()
+void FVulkanCommandBuffer::BeginSecondary(const VkCommandBufferInheritanceInfo & InInheritance)
 {
 	VkCommandBufferBeginInfo beginInfo = {};
 	beginInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO;
-	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+	beginInfo.flags = VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT | VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT;
+	beginInfo.pInheritanceInfo = &InInheritance;
 
 	vkBeginCommandBuffer(m_Handle, &beginInfo);
+	m_ImageStates.Reset(m_Handle);
+
+	m_State = EState::IsInsideBegin;
+}
+
+void FVulkanCommandBuffer::BeginRenderPass(const VkRenderPassBeginInfo & InBeginInfo, VkSubpassContents InContents)
+{
+	m_ImageStates.Flush();
+	vkCmdBeginRenderPass(m_Handle, &InBeginInfo, InContents);
+	m_State = EState::IsInsideRenderPass;
+}
 
+void FVulkanCommandBuffer::EndRenderPass()
+{
+	vkCmdEndRenderPass(m_Handle);
 	m_State = EState::IsInsideBegin;
 }
 
+void FVulkanCommandBuffer::ExecuteCommands(FVulkanCommandBuffer * const * InCmdBuffers, uint32_t InNumCmdBuffers)
+{
+	if (InNumCmdBuffers == 0) return;
+
+	std::vector<VkCommandBuffer> handles(InNumCmdBuffers);
+	for (uint32_t i = 0; i < InNumCmdBuffers; i++)
+	{
+		handles[i] = InCmdBuffers[i]->GetHandle();
+		m_ExecutedCmdBuffers.push_back(InCmdBuffers[i]);
+	}
+
+	vkCmdExecuteCommands(m_Handle, InNumCmdBuffers, handles.data());
+}
+
 void FVulkanCommandBuffer::End()
 {
+	m_ImageStates.Flush();
 	vkEndCommandBuffer(m_Handle);
 	m_State = EState::HasEnded;
 }
@@ -51,34 +88,52 @@ void FVulkanCommandBuffer::RefreshFenceStatus()
 {
 	if (m_State == EState::Submitted)
 	{
-		
-		if (m_Fence->IsSignaled())
-		{
-			vkResetCommandBuffer(m_Handle, VK_COMMAND_BUFFER_RESET_RELEASE_RESOURCES_BIT);
-			ResetSemaphores();
-			m_Fence->Reset();
-
-			for (size_t i = 0; i < m_DelayedTasks.size(); i++)
-			{
-				m_DelayedTasks[i]->DoTask();
-			}
-
-			m_DelayedTasks.clear();
-
-			// Change state at the end to be safe
-			m_State = EState::ReadyForBegin;
-			m_Owner->CollectUsedBuffer(this);
-		}
+		m_Owner->GetQueue()->RefreshFenceStatus();
 	}
 	
 }
 
+void FVulkanCommandBuffer::MarkSubmitted(uint64_t InSerial)
+{
+	m_SubmittedSerial.store(InSerial, std::memory_order_release);
+	m_State = EState::Submitted;
+
+	for (size_t i = 0; i < m_ExecutedCmdBuffers.size(); i++)
+	{
+		m_ExecutedCmdBuffers[i]->MarkSubmitted(InSerial);
+	}
+}
+
+void FVulkanCommandBuffer::OnSubmissionCompleted()
+{
+	// No vkResetCommandBuffer here: this may run on another thread than the one owning the pool.
+	// The pool allows per buffer resets, so the next vkBeginCommandBuffer resets it implicitly.
+	ResetSemaphores();
+
+	for (size_t i = 0; i < m_ExecutedCmdBuffers.size(); i++)
+	{
+		m_ExecutedCmdBuffers[i]->OnSubmissionCompleted();
+	}
+	m_ExecutedCmdBuffers.clear();
+
+	// Change state at the end to be safe
+	m_State = EState::ReadyForBegin;
+	m_Owner->CollectUsedBuffer(this);
+}
+
+void FVulkanCommandBuffer::WaitForFence(uint64_t InTimeoutNs)
+{
+	if (m_State != EState::Submitted) return;
+
+	m_Owner->GetQueue()->WaitForSerial(GetSubmittedSerial(), InTimeoutNs);
+}
+
 void FVulkanCommandBuffer::AllocMemory()
 {
 	VkCommandBufferAllocateInfo allocInfo = {};
 	allocInfo.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_ALLOCATE_INFO;
 	allocInfo.commandPool = m_Owner->GetPool();
-	allocInfo.level = VK_COMMAND_BUFFER_LEVEL_PRIMARY;
+	allocInfo.level = m_bIsSecondary ? VK_COMMAND_BUFFER_LEVEL_SECONDARY : VK_COMMAND_BUFFER_LEVEL_PRIMARY;
 	allocInfo.commandBufferCount = 1;
 
 	if (vkAllocateCommandBuffers(m_Device->GetLogicalDevice(), &allocInfo, &m_Handle) != VK_SUCCESS) {
@@ -104,7 +159,7 @@ void FVulkanCommandBuffer::ResetSemaphores()
 }
 
 
-FVulkanCommandBufferManager::FVulkanCommandBufferManager(const FVulkanDevice* InDevice, const FVulkanQueue* InQueue)
+FVulkanCommandBufferManager::FVulkanCommandBufferManager(const FVulkanDevice* InDevice, FVulkanQueue* InQueue)
 	:m_Device(InDevice), m_Queue(InQueue)
 {
 	VkCommandPoolCreateInfo poolInfo = {};
@@ -129,34 +184,44 @@ FVulkanCommandBufferManager::~FVulkanCommandBufferManager()
 
 FVulkanCommandBuffer * FVulkanCommandBufferManager::GetNewCommandBuffer()
 {
-	for (int32_t Index = m_FreeCmdBuffers.size() - 1; Index >= 0; --Index)
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Recycled buffers are already allocated and tracked in m_CmdBuffers
+	if (m_FreeCmdBuffers.size() > 0)
 	{
-		FVulkanCommandBuffer* cmdBuffer = m_FreeCmdBuffers[Index];
-		{
-			m_FreeCmdBuffers.erase(m_FreeCmdBuffers.begin() + Index);
-			cmdBuffer->AllocMemory();
-			m_CmdBuffers.push_back(cmdBuffer);
-			return cmdBuffer;
-		}
+		FVulkanCommandBuffer* cmdBuffer = m_FreeCmdBuffers.back();
+		m_FreeCmdBuffers.pop_back();
+		return cmdBuffer;
 	}
 
-	FVulkanCommandBuffer* CmdBuffer = new FVulkanCommandBuffer(m_Device, this);
+	FVulkanCommandBuffer* CmdBuffer = new FVulkanCommandBuffer(m_Device, this, false);
 	CmdBuffer->AllocMemory();
 	m_CmdBuffers.push_back(CmdBuffer);
 
 	return CmdBuffer;
 }
 
-void FVulkanCommandBufferManager::RefreshFenceStatus(FVulkanCommandBuffer * SkipCmdBuffer)
+FVulkanCommandBuffer * FVulkanCommandBufferManager::GetNewSecondaryCommandBuffer()
 {
-	for (int i = 0; i < m_CmdBuffers.size(); ++i)
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (m_FreeSecondaryCmdBuffers.size() > 0)
 	{
-		FVulkanCommandBuffer* cmdBuffer = m_CmdBuffers[i];
-		if (cmdBuffer != SkipCmdBuffer)
-		{
-			cmdBuffer->RefreshFenceStatus();
-		}
+		FVulkanCommandBuffer* cmdBuffer = m_FreeSecondaryCmdBuffers.back();
+		m_FreeSecondaryCmdBuffers.pop_back();
+		return cmdBuffer;
 	}
+
+	FVulkanCommandBuffer* CmdBuffer = new FVulkanCommandBuffer(m_Device, this, true);
+	CmdBuffer->AllocMemory();
+	m_CmdBuffers.push_back(CmdBuffer);
+
+	return CmdBuffer;
+}
+
+void FVulkanCommandBufferManager::RefreshFenceStatus()
+{
+	m_Queue->RefreshFenceStatus();
 }
 
 
@@ -170,6 +235,7 @@ void FVulkanCommandBufferManager::DestoryBuffers()
 		delete CmdBuffer;
 	}
 	m_CmdBuffers.clear();
+	m_FreeSecondaryCmdBuffers.clear();
 
 	/*for (int32_t Index = 0; Index < m_FreeCmdBuffers.size(); ++Index)
 	{
@@ -182,6 +248,13 @@ void FVulkanCommandBufferManager::DestoryBuffers()
 
 void FVulkanCommandBufferManager::CollectUsedBuffer(FVulkanCommandBuffer * InUsedBuffer)
 {
-	m_FreeCmdBuffers.push_back(InUsedBuffer);
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (InUsedBuffer->IsSecondary()) {
+		m_FreeSecondaryCmdBuffers.push_back(InUsedBuffer);
+	}
+	else {
+		m_FreeCmdBuffers.push_back(InUsedBuffer);
+	}
 }
 
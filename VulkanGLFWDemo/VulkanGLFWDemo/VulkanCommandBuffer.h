@@ -1,20 +1,24 @@
 #pragma once
+#include <atomic>
+#include <cstdint>
 #include <memory>
+#include <mutex>
 #include <vector>
 #include <vulkan/vulkan.h>
+#include "VulkanImageState.h"
 
 class FVulkanDevice;
 class FVulkanQueue;
 class FVulkanSemaphore;
-class FVulkanFence;
 
 class FVulkanCommandBuffer
 {
 protected:
 	friend class FVulkanCommandBufferManager;
 	friend class FVulkanQueue;
+	friend class FVulkanParallelRecorder;
 
-	FVulkanCommandBuffer(const FVulkanDevice* InDevice, FVulkanCommandBufferManager* InOwner);
+	FVulkanCommandBuffer(const FVulkanDevice* InDevice, FVulkanCommandBufferManager* InOwner, bool bInIsSecondary);
 	~FVulkanCommandBuffer();
 
 public:
@@ -29,6 +33,11 @@ public:
 		return m_Owner;
 	}
 
+	inline bool IsSecondary() const
+	{
+		return m_bIsSecondary;
+	}
+
 	void AddWaitSemaphore(VkPipelineStageFlags InWaitFlags, const FVulkanSemaphore* InWaitSemaphore);
 	void AddSignalSemaphore(const FVulkanSemaphore* InSignalSemaphore);
 
@@ -43,48 +52,71 @@ public:
 	};
 
 
-	class DelayedTask
-	{
-	public:
-		DelayedTask() {};
-		virtual ~DelayedTask() {};
-
-		virtual void DoTask() {};
-	};
-
-	typedef std::shared_ptr<DelayedTask> DelayedTaskPtr;
-
-	void AddDelayedTask(DelayedTaskPtr InTask);
-
 	void Begin();
+	// Secondary command buffers only, continues the render pass described by InInheritance
+	void BeginSecondary(const VkCommandBufferInheritanceInfo& InInheritance);
 	void End();
 
-	/*void BeginRenderPass();
-	void EndRenderPass();*/
+	void BeginRenderPass(const VkRenderPassBeginInfo& InBeginInfo, VkSubpassContents InContents);
+	void EndRenderPass();
+
+	// Layouts of the images used by this recording, queued transitions are flushed by End() and BeginRenderPass()
+	inline FVulkanImageStateTracker& GetImageStates()
+	{
+		return m_ImageStates;
+	}
+
+	// Executes secondary command buffers from this primary. They are recycled together with it.
+	void ExecuteCommands(FVulkanCommandBuffer* const* InCmdBuffers, uint32_t InNumCmdBuffers);
 
 	inline bool HasBegun() const 
 	{
 		return m_State == EState::IsInsideBegin;
 	}
 
+	inline bool IsInsideRenderPass() const
+	{
+		return m_State == EState::IsInsideRenderPass;
+	}
+
 	inline bool HasEnded() const
 	{
 		return m_State == EState::HasEnded;
 	}
 
+	inline bool IsSubmitted() const
+	{
+		return m_State == EState::Submitted;
+	}
+
+	// Queue serial of the last submission of this command buffer, 0 if it was never submitted
+	inline uint64_t GetSubmittedSerial() const
+	{
+		return m_SubmittedSerial.load(std::memory_order_acquire);
+	}
+
+	// Waits for the last submission of this command buffer
+	void WaitForFence(uint64_t InTimeoutNs = UINT64_MAX);
+
 protected:
-	EState m_State;
-	FVulkanFence* m_Fence;
+	// Set to ReadyForBegin by whichever thread polls the queue, read by the recording thread
+	std::atomic<EState> m_State;
+	// Written by the submitting thread, read by whoever tracks the command buffer
+	std::atomic<uint64_t> m_SubmittedSerial;
 
 	void RefreshFenceStatus();
-
-	std::vector<DelayedTaskPtr> m_DelayedTasks;
+	void MarkSubmitted(uint64_t InSerial);
+	void OnSubmissionCompleted();
 
 private:
 	const FVulkanDevice* m_Device;
 	FVulkanCommandBufferManager* m_Owner;
 
 	VkCommandBuffer m_Handle = VK_NULL_HANDLE;
+	bool m_bIsSecondary;
+
+	std::vector<FVulkanCommandBuffer*> m_ExecutedCmdBuffers;
+	FVulkanImageStateTracker m_ImageStates;
 
 	std::vector<VkPipelineStageFlags> m_WaitFlags;
 	std::vector<VkSemaphore> m_WaitSemaphores;
@@ -101,18 +133,21 @@ private:
 class FVulkanCommandBufferManager
 {
 public:
-	FVulkanCommandBufferManager(const FVulkanDevice* InDevice, const FVulkanQueue* InQueue);
+	FVulkanCommandBufferManager(const FVulkanDevice* InDevice, FVulkanQueue* InQueue);
 	~FVulkanCommandBufferManager();
 
-	inline const FVulkanQueue* GetQueue() const 
+	inline FVulkanQueue* GetQueue() const 
 	{
 		return m_Queue;
 	}
 
+	// Thread safe, command buffers can be recycled from the thread that polls the queue.
+	// Recording itself must stay on the thread owning this manager, one manager per recording thread.
 	FVulkanCommandBuffer* GetNewCommandBuffer();
+	FVulkanCommandBuffer* GetNewSecondaryCommandBuffer();
 
 
-	void RefreshFenceStatus(FVulkanCommandBuffer* SkipCmdBuffer = nullptr);
+	void RefreshFenceStatus();
 
 protected:
 	friend class FVulkanCommandBuffer;
@@ -124,11 +159,13 @@ protected:
 
 private:
 	const FVulkanDevice* m_Device;
-	const FVulkanQueue* m_Queue;
+	FVulkanQueue* m_Queue;
 
 	VkCommandPool m_Pool;
+	std::mutex m_Mutex;
 	std::vector<FVulkanCommandBuffer*> m_CmdBuffers;
 	std::vector<FVulkanCommandBuffer*> m_FreeCmdBuffers;
+	std::vector<FVulkanCommandBuffer*> m_FreeSecondaryCmdBuffers;
 
 	void DestoryBuffers();
 	void CollectUsedBuffer(FVulkanCommandBuffer* InUsedBuffer);
@@ -0,0 +1,166 @@
+#include "VulkanDeletionQueue.h"
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanCommandBuffer.h"
+
+FVulkanDeletionQueue::FVulkanDeletionQueue(const FVulkanDevice * InDevice)
+	:m_Device(InDevice)
+{
+}
+
+FVulkanDeletionQueue::~FVulkanDeletionQueue()
+{
+	ReleaseAll();
+}
+
+void FVulkanDeletionQueue::Enqueue(FVulkanCommandBuffer * InCmdBuffer, EType InType, uint64_t InHandle)
+{
+	FEntry entry = {};
+	entry.Type = InType;
+	entry.Handle = InHandle;
+	entry.CmdBuffer = InCmdBuffer;
+	entry.PrevSerial = InCmdBuffer->GetSubmittedSerial();
+	entry.Queue = InCmdBuffer->GetOwner()->GetQueue();
+	Push(entry);
+}
+
+void FVulkanDeletionQueue::Enqueue(FVulkanQueue * InQueue, uint64_t InSerial, EType InType, uint64_t InHandle)
+{
+	FEntry entry = {};
+	entry.Type = InType;
+	entry.Handle = InHandle;
+	entry.Queue = InQueue;
+	entry.Serial = InSerial;
+	Push(entry);
+}
+
+void FVulkanDeletionQueue::EnqueueAllocation(FVulkanCommandBuffer * InCmdBuffer, const FVulkanAllocation & InAllocation)
+{
+	FEntry entry = {};
+	entry.Type = EType::Allocation;
+	entry.Allocation = InAllocation;
+	entry.CmdBuffer = InCmdBuffer;
+	entry.PrevSerial = InCmdBuffer->GetSubmittedSerial();
+	entry.Queue = InCmdBuffer->GetOwner()->GetQueue();
+	Push(entry);
+}
+
+void FVulkanDeletionQueue::EnqueueAllocation(FVulkanQueue * InQueue, uint64_t InSerial, const FVulkanAllocation & InAllocation)
+{
+	FEntry entry = {};
+	entry.Type = EType::Allocation;
+	entry.Allocation = InAllocation;
+	entry.Queue = InQueue;
+	entry.Serial = InSerial;
+	Push(entry);
+}
+
+void FVulkanDeletionQueue::ReleaseCompleted()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Entries of a queue are pushed in submission order, the first one still in flight ends its queue's scan.
+	// A command buffer submitted out of order only holds back the entries behind it.
+	for (FQueueEntries& queueEntries : m_Queues)
+	{
+		std::deque<FEntry>& entries = queueEntries.Entries;
+		while (!entries.empty() && IsCompleted(entries.front()))
+		{
+			Destroy(entries.front());
+			entries.pop_front();
+		}
+	}
+}
+
+void FVulkanDeletionQueue::ReleaseAll()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	bool bIdle = false;
+	for (FQueueEntries& queueEntries : m_Queues)
+	{
+		if (queueEntries.Entries.empty()) continue;
+
+		if (!bIdle) {
+			vkDeviceWaitIdle(m_Device->GetLogicalDevice());
+			bIdle = true;
+		}
+		for (auto& entry : queueEntries.Entries)
+		{
+			Destroy(entry);
+		}
+		queueEntries.Entries.clear();
+	}
+}
+
+void FVulkanDeletionQueue::Push(const FEntry & InEntry)
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	// Only a few queues ever retire resources
+	for (FQueueEntries& queueEntries : m_Queues)
+	{
+		if (queueEntries.Queue == InEntry.Queue) {
+			queueEntries.Entries.push_back(InEntry);
+			return;
+		}
+	}
+	m_Queues.push_back({ InEntry.Queue, std::deque<FEntry>(1, InEntry) });
+}
+
+bool FVulkanDeletionQueue::IsCompleted(FEntry & InOutEntry) const
+{
+	if (InOutEntry.CmdBuffer) {
+		const uint64_t serial = InOutEntry.CmdBuffer->GetSubmittedSerial();
+		if (serial == InOutEntry.PrevSerial) return false;
+
+		InOutEntry.Serial = serial;
+		InOutEntry.CmdBuffer = nullptr;
+	}
+
+	return InOutEntry.Queue->IsSerialCompleted(InOutEntry.Serial);
+}
+
+void FVulkanDeletionQueue::Destroy(FEntry & InEntry)
+{
+	const VkDevice device = m_Device->GetLogicalDevice();
+
+	switch (InEntry.Type)
+	{
+	case EType::Buffer:
+		vkDestroyBuffer(device, (VkBuffer)InEntry.Handle, nullptr);
+		break;
+	case EType::BufferView:
+		vkDestroyBufferView(device, (VkBufferView)InEntry.Handle, nullptr);
+		break;
+	case EType::Image:
+		vkDestroyImage(device, (VkImage)InEntry.Handle, nullptr);
+		break;
+	case EType::ImageView:
+		vkDestroyImageView(device, (VkImageView)InEntry.Handle, nullptr);
+		break;
+	case EType::Sampler:
+		vkDestroySampler(device, (VkSampler)InEntry.Handle, nullptr);
+		break;
+	case EType::Pipeline:
+		vkDestroyPipeline(device, (VkPipeline)InEntry.Handle, nullptr);
+		break;
+	case EType::PipelineLayout:
+		vkDestroyPipelineLayout(device, (VkPipelineLayout)InEntry.Handle, nullptr);
+		break;
+	case EType::Framebuffer:
+		vkDestroyFramebuffer(device, (VkFramebuffer)InEntry.Handle, nullptr);
+		break;
+	case EType::SwapChain:
+		vkDestroySwapchainKHR(device, (VkSwapchainKHR)InEntry.Handle, nullptr);
+		break;
+	case EType::DeviceMemory:
+		vkFreeMemory(device, (VkDeviceMemory)InEntry.Handle, nullptr);
+		break;
+	case EType::Allocation:
+		m_Device->GetMemoryManager()->Free(InEntry.Allocation);
+		break;
+	default:
+		break;
+	}
+}
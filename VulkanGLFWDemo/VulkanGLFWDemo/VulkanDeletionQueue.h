@@ -0,0 +1,91 @@
+#pragma once
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VulkanMemory.h"
+
+class FVulkanDevice;
+class FVulkanQueue;
+class FVulkanCommandBuffer;
+
+// Keeps resources alive until the GPU is done with them, then destroys them in bulk.
+// Entries are keyed on a queue serial, or on the next submission of a command buffer that
+// has not been submitted yet. Every queue has its own FIFO of plain handles: serials of a queue
+// only grow, so releasing stops at the first entry still in flight and costs only what it retires.
+class FVulkanDeletionQueue
+{
+public:
+	FVulkanDeletionQueue(const FVulkanDevice* InDevice);
+	~FVulkanDeletionQueue();
+
+	enum class EType : uint8_t
+	{
+		Buffer,
+		BufferView,
+		Image,
+		ImageView,
+		Sampler,
+		Pipeline,
+		PipelineLayout,
+		Framebuffer,
+		SwapChain,
+		DeviceMemory,
+		Allocation,
+	};
+
+	// InHandle is the Vulkan handle cast to uint64_t
+	void Enqueue(FVulkanCommandBuffer* InCmdBuffer, EType InType, uint64_t InHandle);
+	void Enqueue(FVulkanQueue* InQueue, uint64_t InSerial, EType InType, uint64_t InHandle);
+
+	// Memory from FVulkanMemoryManager, handed back at the same point
+	void EnqueueAllocation(FVulkanCommandBuffer* InCmdBuffer, const FVulkanAllocation& InAllocation);
+	void EnqueueAllocation(FVulkanQueue* InQueue, uint64_t InSerial, const FVulkanAllocation& InAllocation);
+
+	// Destroys everything the GPU has passed, called whenever a queue retires batches
+	void ReleaseCompleted();
+	// Waits for the device to go idle and destroys everything
+	void ReleaseAll();
+
+	inline uint32_t GetNumPending() const
+	{
+		size_t numPending = 0;
+		for (const FQueueEntries& queueEntries : m_Queues)
+		{
+			numPending += queueEntries.Entries.size();
+		}
+		return static_cast<uint32_t>(numPending);
+	}
+
+private:
+	struct FEntry
+	{
+		EType Type;
+		uint64_t Handle;
+		FVulkanAllocation Allocation;
+
+		// Set until the command buffer has been submitted, then replaced by its queue and serial
+		FVulkanCommandBuffer* CmdBuffer;
+		uint64_t PrevSerial;
+
+		FVulkanQueue* Queue;
+		uint64_t Serial;
+	};
+
+	struct FQueueEntries
+	{
+		FVulkanQueue* Queue;
+		std::deque<FEntry> Entries;
+	};
+
+	void Push(const FEntry& InEntry);
+	bool IsCompleted(FEntry& InOutEntry) const;
+	void Destroy(FEntry& InEntry);
+
+private:
+	const FVulkanDevice* m_Device;
+
+	std::mutex m_Mutex;
+	std::vector<FQueueEntries> m_Queues;
+};
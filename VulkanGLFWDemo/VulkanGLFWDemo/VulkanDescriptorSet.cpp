@@ -15,12 +15,28 @@ bool FVulkanDescriptorSetLayout::AddDescriptor(const VkDescriptorSetLayoutBindin
 	if (InDescriptor.binding == m_LayoutBindings.size()) {
 		m_LayoutTypes[InDescriptor.descriptorType] += InDescriptor.descriptorCount;
 		m_LayoutBindings.push_back(InDescriptor);
+		m_ImmutableSamplers.push_back(std::vector<VkSampler>());
+		if (InDescriptor.pImmutableSamplers) {
+			m_ImmutableSamplers.back().assign(InDescriptor.pImmutableSamplers, InDescriptor.pImmutableSamplers + InDescriptor.descriptorCount);
+		}
 		return true;
 	}
 
 	return false;
 }
 
+bool FVulkanDescriptorSetLayout::AddImmutableSamplerDescriptor(const VkDescriptorSetLayoutBinding & InDescriptor, uint32_t InDescriptorCost)
+{
+	if (InDescriptor.pImmutableSamplers == nullptr) return false;
+	if (InDescriptor.descriptorType != VK_DESCRIPTOR_TYPE_SAMPLER && InDescriptor.descriptorType != VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER) return false;
+	if (!AddDescriptor(InDescriptor)) return false;
+
+	if (InDescriptorCost > 1) {
+		m_LayoutTypes[InDescriptor.descriptorType] += InDescriptor.descriptorCount * (InDescriptorCost - 1);
+	}
+	return true;
+}
+
 uint32_t FVulkanDescriptorSetLayout::GetNextBinding()
 {
 	return m_LayoutBindings.size();
@@ -32,6 +48,7 @@ FVulkanDescriptorSetLayout::FVulkanDescriptorSetLayout(const FVulkanDevice* InDe
 	memcpy(m_LayoutTypes, InLayout.m_LayoutTypes, VK_DESCRIPTOR_TYPE_RANGE_SIZE * sizeof(uint32_t));
 	m_LayoutBindings.resize(InLayout.m_LayoutBindings.size());
 	memcpy(m_LayoutBindings.data(), InLayout.m_LayoutBindings.data(), InLayout.m_LayoutBindings.size() * sizeof(VkDescriptorSetLayoutBinding));
+	m_ImmutableSamplers = InLayout.m_ImmutableSamplers;
 	/*m_Handle = InLayout.m_Handle;
 	m_HandleId = InLayout.m_HandleId;*/
 }
@@ -42,6 +59,11 @@ void FVulkanDescriptorSetLayout::Compile()
 
 	Release();
 
+	for (size_t i = 0; i < m_LayoutBindings.size(); i++)
+	{
+		m_LayoutBindings[i].pImmutableSamplers = m_ImmutableSamplers[i].size() > 0 ? m_ImmutableSamplers[i].data() : nullptr;
+	}
+
 	VkDescriptorSetLayoutCreateInfo layoutInfo = {};
 	layoutInfo.sType = VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO;
 	layoutInfo.bindingCount = static_cast<uint32_t>(m_LayoutBindings.size());
@@ -130,7 +152,7 @@ bool FVulkanDescriptorSet::BindUniformBuffer(uint32_t InBinding, const VkDescrip
 	m_Writes[InBinding].pImageInfo = nullptr;
 	m_Writes[InBinding].pBufferInfo = InBufferInfos;
 	m_Writes[InBinding].pTexelBufferView = nullptr;
-
+	return true;
 }
 
 bool FVulkanDescriptorSet::BindImageSampler(uint32_t InBinding, const VkDescriptorImageInfo * InImageInfos, uint32_t InSize)
@@ -148,6 +170,43 @@ bool FVulkanDescriptorSet::BindImageSampler(uint32_t InBinding, const VkDescript
 	m_Writes[InBinding].pImageInfo = InImageInfos;
 	m_Writes[InBinding].pBufferInfo = nullptr;
 	m_Writes[InBinding].pTexelBufferView = nullptr;
+	return true;
+}
+
+bool FVulkanDescriptorSet::BindStorageBuffer(uint32_t InBinding, const VkDescriptorBufferInfo * InBufferInfos, uint32_t InSize)
+{
+	m_Writes.resize(m_Layout->m_LayoutBindings.size());
+	if (InBinding >= m_Writes.size()) return false;
+	if (m_Layout->m_LayoutBindings[InBinding].descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_BUFFER) return false;
+
+	m_Writes[InBinding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	m_Writes[InBinding].dstSet = m_Handle;
+	m_Writes[InBinding].dstBinding = InBinding;
+	m_Writes[InBinding].dstArrayElement = 0;
+	m_Writes[InBinding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+	m_Writes[InBinding].descriptorCount = InSize;
+	m_Writes[InBinding].pImageInfo = nullptr;
+	m_Writes[InBinding].pBufferInfo = InBufferInfos;
+	m_Writes[InBinding].pTexelBufferView = nullptr;
+	return true;
+}
+
+bool FVulkanDescriptorSet::BindStorageImage(uint32_t InBinding, const VkDescriptorImageInfo * InImageInfos, uint32_t InSize)
+{
+	m_Writes.resize(m_Layout->m_LayoutBindings.size());
+	if (InBinding >= m_Writes.size()) return false;
+	if (m_Layout->m_LayoutBindings[InBinding].descriptorType != VK_DESCRIPTOR_TYPE_STORAGE_IMAGE) return false;
+
+	m_Writes[InBinding].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+	m_Writes[InBinding].dstSet = m_Handle;
+	m_Writes[InBinding].dstBinding = InBinding;
+	m_Writes[InBinding].dstArrayElement = 0;
+	m_Writes[InBinding].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	m_Writes[InBinding].descriptorCount = InSize;
+	m_Writes[InBinding].pImageInfo = InImageInfos;
+	m_Writes[InBinding].pBufferInfo = nullptr;
+	m_Writes[InBinding].pTexelBufferView = nullptr;
+	return true;
 }
 
 void FVulkanDescriptorSet::UpdateBindings()
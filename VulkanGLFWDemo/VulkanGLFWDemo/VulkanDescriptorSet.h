@@ -12,6 +12,9 @@ public:
 	~FVulkanDescriptorSetLayout();
 
 	bool AddDescriptor(const VkDescriptorSetLayoutBinding& InDescriptor);
+	// Immutable sampler handles are copied by both. Samplers with a Ycbcr conversion can take
+	// more than one pool descriptor each, see FVulkanYcbcrTexture2D::GetDescriptorCost.
+	bool AddImmutableSamplerDescriptor(const VkDescriptorSetLayoutBinding& InDescriptor, uint32_t InDescriptorCost = 1);
 	uint32_t GetNextBinding();
 
 protected:
@@ -36,6 +39,8 @@ private:
 
 	uint32_t m_LayoutTypes[VK_DESCRIPTOR_TYPE_RANGE_SIZE];
 	std::vector<VkDescriptorSetLayoutBinding> m_LayoutBindings;
+	// Per binding, pImmutableSamplers is pointed at these when compiling
+	std::vector<std::vector<VkSampler>> m_ImmutableSamplers;
 
 	VkDescriptorSetLayout m_Handle = 0;
 	uint32_t m_HandleId = 0;
@@ -52,8 +57,15 @@ public:
 
 	bool BindUniformBuffer(uint32_t InBinding, const VkDescriptorBufferInfo* InBufferInfos, uint32_t InSize);
 	bool BindImageSampler(uint32_t InBinding, const VkDescriptorImageInfo* InImageInfos, uint32_t InSize);
+	bool BindStorageBuffer(uint32_t InBinding, const VkDescriptorBufferInfo* InBufferInfos, uint32_t InSize);
+	bool BindStorageImage(uint32_t InBinding, const VkDescriptorImageInfo* InImageInfos, uint32_t InSize);
 
 	void UpdateBindings();
+
+	inline VkDescriptorSet GetHandle() const
+	{
+		return m_Handle;
+	}
 	
 
 protected:
@@ -4,6 +4,14 @@
 #include "VulkanUtil.h"
 #include "VulkanDebugger.h"
 #include "VulkanInstance.h"
+#include "VulkanMemory.h"
+#include "VulkanBuffer.h"
+#include "VulkanDeletionQueue.h"
+#include "VulkanMipGenerator.h"
+#include "VulkanSamplerCache.h"
+
+// Enough for a few frames of 1080p RGBA uploads in flight
+static const uint64_t VULKAN_STAGING_RING_SIZE = 64ull * 1024 * 1024;
 
 FVulkanDevice::FVulkanDevice(const FVulkanInstance* Window)
 	:m_Instance(Window)
@@ -12,6 +20,7 @@ FVulkanDevice::FVulkanDevice(const FVulkanInstance* Window)
 
 FVulkanDevice::~FVulkanDevice()
 {
+	Release();
 }
 
 void FVulkanDevice::Setup(const char * InApplicationName, const char * InEngineName)
@@ -21,6 +30,15 @@ void FVulkanDevice::Setup(const char * InApplicationName, const char * InEngineN
 	PickPhysicalDevice();
 	CreateLogicalDevice();
 
+	m_MemoryManager.reset(new FVulkanMemoryManager(this));
+	m_MemoryManager->Setup();
+
+	m_FenceManager.reset(new FVulkanFenceManager(this));
+	m_DeletionQueue.reset(new FVulkanDeletionQueue(this));
+	m_StagingRing.reset(new FVulkanStagingRingBuffer(this, VULKAN_STAGING_RING_SIZE));
+	m_MipGenerator.reset(new FVulkanMipGenerator(this));
+	m_SamplerCache.reset(new FVulkanSamplerCache(this));
+
 	m_DeviceCreated = true;
 }
 
@@ -28,6 +46,14 @@ void FVulkanDevice::Release()
 {
 	if (!m_DeviceCreated) return;
 
+	// Waits for the GPU before destroying what is still pending
+	m_DeletionQueue.reset();
+	m_MipGenerator.reset();
+	m_SamplerCache.reset();
+	m_StagingRing.reset();
+	m_FenceManager.reset();
+	m_MemoryManager.reset();
+
 	vkDestroyDevice(m_LogicalDevice, nullptr);
 
 	m_DeviceCreated = false;
@@ -46,7 +72,7 @@ void FVulkanDevice::PickPhysicalDevice()
 	vkEnumeratePhysicalDevices(m_Instance->GetHandle(), &physical_device_count, physical_devices.data());
 
 	std::vector<const char*> extensions;
-	FVulkanUtil::GetDeviceExtensions(extensions);
+	FVulkanUtil::GetDeviceExtensions(extensions, m_Instance->GetSurface() != VK_NULL_HANDLE);
 
 	for (const auto& physical_device : physical_devices) {
 		if (FVulkanUtil::CheckDeviceSuitable(physical_device, m_Instance->GetSurface(), extensions)) {
@@ -66,6 +92,12 @@ void FVulkanDevice::CreateLogicalDevice()
 
 	std::vector<VkDeviceQueueCreateInfo> queueCreateInfos;
 	std::set<int> uniqueQueueFamilies = { indices.GraphicsIndex, indices.PresentIndex };
+	if (indices.ComputeIndex >= 0) {
+		uniqueQueueFamilies.insert(indices.ComputeIndex);
+	}
+	if (indices.TransferIndex >= 0) {
+		uniqueQueueFamilies.insert(indices.TransferIndex);
+	}
 
 	float queuePriority = 1.0f;
 	for (int queueFamily : uniqueQueueFamilies) {
@@ -81,14 +113,41 @@ void FVulkanDevice::CreateLogicalDevice()
 	VkPhysicalDeviceFeatures deviceFeatures = {};
 	deviceFeatures.samplerAnisotropy = VK_TRUE;
 
+	// Block-compressed textures, whichever families the device has
+	VkPhysicalDeviceFeatures supportedFeatures;
+	vkGetPhysicalDeviceFeatures(m_PhysicalDevice, &supportedFeatures);
+	deviceFeatures.textureCompressionBC = supportedFeatures.textureCompressionBC;
+	deviceFeatures.textureCompressionETC2 = supportedFeatures.textureCompressionETC2;
+	deviceFeatures.textureCompressionASTC_LDR = supportedFeatures.textureCompressionASTC_LDR;
+
+	// Optional, only enabled where the device runs 1.1
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_PhysicalDevice, &properties);
+
+	VkPhysicalDeviceSamplerYcbcrConversionFeatures ycbcrFeatures = {};
+	ycbcrFeatures.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_SAMPLER_YCBCR_CONVERSION_FEATURES;
+	if (properties.apiVersion >= VK_API_VERSION_1_1) {
+		VkPhysicalDeviceFeatures2 features2 = {};
+		features2.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2;
+		features2.pNext = &ycbcrFeatures;
+		vkGetPhysicalDeviceFeatures2(m_PhysicalDevice, &features2);
+	}
+	m_bYcbcrConversionSupported = ycbcrFeatures.samplerYcbcrConversion == VK_TRUE;
+
 	VkDeviceCreateInfo createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_DEVICE_CREATE_INFO;
+	createInfo.pNext = m_bYcbcrConversionSupported ? &ycbcrFeatures : nullptr;
 	createInfo.pQueueCreateInfos = queueCreateInfos.data();
 	createInfo.queueCreateInfoCount = static_cast<uint32_t>(queueCreateInfos.size());
 	createInfo.pEnabledFeatures = &deviceFeatures;
 
 	std::vector<const char*> extensions;
-	FVulkanUtil::GetDeviceExtensions(extensions);
+	FVulkanUtil::GetDeviceExtensions(extensions, m_Instance->GetSurface() != VK_NULL_HANDLE);
+	// Optional, lets the swap chain pace presents by the real refresh period instead of an estimate
+	if (m_Instance->GetSurface() != VK_NULL_HANDLE && FVulkanUtil::CheckDeviceExtensionSupport(m_PhysicalDevice, { VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME })) {
+		extensions.push_back(VK_GOOGLE_DISPLAY_TIMING_EXTENSION_NAME);
+		m_bDisplayTimingSupported = true;
+	}
 	createInfo.enabledExtensionCount = static_cast<uint32_t>(extensions.size());
 	createInfo.ppEnabledExtensionNames = extensions.data();
 
@@ -1,7 +1,14 @@
 #pragma once
+#include <memory>
 #include <vulkan/vulkan.h>
 
 class FVulkanInstance;
+class FVulkanMemoryManager;
+class FVulkanFenceManager;
+class FVulkanStagingRingBuffer;
+class FVulkanDeletionQueue;
+class FVulkanMipGenerator;
+class FVulkanSamplerCache;
 
 class FVulkanDevice
 {
@@ -26,6 +33,40 @@ public:
 	{
 		return m_LogicalDevice;
 	}
+	inline FVulkanMemoryManager* GetMemoryManager() const
+	{
+		return m_MemoryManager.get();
+	}
+	inline FVulkanFenceManager* GetFenceManager() const
+	{
+		return m_FenceManager.get();
+	}
+	inline FVulkanStagingRingBuffer* GetStagingRing() const
+	{
+		return m_StagingRing.get();
+	}
+	inline FVulkanDeletionQueue* GetDeletionQueue() const
+	{
+		return m_DeletionQueue.get();
+	}
+	inline FVulkanMipGenerator* GetMipGenerator() const
+	{
+		return m_MipGenerator.get();
+	}
+	inline FVulkanSamplerCache* GetSamplerCache() const
+	{
+		return m_SamplerCache.get();
+	}
+	// Multi-planar YUV textures sampled through VkSamplerYcbcrConversion (Vulkan 1.1)
+	inline bool IsYcbcrConversionSupported() const
+	{
+		return m_bYcbcrConversionSupported;
+	}
+	// Refresh period of the display a swap chain presents to (VK_GOOGLE_display_timing)
+	inline bool IsDisplayTimingSupported() const
+	{
+		return m_bDisplayTimingSupported;
+	}
 	
 
 
@@ -40,6 +81,15 @@ private:
 	VkDevice m_LogicalDevice;
 
 	bool m_DeviceCreated = false;
+	bool m_bYcbcrConversionSupported = false;
+	bool m_bDisplayTimingSupported = false;
+
+	std::unique_ptr<FVulkanMemoryManager> m_MemoryManager;
+	std::unique_ptr<FVulkanFenceManager> m_FenceManager;
+	std::unique_ptr<FVulkanStagingRingBuffer> m_StagingRing;
+	std::unique_ptr<FVulkanDeletionQueue> m_DeletionQueue;
+	std::unique_ptr<FVulkanMipGenerator> m_MipGenerator;
+	std::unique_ptr<FVulkanSamplerCache> m_SamplerCache;
 
 	VkQueue m_GraphicsQueue;
 	VkQueue m_PresentQueue;
@@ -0,0 +1,152 @@
+#pragma once
+#include <cstdint>
+#include <vulkan/vulkan.h>
+
+// Copy granularity of a format. Uncompressed formats are 1x1 blocks of a single texel,
+// block-compressed ones (BC, ETC2/EAC, ASTC) store BlockWidth x BlockHeight texels in BytesPerBlock bytes.
+struct FVulkanFormatInfo
+{
+	VkFormat Format;
+	uint8_t BlockWidth;
+	uint8_t BlockHeight;
+	uint8_t BytesPerBlock;
+};
+
+static constexpr FVulkanFormatInfo VULKAN_FORMAT_TABLE[] = {
+	{ VK_FORMAT_R8_UNORM, 1, 1, 1 },
+	{ VK_FORMAT_R8_SNORM, 1, 1, 1 },
+	{ VK_FORMAT_R8_UINT, 1, 1, 1 },
+	{ VK_FORMAT_R8_SINT, 1, 1, 1 },
+	{ VK_FORMAT_R8_SRGB, 1, 1, 1 },
+	{ VK_FORMAT_R8G8_UNORM, 1, 1, 2 },
+	{ VK_FORMAT_R8G8_SNORM, 1, 1, 2 },
+	{ VK_FORMAT_R8G8_UINT, 1, 1, 2 },
+	{ VK_FORMAT_R8G8_SINT, 1, 1, 2 },
+	{ VK_FORMAT_R8G8_SRGB, 1, 1, 2 },
+	{ VK_FORMAT_R5G6B5_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_B5G6R5_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_R4G4B4A4_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_B4G4R4A4_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_R5G5B5A1_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_B5G5R5A1_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_A1R5G5B5_UNORM_PACK16, 1, 1, 2 },
+	{ VK_FORMAT_R8G8B8A8_UNORM, 1, 1, 4 },
+	{ VK_FORMAT_R8G8B8A8_SNORM, 1, 1, 4 },
+	{ VK_FORMAT_R8G8B8A8_USCALED, 1, 1, 4 },
+	{ VK_FORMAT_R8G8B8A8_SSCALED, 1, 1, 4 },
+	{ VK_FORMAT_R8G8B8A8_UINT, 1, 1, 4 },
+	{ VK_FORMAT_R8G8B8A8_SINT, 1, 1, 4 },
+	{ VK_FORMAT_R8G8B8A8_SRGB, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_UNORM, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_SNORM, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_USCALED, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_SSCALED, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_UINT, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_SINT, 1, 1, 4 },
+	{ VK_FORMAT_B8G8R8A8_SRGB, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_UNORM_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_SNORM_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_USCALED_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_SSCALED_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_UINT_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_SINT_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A8B8G8R8_SRGB_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A2R10G10B10_UNORM_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_A2B10G10R10_UNORM_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_B10G11R11_UFLOAT_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_E5B9G9R9_UFLOAT_PACK32, 1, 1, 4 },
+	{ VK_FORMAT_R16_UNORM, 1, 1, 2 },
+	{ VK_FORMAT_R16_SFLOAT, 1, 1, 2 },
+	{ VK_FORMAT_R16G16_UNORM, 1, 1, 4 },
+	{ VK_FORMAT_R16G16_SFLOAT, 1, 1, 4 },
+	{ VK_FORMAT_R16G16B16A16_UNORM, 1, 1, 8 },
+	{ VK_FORMAT_R16G16B16A16_SFLOAT, 1, 1, 8 },
+	{ VK_FORMAT_R32_UINT, 1, 1, 4 },
+	{ VK_FORMAT_R32_SFLOAT, 1, 1, 4 },
+	{ VK_FORMAT_R32G32_SFLOAT, 1, 1, 8 },
+	{ VK_FORMAT_R32G32B32A32_SFLOAT, 1, 1, 16 },
+
+	{ VK_FORMAT_BC1_RGB_UNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_BC1_RGB_SRGB_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_BC1_RGBA_UNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_BC1_RGBA_SRGB_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_BC2_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC2_SRGB_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC3_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC3_SRGB_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC4_UNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_BC4_SNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_BC5_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC5_SNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC6H_UFLOAT_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC6H_SFLOAT_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC7_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_BC7_SRGB_BLOCK, 4, 4, 16 },
+
+	{ VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_EAC_R11_UNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_EAC_R11_SNORM_BLOCK, 4, 4, 8 },
+	{ VK_FORMAT_EAC_R11G11_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_EAC_R11G11_SNORM_BLOCK, 4, 4, 16 },
+
+	{ VK_FORMAT_ASTC_4x4_UNORM_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_ASTC_4x4_SRGB_BLOCK, 4, 4, 16 },
+	{ VK_FORMAT_ASTC_5x4_UNORM_BLOCK, 5, 4, 16 },
+	{ VK_FORMAT_ASTC_5x4_SRGB_BLOCK, 5, 4, 16 },
+	{ VK_FORMAT_ASTC_5x5_UNORM_BLOCK, 5, 5, 16 },
+	{ VK_FORMAT_ASTC_5x5_SRGB_BLOCK, 5, 5, 16 },
+	{ VK_FORMAT_ASTC_6x5_UNORM_BLOCK, 6, 5, 16 },
+	{ VK_FORMAT_ASTC_6x5_SRGB_BLOCK, 6, 5, 16 },
+	{ VK_FORMAT_ASTC_6x6_UNORM_BLOCK, 6, 6, 16 },
+	{ VK_FORMAT_ASTC_6x6_SRGB_BLOCK, 6, 6, 16 },
+	{ VK_FORMAT_ASTC_8x5_UNORM_BLOCK, 8, 5, 16 },
+	{ VK_FORMAT_ASTC_8x5_SRGB_BLOCK, 8, 5, 16 },
+	{ VK_FORMAT_ASTC_8x6_UNORM_BLOCK, 8, 6, 16 },
+	{ VK_FORMAT_ASTC_8x6_SRGB_BLOCK, 8, 6, 16 },
+	{ VK_FORMAT_ASTC_8x8_UNORM_BLOCK, 8, 8, 16 },
+	{ VK_FORMAT_ASTC_8x8_SRGB_BLOCK, 8, 8, 16 },
+	{ VK_FORMAT_ASTC_10x5_UNORM_BLOCK, 10, 5, 16 },
+	{ VK_FORMAT_ASTC_10x5_SRGB_BLOCK, 10, 5, 16 },
+	{ VK_FORMAT_ASTC_10x6_UNORM_BLOCK, 10, 6, 16 },
+	{ VK_FORMAT_ASTC_10x6_SRGB_BLOCK, 10, 6, 16 },
+	{ VK_FORMAT_ASTC_10x8_UNORM_BLOCK, 10, 8, 16 },
+	{ VK_FORMAT_ASTC_10x8_SRGB_BLOCK, 10, 8, 16 },
+	{ VK_FORMAT_ASTC_10x10_UNORM_BLOCK, 10, 10, 16 },
+	{ VK_FORMAT_ASTC_10x10_SRGB_BLOCK, 10, 10, 16 },
+	{ VK_FORMAT_ASTC_12x10_UNORM_BLOCK, 12, 10, 16 },
+	{ VK_FORMAT_ASTC_12x10_SRGB_BLOCK, 12, 10, 16 },
+	{ VK_FORMAT_ASTC_12x12_UNORM_BLOCK, 12, 12, 16 },
+	{ VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 12, 12, 16 },
+};
+
+// Unknown formats come back with BytesPerBlock 0
+constexpr FVulkanFormatInfo GetVulkanFormatInfo(VkFormat InFormat)
+{
+	for (const FVulkanFormatInfo& info : VULKAN_FORMAT_TABLE)
+	{
+		if (info.Format == InFormat) return info;
+	}
+	return FVulkanFormatInfo{ InFormat, 1, 1, 0 };
+}
+
+constexpr bool IsVulkanFormatCompressed(VkFormat InFormat)
+{
+	const FVulkanFormatInfo info = GetVulkanFormatInfo(InFormat);
+	return info.BlockWidth > 1 || info.BlockHeight > 1;
+}
+
+// Bytes of one tightly packed InWidth x InHeight layer, partial blocks at the edges count as whole ones
+constexpr VkDeviceSize GetVulkanFormatImageSize(VkFormat InFormat, uint32_t InWidth, uint32_t InHeight)
+{
+	const FVulkanFormatInfo info = GetVulkanFormatInfo(InFormat);
+	return (VkDeviceSize)((InWidth + info.BlockWidth - 1) / info.BlockWidth) * ((InHeight + info.BlockHeight - 1) / info.BlockHeight) * info.BytesPerBlock;
+}
+
+static_assert(GetVulkanFormatInfo(VK_FORMAT_R8G8B8A8_UNORM).BytesPerBlock == 4, "RGBA8 is 4 bytes per texel");
+static_assert(GetVulkanFormatImageSize(VK_FORMAT_BC1_RGB_UNORM_BLOCK, 6, 6) == 4 * 8, "BC1 rounds up to whole 4x4 blocks");
+static_assert(GetVulkanFormatImageSize(VK_FORMAT_ASTC_12x12_SRGB_BLOCK, 1, 1) == 16, "ASTC 12x12 is one block");
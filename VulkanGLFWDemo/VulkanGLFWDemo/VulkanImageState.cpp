@@ -0,0 +1,203 @@
+#include "VulkanImageState.h"
+#include <algorithm>
+#include <stdexcept>
+
+namespace
+{
+	const VkAccessFlags WriteAccess = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+		VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+}
+
+FVulkanImageStateTracker::FState FVulkanImageStateTracker::GetLayoutState(VkImageLayout InLayout)
+{
+	switch (InLayout)
+	{
+	case VK_IMAGE_LAYOUT_UNDEFINED:
+	case VK_IMAGE_LAYOUT_PREINITIALIZED:
+		return { InLayout, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, 0 };
+	case VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL:
+		return { InLayout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_WRITE_BIT };
+	case VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL:
+		return { InLayout, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT };
+	case VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL:
+		return { InLayout, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT };
+	case VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL:
+		return { InLayout, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT };
+	case VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL:
+		return { InLayout, VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT,
+			VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT };
+	case VK_IMAGE_LAYOUT_PRESENT_SRC_KHR:
+		return { InLayout, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0 };
+	default:
+		return { InLayout, VK_PIPELINE_STAGE_ALL_COMMANDS_BIT, VK_ACCESS_MEMORY_READ_BIT | VK_ACCESS_MEMORY_WRITE_BIT };
+	}
+}
+
+void FVulkanImageStateTracker::Reset(VkCommandBuffer InCmdBuffer)
+{
+	m_CmdBuffer = InCmdBuffer;
+	m_Images.clear();
+	m_PendingBarriers.clear();
+	m_SrcStages = 0;
+	m_DstStages = 0;
+	m_NumBarrierCalls = 0;
+	m_NumImageBarriers = 0;
+}
+
+void FVulkanImageStateTracker::Transition(VkImage InImage, const VkImageSubresourceRange & InRange, VkImageLayout InOldLayout, const FState & InState)
+{
+	if (InState.Layout == VK_IMAGE_LAYOUT_UNDEFINED || InState.Layout == VK_IMAGE_LAYOUT_PREINITIALIZED) {
+		throw std::invalid_argument("unsupported layout transition!");
+	}
+
+	FImage& image = GetImage(InImage, InRange);
+	const uint32_t endLevel = InRange.baseMipLevel + InRange.levelCount;
+	const uint32_t endLayer = InRange.baseArrayLayer + InRange.layerCount;
+
+	// A subresource can only be in one queued barrier, the earlier one has to be recorded first
+	bool bPending = false;
+	for (uint32_t level = InRange.baseMipLevel; level < endLevel && !bPending; level++) {
+		for (uint32_t layer = InRange.baseArrayLayer; layer < endLayer && !bPending; layer++) {
+			bPending = image.At(level, layer).bPending;
+		}
+	}
+	if (bPending) {
+		Flush();
+	}
+
+	const FState unknownState = GetLayoutState(InOldLayout);
+	const bool bWrite = (InState.Access & WriteAccess) != 0;
+	const size_t firstBarrier = m_PendingBarriers.size();
+
+	for (uint32_t level = InRange.baseMipLevel; level < endLevel; level++)
+	{
+		for (uint32_t layer = InRange.baseArrayLayer; layer < endLayer; layer++)
+		{
+			FSubresource& subresource = image.At(level, layer);
+			const FState oldState = subresource.bKnown ? subresource.State : unknownState;
+			subresource.bKnown = true;
+
+			// Reads in the layout it already has only widen what a later writer waits for
+			if (oldState.Layout == InState.Layout && !bWrite && (oldState.Access & WriteAccess) == 0) {
+				subresource.State.Layout = InState.Layout;
+				subresource.State.Stages = oldState.Stages | InState.Stages;
+				subresource.State.Access = oldState.Access | InState.Access;
+				continue;
+			}
+
+			subresource.State = InState;
+			subresource.bPending = true;
+			m_SrcStages |= oldState.Stages;
+			m_DstStages |= InState.Stages;
+
+			// Neighbouring layers of one level coming from the same state share a barrier
+			if (m_PendingBarriers.size() > firstBarrier) {
+				VkImageMemoryBarrier& last = m_PendingBarriers.back();
+				if (last.subresourceRange.baseMipLevel == level && last.subresourceRange.levelCount == 1 &&
+					last.subresourceRange.baseArrayLayer + last.subresourceRange.layerCount == layer &&
+					last.oldLayout == oldState.Layout && last.srcAccessMask == oldState.Access) {
+					last.subresourceRange.layerCount++;
+					continue;
+				}
+			}
+
+			VkImageMemoryBarrier barrier = {};
+			barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+			barrier.srcAccessMask = oldState.Access;
+			barrier.dstAccessMask = InState.Access;
+			barrier.oldLayout = oldState.Layout;
+			barrier.newLayout = InState.Layout;
+			barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+			barrier.image = InImage;
+			barrier.subresourceRange = { InRange.aspectMask, level, 1, layer, 1 };
+			m_PendingBarriers.push_back(barrier);
+		}
+	}
+
+	// Then the same layer range on consecutive levels becomes one barrier over those levels
+	size_t merged = firstBarrier;
+	for (size_t i = firstBarrier; i < m_PendingBarriers.size(); i++)
+	{
+		const VkImageMemoryBarrier& barrier = m_PendingBarriers[i];
+		if (merged > firstBarrier) {
+			VkImageMemoryBarrier& previous = m_PendingBarriers[merged - 1];
+			if (previous.subresourceRange.baseMipLevel + previous.subresourceRange.levelCount == barrier.subresourceRange.baseMipLevel &&
+				previous.subresourceRange.baseArrayLayer == barrier.subresourceRange.baseArrayLayer &&
+				previous.subresourceRange.layerCount == barrier.subresourceRange.layerCount &&
+				previous.oldLayout == barrier.oldLayout && previous.srcAccessMask == barrier.srcAccessMask) {
+				previous.subresourceRange.levelCount++;
+				continue;
+			}
+		}
+		m_PendingBarriers[merged++] = barrier;
+	}
+	m_PendingBarriers.resize(merged);
+}
+
+void FVulkanImageStateTracker::SetState(VkImage InImage, const VkImageSubresourceRange & InRange, const FState & InState)
+{
+	FImage& image = GetImage(InImage, InRange);
+	for (uint32_t level = InRange.baseMipLevel; level < InRange.baseMipLevel + InRange.levelCount; level++) {
+		for (uint32_t layer = InRange.baseArrayLayer; layer < InRange.baseArrayLayer + InRange.layerCount; layer++) {
+			FSubresource& subresource = image.At(level, layer);
+			subresource.State = InState;
+			subresource.bKnown = true;
+		}
+	}
+}
+
+void FVulkanImageStateTracker::Flush()
+{
+	if (m_PendingBarriers.empty()) return;
+
+	// Nothing accessed the image before, e.g. coming from UNDEFINED
+	VkPipelineStageFlags srcStages = m_SrcStages;
+	if (!srcStages) {
+		srcStages = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+	}
+	vkCmdPipelineBarrier(m_CmdBuffer, srcStages, m_DstStages, 0,
+		0, nullptr,
+		0, nullptr,
+		static_cast<uint32_t>(m_PendingBarriers.size()), m_PendingBarriers.data());
+
+	m_NumBarrierCalls++;
+	m_NumImageBarriers += static_cast<uint32_t>(m_PendingBarriers.size());
+
+	for (const VkImageMemoryBarrier& barrier : m_PendingBarriers)
+	{
+		FImage& image = m_Images[barrier.image];
+		const VkImageSubresourceRange& range = barrier.subresourceRange;
+		for (uint32_t level = range.baseMipLevel; level < range.baseMipLevel + range.levelCount; level++) {
+			for (uint32_t layer = range.baseArrayLayer; layer < range.baseArrayLayer + range.layerCount; layer++) {
+				image.At(level, layer).bPending = false;
+			}
+		}
+	}
+
+	m_PendingBarriers.clear();
+	m_SrcStages = 0;
+	m_DstStages = 0;
+}
+
+FVulkanImageStateTracker::FImage & FVulkanImageStateTracker::GetImage(VkImage InImage, const VkImageSubresourceRange & InRange)
+{
+	FImage& image = m_Images[InImage];
+
+	const uint32_t levels = std::max(image.Levels, InRange.baseMipLevel + InRange.levelCount);
+	const uint32_t layers = std::max(image.Layers, InRange.baseArrayLayer + InRange.layerCount);
+	if (levels != image.Levels || layers != image.Layers)
+	{
+		// Subresources outside the old size start out unknown
+		std::vector<FSubresource> subresources((size_t)levels * layers, FSubresource{ FState{ VK_IMAGE_LAYOUT_UNDEFINED, 0, 0 }, false, false });
+		for (uint32_t level = 0; level < image.Levels; level++) {
+			for (uint32_t layer = 0; layer < image.Layers; layer++) {
+				subresources[(size_t)level * layers + layer] = image.At(level, layer);
+			}
+		}
+		image.Levels = levels;
+		image.Layers = layers;
+		image.Subresources.swap(subresources);
+	}
+	return image;
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Layout and last access of every image subresource a command buffer touches. Transitions are only
+// queued, Flush() records everything queued as a single vkCmdPipelineBarrier right before the images
+// are used, with the stages that really accessed them instead of a fixed conservative mask.
+// Subresources already in the requested layout and only read get no barrier at all.
+// FVulkanCommandBuffer owns one and flushes it in End() and BeginRenderPass(), anything else
+// recording commands that use an image (copies, clears, dispatches, raw barriers) flushes first.
+class FVulkanImageStateTracker
+{
+public:
+	struct FState
+	{
+		VkImageLayout Layout;
+		VkPipelineStageFlags Stages;
+		VkAccessFlags Access;
+	};
+
+	// Stages and access an image in InLayout is normally used with, e.g. fragment shader reads for SHADER_READ_ONLY
+	static FState GetLayoutState(VkImageLayout InLayout);
+
+	// Starts a new recording into InCmdBuffer, nothing is known about any image
+	void Reset(VkCommandBuffer InCmdBuffer);
+
+	// Queues a transition of InRange to InState. InOldLayout is only used for subresources this command
+	// buffer hasn't seen yet, it's what the caller knows from earlier submissions (UNDEFINED discards).
+	// Transitions still queued for the same subresources are flushed first.
+	void Transition(VkImage InImage, const VkImageSubresourceRange& InRange, VkImageLayout InOldLayout, const FState& InState);
+
+	// Records that commands outside the tracker (raw barriers, render passes) left InRange in InState.
+	// Flush() has to be called before recording them.
+	void SetState(VkImage InImage, const VkImageSubresourceRange& InRange, const FState& InState);
+
+	// Records the queued transitions, if any, as one barrier
+	void Flush();
+
+	inline uint32_t GetNumPending() const
+	{
+		return static_cast<uint32_t>(m_PendingBarriers.size());
+	}
+	// Barrier calls and image barriers recorded since Reset()
+	inline uint32_t GetNumBarrierCalls() const
+	{
+		return m_NumBarrierCalls;
+	}
+	inline uint32_t GetNumImageBarriers() const
+	{
+		return m_NumImageBarriers;
+	}
+
+private:
+	struct FSubresource
+	{
+		FState State;
+		bool bKnown;
+		bool bPending;
+	};
+
+	// Subresources level by level, grown to whatever range has been used
+	struct FImage
+	{
+		uint32_t Levels = 0;
+		uint32_t Layers = 0;
+		std::vector<FSubresource> Subresources;
+
+		FSubresource& At(uint32_t InLevel, uint32_t InLayer)
+		{
+			return Subresources[(size_t)InLevel * Layers + InLayer];
+		}
+	};
+
+	FImage& GetImage(VkImage InImage, const VkImageSubresourceRange& InRange);
+
+private:
+	VkCommandBuffer m_CmdBuffer = VK_NULL_HANDLE;
+
+	std::unordered_map<VkImage, FImage> m_Images;
+
+	std::vector<VkImageMemoryBarrier> m_PendingBarriers;
+	VkPipelineStageFlags m_SrcStages = 0;
+	VkPipelineStageFlags m_DstStages = 0;
+
+	uint32_t m_NumBarrierCalls = 0;
+	uint32_t m_NumImageBarriers = 0;
+};
@@ -39,7 +39,9 @@ void FVulkanInstance::Release()
 		m_Debugger->DestoryDebugCallback(m_Handle);
 		m_Debugger.reset();
 	}
-	vkDestroySurfaceKHR(m_Handle, m_Surface, nullptr);
+	if (m_Surface != VK_NULL_HANDLE) {
+		vkDestroySurfaceKHR(m_Handle, m_Surface, nullptr);
+	}
 	vkDestroyInstance(m_Handle, nullptr);
 
 	m_InstanceCreated = false;
@@ -62,7 +64,8 @@ void FVulkanInstance::CreateInstance(const char * InApplicationName, const char
 	app_info.applicationVersion = 1;
 	app_info.pEngineName = InEngineName;
 	app_info.engineVersion = 1;
-	app_info.apiVersion = VK_API_VERSION_1_0;
+	// 1.1 for sampler Ycbcr conversion, devices still only have to support 1.0
+	app_info.apiVersion = VK_API_VERSION_1_1;
 
 	// initialize the VkInstanceCreateInfo structure
 	VkInstanceCreateInfo create_info = {};
@@ -76,7 +79,9 @@ void FVulkanInstance::CreateInstance(const char * InApplicationName, const char
 	create_info.ppEnabledLayerNames = NULL;
 
 	std::vector<const char*> extensions;
-	FVulkanUtil::GetInstanceExtensions(extensions);
+	if (!m_Window->IsHeadless()) {
+		FVulkanUtil::GetInstanceExtensions(extensions);
+	}
 	if (m_Debugger) {
 		extensions.push_back(VK_EXT_DEBUG_REPORT_EXTENSION_NAME);
 	}
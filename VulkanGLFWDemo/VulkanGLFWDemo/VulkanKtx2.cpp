@@ -0,0 +1,121 @@
+#include "VulkanKtx2.h"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include "VulkanFormat.h"
+
+namespace
+{
+	const uint8_t Ktx2Identifier[12] = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+	// Little endian on disk, like every platform this runs on
+	struct FKtx2Header
+	{
+		uint8_t Identifier[12];
+		uint32_t VkFormat;
+		uint32_t TypeSize;
+		uint32_t PixelWidth;
+		uint32_t PixelHeight;
+		uint32_t PixelDepth;
+		uint32_t LayerCount;
+		uint32_t FaceCount;
+		uint32_t LevelCount;
+		uint32_t SupercompressionScheme;
+
+		uint32_t DfdByteOffset;
+		uint32_t DfdByteLength;
+		uint32_t KvdByteOffset;
+		uint32_t KvdByteLength;
+		uint64_t SgdByteOffset;
+		uint64_t SgdByteLength;
+	};
+
+	struct FKtx2LevelIndex
+	{
+		uint64_t ByteOffset;
+		uint64_t ByteLength;
+		uint64_t UncompressedByteLength;
+	};
+
+	static_assert(sizeof(FKtx2Header) == 80, "KTX2 header is 80 bytes");
+	static_assert(sizeof(FKtx2LevelIndex) == 24, "KTX2 level index entries are 24 bytes");
+}
+
+void FVulkanKtx2Loader::LoadFromFile(const char * InPath, FVulkanTextureData & OutData)
+{
+	std::ifstream file(InPath, std::ios::ate | std::ios::binary);
+
+	if (!file.is_open()) {
+		throw std::runtime_error("failed to open KTX2 file!");
+	}
+
+	std::vector<uint8_t> fileData((size_t)file.tellg());
+	file.seekg(0);
+	file.read(reinterpret_cast<char*>(fileData.data()), fileData.size());
+	file.close();
+
+	LoadFromMemory(std::move(fileData), OutData);
+}
+
+void FVulkanKtx2Loader::LoadFromMemory(std::vector<uint8_t>&& InFileData, FVulkanTextureData & OutData)
+{
+	FKtx2Header header;
+	if (InFileData.size() < sizeof(header)) {
+		throw std::runtime_error("failed to load KTX2, file is truncated!");
+	}
+	memcpy(&header, InFileData.data(), sizeof(header));
+
+	if (memcmp(header.Identifier, Ktx2Identifier, sizeof(Ktx2Identifier)) != 0) {
+		throw std::runtime_error("failed to load KTX2, not a KTX2 file!");
+	}
+	if (header.SupercompressionScheme != 0) {
+		throw std::runtime_error("failed to load KTX2, supercompressed files are not supported!");
+	}
+	if (header.PixelDepth > 1 || header.FaceCount != 1) {
+		throw std::runtime_error("failed to load KTX2, only 2D textures are supported!");
+	}
+
+	const VkFormat format = static_cast<VkFormat>(header.VkFormat);
+	const FVulkanFormatInfo formatInfo = GetVulkanFormatInfo(format);
+	if (format == VK_FORMAT_UNDEFINED || formatInfo.BytesPerBlock == 0) {
+		throw std::runtime_error("failed to load KTX2, unsupported format!");
+	}
+	if (header.PixelWidth == 0 || header.PixelHeight == 0) {
+		throw std::runtime_error("failed to load KTX2, texture has no size!");
+	}
+
+	// A level count of 0 asks the loader to generate mips, the file itself only has level 0
+	const uint32_t numLevels = header.LevelCount > 0 ? header.LevelCount : 1;
+	const uint32_t numLayers = header.LayerCount > 0 ? header.LayerCount : 1;
+
+	const size_t indexEnd = sizeof(header) + (size_t)numLevels * sizeof(FKtx2LevelIndex);
+	if (InFileData.size() < indexEnd) {
+		throw std::runtime_error("failed to load KTX2, file is truncated!");
+	}
+
+	OutData.Format = format;
+	OutData.Width = header.PixelWidth;
+	OutData.Height = header.PixelHeight;
+	OutData.Layers = numLayers;
+	OutData.Levels.resize(numLevels);
+
+	for (uint32_t level = 0; level < numLevels; level++)
+	{
+		FKtx2LevelIndex index;
+		memcpy(&index, InFileData.data() + sizeof(header) + level * sizeof(FKtx2LevelIndex), sizeof(index));
+
+		const uint32_t width = std::max(header.PixelWidth >> level, 1u);
+		const uint32_t height = std::max(header.PixelHeight >> level, 1u);
+		const VkDeviceSize expectedSize = GetVulkanFormatImageSize(format, width, height) * numLayers;
+
+		if (index.ByteLength != expectedSize || index.ByteOffset > InFileData.size() || index.ByteLength > InFileData.size() - index.ByteOffset) {
+			throw std::runtime_error("failed to load KTX2, level data doesn't match the header!");
+		}
+
+		OutData.Levels[level].Offset = index.ByteOffset;
+		OutData.Levels[level].Size = index.ByteLength;
+	}
+
+	OutData.Data = std::move(InFileData);
+}
@@ -0,0 +1,35 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// A 2D texture with all its mip levels in memory, in the layout vkCmdCopyBufferToImage reads:
+// every level holds its array layers one after another, each tightly packed in whole blocks.
+struct FVulkanTextureData
+{
+	struct FLevel
+	{
+		VkDeviceSize Offset;
+		VkDeviceSize Size;
+	};
+
+	VkFormat Format = VK_FORMAT_UNDEFINED;
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	uint32_t Layers = 1;
+
+	// Level 0 is the full resolution one, offsets point into Data
+	std::vector<FLevel> Levels;
+	std::vector<uint8_t> Data;
+};
+
+// Reads KTX2 containers (https://registry.khronos.org/KTX/specs/2.0/ktxspec.v2.html).
+// Only content the GPU can copy as it is is accepted: a Vulkan format, no supercompression
+// (Basis Universal or Zstandard), no cube maps and no 3D textures. Errors throw std::runtime_error.
+class FVulkanKtx2Loader
+{
+public:
+	static void LoadFromFile(const char* InPath, FVulkanTextureData& OutData);
+	// Takes over InFileData, the levels stay where they are in the file
+	static void LoadFromMemory(std::vector<uint8_t>&& InFileData, FVulkanTextureData& OutData);
+};
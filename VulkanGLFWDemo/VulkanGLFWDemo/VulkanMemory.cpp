@@ -1,8 +1,55 @@
 #include "VulkanMemory.h"
 #include <iostream>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VulkanUtil.h"
 #include "VulkanInstance.h"
 #include "VulkanDevice.h"
 
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+// Heaps are 64MB by default; small memory heaps (e.g. the 256MB host visible device local heap) use an eighth of their size.
+static const VkDeviceSize VULKAN_DEFAULT_HEAP_BLOCK_SIZE = 64ull * 1024 * 1024;
+static const VkDeviceSize VULKAN_SMALL_HEAP_THRESHOLD = 1024ull * 1024 * 1024;
+
+static inline uint32_t VulkanBitScanMsb64(uint64_t InValue)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanReverse64(&index, InValue);
+	return index;
+#elif defined(__GNUC__) || defined(__clang__)
+	return 63 - __builtin_clzll(InValue);
+#else
+	uint32_t index = 0;
+	while (InValue >>= 1) index++;
+	return index;
+#endif
+}
+
+static inline uint32_t VulkanBitScanLsb64(uint64_t InValue)
+{
+#if defined(_MSC_VER) && defined(_WIN64)
+	unsigned long index;
+	_BitScanForward64(&index, InValue);
+	return index;
+#elif defined(__GNUC__) || defined(__clang__)
+	return __builtin_ctzll(InValue);
+#else
+	uint32_t index = 0;
+	while (!(InValue & 1)) { InValue >>= 1; index++; }
+	return index;
+#endif
+}
+
+static inline VkDeviceSize VulkanAlignUp(VkDeviceSize InValue, VkDeviceSize InAlignment)
+{
+	return InAlignment > 1 ? (InValue + InAlignment - 1) / InAlignment * InAlignment : InValue;
+}
+
 FVulkanSemaphore::FVulkanSemaphore(const FVulkanDevice * InDevice)
 	:m_Device(InDevice),m_Handle(VK_NULL_HANDLE)
 {
@@ -29,7 +76,7 @@ FVulkanFence::~FVulkanFence()
 
 void FVulkanFence::Allocate(bool bCreateSignaled)
 {
-	VkFenceCreateInfo Info;
+	VkFenceCreateInfo Info = {};
 	Info.sType = VK_STRUCTURE_TYPE_FENCE_CREATE_INFO;
 	Info.flags = bCreateSignaled ? VK_FENCE_CREATE_SIGNALED_BIT : 0;
 	m_State = bCreateSignaled ? EState::Signaled : EState::NotReady;
@@ -50,6 +97,18 @@ void FVulkanFence::Reset()
 	}
 }
 
+bool FVulkanFence::Wait(uint64_t InTimeoutNs)
+{
+	if (m_State == EState::Signaled) return true;
+
+	VkResult Result = vkWaitForFences(m_Device->GetLogicalDevice(), 1, &m_Handle, VK_TRUE, InTimeoutNs);
+	if (Result == VK_SUCCESS) {
+		m_State = EState::Signaled;
+		return true;
+	}
+	return false;
+}
+
 bool FVulkanFence::CheckState()
 {
 	if (m_State == EState::NotReady) {
@@ -84,14 +143,17 @@ FVulkanFenceManager::~FVulkanFenceManager()
 
 FVulkanFence * FVulkanFenceManager::GetNewFence(bool bCreateSignaled)
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
 	if (m_FreeFences.size() != 0)
 	{
-		FVulkanFence* Fence = m_FreeFences[0];
-		m_FreeFences.erase(m_FreeFences.begin());
+		FVulkanFence* Fence = m_FreeFences.back();
+		m_FreeFences.pop_back();
 
-		if (bCreateSignaled)
+		// Free fences are still signaled, see ReleaseFence
+		if (!bCreateSignaled)
 		{
-			Fence->m_State = FVulkanFence::EState::Signaled;
+			Fence->Reset();
 		}
 		return Fence;
 	}
@@ -103,8 +165,16 @@ FVulkanFence * FVulkanFenceManager::GetNewFence(bool bCreateSignaled)
 	return NewFence;
 }
 
+void FVulkanFenceManager::ReleaseFence(FVulkanFence * InFence)
+{
+	// Not reset until it is handed out again: another thread may still be
+	// waiting on the handle and must not see it go back to unsignaled
+	CollectFreeFence(InFence);
+}
+
 void FVulkanFenceManager::CollectFreeFence(FVulkanFence * InFence)
 {
+	std::lock_guard<std::mutex> lock(m_Mutex);
 	m_FreeFences.push_back(InFence);
 }
 
@@ -120,3 +190,425 @@ void FVulkanFenceManager::DestoryFences()
 	m_Fences.clear();
 	m_FreeFences.clear();
 }
+
+
+FVulkanResourceHeap::FVulkanResourceHeap(const FVulkanDevice* InDevice, VkDeviceMemory InMemory, uint32_t InMemoryTypeIndex, VkDeviceSize InSize, void* InMappedData)
+	:m_Device(InDevice), m_Memory(InMemory), m_MemoryTypeIndex(InMemoryTypeIndex), m_Size(InSize), m_UsedSize(0), m_MappedData(InMappedData), m_FLBitmap(0)
+{
+	memset(m_SLBitmap, 0, sizeof(m_SLBitmap));
+	for (uint32_t fl = 0; fl < FL_COUNT; fl++) {
+		for (uint32_t sl = 0; sl < SL_COUNT; sl++) {
+			m_FreeHeads[fl][sl] = INVALID_NODE;
+		}
+	}
+
+	uint32_t rootIndex = AcquireNode();
+	FNode& root = m_Nodes[rootIndex];
+	root.Offset = 0;
+	root.Size = m_Size;
+	root.PrevPhysical = INVALID_NODE;
+	root.NextPhysical = INVALID_NODE;
+	root.bFree = true;
+	InsertFreeNode(rootIndex);
+}
+
+FVulkanResourceHeap::~FVulkanResourceHeap()
+{
+	// Freeing the memory implicitly unmaps it
+	vkFreeMemory(m_Device->GetLogicalDevice(), m_Memory, nullptr);
+}
+
+bool FVulkanResourceHeap::TryAllocate(VkDeviceSize InSize, VkDeviceSize InAlignment, FVulkanAllocation & OutAllocation)
+{
+	VkDeviceSize searchSize = InSize + (InAlignment > 1 ? InAlignment - 1 : 0);
+	if (searchSize > m_Size - m_UsedSize) return false;
+
+	uint32_t fl, sl;
+	MappingSearch(searchSize, fl, sl);
+	if (fl >= FL_COUNT) return false;
+
+	uint32_t index = FindFreeNode(fl, sl);
+	if (index == INVALID_NODE) return false;
+
+	RemoveFreeNode(index);
+
+	// Split off the front padding needed for the alignment as a free node of its own
+	VkDeviceSize padding = VulkanAlignUp(m_Nodes[index].Offset, InAlignment) - m_Nodes[index].Offset;
+	if (padding > 0) {
+		uint32_t padIndex = AcquireNode();
+		FNode& pad = m_Nodes[padIndex];
+		FNode& node = m_Nodes[index];
+		pad.Offset = node.Offset;
+		pad.Size = padding;
+		pad.PrevPhysical = node.PrevPhysical;
+		pad.NextPhysical = index;
+		pad.bFree = true;
+		if (node.PrevPhysical != INVALID_NODE) {
+			m_Nodes[node.PrevPhysical].NextPhysical = padIndex;
+		}
+		node.PrevPhysical = padIndex;
+		node.Offset += padding;
+		node.Size -= padding;
+		InsertFreeNode(padIndex);
+	}
+
+	// Return the tail to the free lists
+	if (m_Nodes[index].Size > InSize) {
+		uint32_t tailIndex = AcquireNode();
+		FNode& tail = m_Nodes[tailIndex];
+		FNode& node = m_Nodes[index];
+		tail.Offset = node.Offset + InSize;
+		tail.Size = node.Size - InSize;
+		tail.PrevPhysical = index;
+		tail.NextPhysical = node.NextPhysical;
+		tail.bFree = true;
+		if (node.NextPhysical != INVALID_NODE) {
+			m_Nodes[node.NextPhysical].PrevPhysical = tailIndex;
+		}
+		node.NextPhysical = tailIndex;
+		node.Size = InSize;
+		InsertFreeNode(tailIndex);
+	}
+
+	FNode& node = m_Nodes[index];
+	node.bFree = false;
+	m_UsedSize += node.Size;
+
+	OutAllocation.Memory = m_Memory;
+	OutAllocation.Offset = node.Offset;
+	OutAllocation.Size = node.Size;
+	OutAllocation.MappedData = m_MappedData ? static_cast<uint8_t*>(m_MappedData) + node.Offset : nullptr;
+	OutAllocation.Heap = this;
+	OutAllocation.NodeIndex = index;
+	OutAllocation.MemoryTypeIndex = m_MemoryTypeIndex;
+	return true;
+}
+
+void FVulkanResourceHeap::Free(const FVulkanAllocation & InAllocation)
+{
+	uint32_t index = InAllocation.NodeIndex;
+	m_Nodes[index].bFree = true;
+	m_UsedSize -= m_Nodes[index].Size;
+
+	// Coalesce with the physical neighbours
+	uint32_t nextIndex = m_Nodes[index].NextPhysical;
+	if (nextIndex != INVALID_NODE && m_Nodes[nextIndex].bFree) {
+		RemoveFreeNode(nextIndex);
+		m_Nodes[index].Size += m_Nodes[nextIndex].Size;
+		m_Nodes[index].NextPhysical = m_Nodes[nextIndex].NextPhysical;
+		if (m_Nodes[index].NextPhysical != INVALID_NODE) {
+			m_Nodes[m_Nodes[index].NextPhysical].PrevPhysical = index;
+		}
+		ReleaseNode(nextIndex);
+	}
+
+	uint32_t prevIndex = m_Nodes[index].PrevPhysical;
+	if (prevIndex != INVALID_NODE && m_Nodes[prevIndex].bFree) {
+		RemoveFreeNode(prevIndex);
+		m_Nodes[prevIndex].Size += m_Nodes[index].Size;
+		m_Nodes[prevIndex].NextPhysical = m_Nodes[index].NextPhysical;
+		if (m_Nodes[prevIndex].NextPhysical != INVALID_NODE) {
+			m_Nodes[m_Nodes[prevIndex].NextPhysical].PrevPhysical = prevIndex;
+		}
+		ReleaseNode(index);
+		index = prevIndex;
+	}
+
+	InsertFreeNode(index);
+}
+
+void FVulkanResourceHeap::MappingInsert(VkDeviceSize InSize, uint32_t & OutFL, uint32_t & OutSL)
+{
+	if (InSize < SL_COUNT) {
+		OutFL = 0;
+		OutSL = static_cast<uint32_t>(InSize);
+	}
+	else {
+		uint32_t msb = VulkanBitScanMsb64(InSize);
+		OutFL = msb - SL_BITS + 1;
+		OutSL = static_cast<uint32_t>(InSize >> (msb - SL_BITS)) & (SL_COUNT - 1);
+	}
+}
+
+void FVulkanResourceHeap::MappingSearch(VkDeviceSize InSize, uint32_t & OutFL, uint32_t & OutSL)
+{
+	// Round up to the next list so any node found there is big enough
+	if (InSize >= SL_COUNT) {
+		InSize += (1ull << (VulkanBitScanMsb64(InSize) - SL_BITS)) - 1;
+	}
+	MappingInsert(InSize, OutFL, OutSL);
+}
+
+uint32_t FVulkanResourceHeap::AcquireNode()
+{
+	if (m_FreeNodeSlots.size() > 0) {
+		uint32_t index = m_FreeNodeSlots.back();
+		m_FreeNodeSlots.pop_back();
+		return index;
+	}
+
+	m_Nodes.push_back(FNode());
+	return static_cast<uint32_t>(m_Nodes.size() - 1);
+}
+
+void FVulkanResourceHeap::ReleaseNode(uint32_t InIndex)
+{
+	m_FreeNodeSlots.push_back(InIndex);
+}
+
+uint32_t FVulkanResourceHeap::FindFreeNode(uint32_t InFL, uint32_t InSL) const
+{
+	uint32_t slMap = m_SLBitmap[InFL] & (~0u << InSL);
+	if (!slMap) {
+		if (InFL + 1 >= FL_COUNT) return INVALID_NODE;
+
+		uint64_t flMap = m_FLBitmap & (~0ull << (InFL + 1));
+		if (!flMap) return INVALID_NODE;
+
+		InFL = VulkanBitScanLsb64(flMap);
+		slMap = m_SLBitmap[InFL];
+	}
+
+	InSL = VulkanBitScanLsb64(slMap);
+	return m_FreeHeads[InFL][InSL];
+}
+
+void FVulkanResourceHeap::InsertFreeNode(uint32_t InIndex)
+{
+	uint32_t fl, sl;
+	MappingInsert(m_Nodes[InIndex].Size, fl, sl);
+
+	uint32_t head = m_FreeHeads[fl][sl];
+	m_Nodes[InIndex].PrevFree = INVALID_NODE;
+	m_Nodes[InIndex].NextFree = head;
+	if (head != INVALID_NODE) {
+		m_Nodes[head].PrevFree = InIndex;
+	}
+	m_FreeHeads[fl][sl] = InIndex;
+
+	m_FLBitmap |= 1ull << fl;
+	m_SLBitmap[fl] |= 1u << sl;
+}
+
+void FVulkanResourceHeap::RemoveFreeNode(uint32_t InIndex)
+{
+	uint32_t fl, sl;
+	MappingInsert(m_Nodes[InIndex].Size, fl, sl);
+
+	FNode& node = m_Nodes[InIndex];
+	if (node.PrevFree != INVALID_NODE) {
+		m_Nodes[node.PrevFree].NextFree = node.NextFree;
+	}
+	if (node.NextFree != INVALID_NODE) {
+		m_Nodes[node.NextFree].PrevFree = node.PrevFree;
+	}
+
+	if (m_FreeHeads[fl][sl] == InIndex) {
+		m_FreeHeads[fl][sl] = node.NextFree;
+		if (node.NextFree == INVALID_NODE) {
+			m_SLBitmap[fl] &= ~(1u << sl);
+			if (!m_SLBitmap[fl]) {
+				m_FLBitmap &= ~(1ull << fl);
+			}
+		}
+	}
+}
+
+
+FVulkanMemoryManager::FVulkanMemoryManager(const FVulkanDevice * InDevice)
+	:m_Device(InDevice), m_BufferImageGranularity(1), m_bDedicatedAllocation(false), m_NumDeviceMemoryAllocations(0)
+{
+	memset(&m_MemoryProperties, 0, sizeof(m_MemoryProperties));
+}
+
+FVulkanMemoryManager::~FVulkanMemoryManager()
+{
+	Release();
+}
+
+void FVulkanMemoryManager::Setup()
+{
+	vkGetPhysicalDeviceMemoryProperties(m_Device->GetPhysicalDevice(), &m_MemoryProperties);
+
+	VkPhysicalDeviceProperties deviceProperties;
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &deviceProperties);
+	m_BufferImageGranularity = deviceProperties.limits.bufferImageGranularity;
+	m_bDedicatedAllocation = deviceProperties.apiVersion >= VK_API_VERSION_1_1;
+}
+
+void FVulkanMemoryManager::Release()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (uint32_t typeIndex = 0; typeIndex < VK_MAX_MEMORY_TYPES; typeIndex++)
+	{
+		for (uint32_t pool = 0; pool < 2; pool++)
+		{
+			std::vector<FVulkanResourceHeap*>& heaps = m_Heaps[typeIndex][pool];
+			for (size_t i = 0; i < heaps.size(); i++)
+			{
+				if (!heaps[i]->IsEmpty()) {
+					std::cerr << "[VulkanMemory] Heap released with " << heaps[i]->GetUsedSize() << " bytes still allocated" << std::endl;
+				}
+				delete heaps[i];
+				m_NumDeviceMemoryAllocations--;
+			}
+			heaps.clear();
+		}
+	}
+}
+
+void FVulkanMemoryManager::AllocateBufferMemory(VkBuffer InBuffer, VkMemoryPropertyFlags InProperties, FVulkanAllocation & OutAllocation)
+{
+	VkMemoryDedicatedRequirements dedicatedRequirements = {};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+	VkMemoryRequirements2 memRequirements = {};
+	memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.buffer = InBuffer;
+
+	if (m_bDedicatedAllocation) {
+		VkBufferMemoryRequirementsInfo2 requirementsInfo = {};
+		requirementsInfo.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_REQUIREMENTS_INFO_2;
+		requirementsInfo.buffer = InBuffer;
+		memRequirements.pNext = &dedicatedRequirements;
+		vkGetBufferMemoryRequirements2(m_Device->GetLogicalDevice(), &requirementsInfo, &memRequirements);
+	}
+	else {
+		vkGetBufferMemoryRequirements(m_Device->GetLogicalDevice(), InBuffer, &memRequirements.memoryRequirements);
+	}
+
+	const bool bDedicated = dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+	Allocate(memRequirements.memoryRequirements, InProperties, true, bDedicated, m_bDedicatedAllocation ? &dedicatedInfo : nullptr, OutAllocation);
+
+	if (vkBindBufferMemory(m_Device->GetLogicalDevice(), InBuffer, OutAllocation.Memory, OutAllocation.Offset) != VK_SUCCESS) {
+		throw std::runtime_error("failed to bind buffer memory!");
+	}
+}
+
+void FVulkanMemoryManager::AllocateImageMemory(VkImage InImage, VkImageTiling InTiling, VkMemoryPropertyFlags InProperties, FVulkanAllocation & OutAllocation, bool bInDedicated)
+{
+	VkMemoryDedicatedRequirements dedicatedRequirements = {};
+	dedicatedRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_REQUIREMENTS;
+	VkMemoryRequirements2 memRequirements = {};
+	memRequirements.sType = VK_STRUCTURE_TYPE_MEMORY_REQUIREMENTS_2;
+
+	VkMemoryDedicatedAllocateInfo dedicatedInfo = {};
+	dedicatedInfo.sType = VK_STRUCTURE_TYPE_MEMORY_DEDICATED_ALLOCATE_INFO;
+	dedicatedInfo.image = InImage;
+
+	if (m_bDedicatedAllocation) {
+		VkImageMemoryRequirementsInfo2 requirementsInfo = {};
+		requirementsInfo.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_REQUIREMENTS_INFO_2;
+		requirementsInfo.image = InImage;
+		memRequirements.pNext = &dedicatedRequirements;
+		vkGetImageMemoryRequirements2(m_Device->GetLogicalDevice(), &requirementsInfo, &memRequirements);
+	}
+	else {
+		vkGetImageMemoryRequirements(m_Device->GetLogicalDevice(), InImage, &memRequirements.memoryRequirements);
+	}
+
+	const bool bDedicated = bInDedicated || dedicatedRequirements.prefersDedicatedAllocation || dedicatedRequirements.requiresDedicatedAllocation;
+	Allocate(memRequirements.memoryRequirements, InProperties, InTiling == VK_IMAGE_TILING_LINEAR, bDedicated, m_bDedicatedAllocation ? &dedicatedInfo : nullptr, OutAllocation);
+
+	if (vkBindImageMemory(m_Device->GetLogicalDevice(), InImage, OutAllocation.Memory, OutAllocation.Offset) != VK_SUCCESS) {
+		throw std::runtime_error("failed to bind image memory!");
+	}
+}
+
+void FVulkanMemoryManager::Free(FVulkanAllocation & InOutAllocation)
+{
+	if (!InOutAllocation.IsValid()) return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (InOutAllocation.IsDedicated()) {
+		vkFreeMemory(m_Device->GetLogicalDevice(), InOutAllocation.Memory, nullptr);
+		m_NumDeviceMemoryAllocations--;
+	}
+	else {
+		// Empty heaps are kept around so steady state streaming never goes back to the driver
+		InOutAllocation.Heap->Free(InOutAllocation);
+	}
+
+	InOutAllocation = FVulkanAllocation();
+}
+
+void FVulkanMemoryManager::Allocate(const VkMemoryRequirements & InRequirements, VkMemoryPropertyFlags InProperties, bool bInLinear, bool bInDedicated, const VkMemoryDedicatedAllocateInfo* InDedicatedInfo, FVulkanAllocation & OutAllocation)
+{
+	uint32_t typeIndex = FVulkanUtil::FindMemoryType(m_Device->GetPhysicalDevice(), InRequirements.memoryTypeBits, InProperties);
+	VkDeviceSize blockSize = GetHeapBlockSize(typeIndex);
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	if (bInDedicated || InRequirements.size > blockSize / 2) {
+		AllocateDedicated(typeIndex, InRequirements.size, InDedicatedInfo, OutAllocation);
+		return;
+	}
+
+	uint32_t pool = (m_BufferImageGranularity > 1 && !bInLinear) ? 1 : 0;
+	std::vector<FVulkanResourceHeap*>& heaps = m_Heaps[typeIndex][pool];
+	for (size_t i = 0; i < heaps.size(); i++)
+	{
+		if (heaps[i]->TryAllocate(InRequirements.size, InRequirements.alignment, OutAllocation)) {
+			return;
+		}
+	}
+
+	void* mappedData = nullptr;
+	VkDeviceMemory memory = AllocateDeviceMemory(typeIndex, blockSize, nullptr, &mappedData);
+	FVulkanResourceHeap* heap = new FVulkanResourceHeap(m_Device, memory, typeIndex, blockSize, mappedData);
+	heaps.push_back(heap);
+
+	if (!heap->TryAllocate(InRequirements.size, InRequirements.alignment, OutAllocation)) {
+		throw std::runtime_error("[VulkanMemory] Failed to sub-allocate from a new heap!");
+	}
+}
+
+void FVulkanMemoryManager::AllocateDedicated(uint32_t InMemoryTypeIndex, VkDeviceSize InSize, const VkMemoryDedicatedAllocateInfo* InDedicatedInfo, FVulkanAllocation & OutAllocation)
+{
+	void* mappedData = nullptr;
+	OutAllocation.Memory = AllocateDeviceMemory(InMemoryTypeIndex, InSize, InDedicatedInfo, &mappedData);
+	OutAllocation.Offset = 0;
+	OutAllocation.Size = InSize;
+	OutAllocation.MappedData = mappedData;
+	OutAllocation.Heap = nullptr;
+	OutAllocation.NodeIndex = 0;
+	OutAllocation.MemoryTypeIndex = InMemoryTypeIndex;
+}
+
+VkDeviceMemory FVulkanMemoryManager::AllocateDeviceMemory(uint32_t InMemoryTypeIndex, VkDeviceSize InSize, const void* InNext, void ** OutMappedData)
+{
+	VkMemoryAllocateInfo allocInfo = {};
+	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+	allocInfo.pNext = InNext;
+	allocInfo.allocationSize = InSize;
+	allocInfo.memoryTypeIndex = InMemoryTypeIndex;
+
+	VkDeviceMemory memory;
+	if (vkAllocateMemory(m_Device->GetLogicalDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
+		throw std::runtime_error("[VulkanMemory] Failed to allocate device memory!");
+	}
+	m_NumDeviceMemoryAllocations++;
+
+	// Host visible memory stays mapped for its whole lifetime
+	*OutMappedData = nullptr;
+	if (m_MemoryProperties.memoryTypes[InMemoryTypeIndex].propertyFlags & VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT) {
+		if (vkMapMemory(m_Device->GetLogicalDevice(), memory, 0, VK_WHOLE_SIZE, 0, OutMappedData) != VK_SUCCESS) {
+			throw std::runtime_error("[VulkanMemory] Failed to map device memory!");
+		}
+	}
+
+	return memory;
+}
+
+VkDeviceSize FVulkanMemoryManager::GetHeapBlockSize(uint32_t InMemoryTypeIndex) const
+{
+	VkDeviceSize heapSize = m_MemoryProperties.memoryHeaps[m_MemoryProperties.memoryTypes[InMemoryTypeIndex].heapIndex].size;
+	if (heapSize <= VULKAN_SMALL_HEAP_THRESHOLD) {
+		return VulkanAlignUp(heapSize / 8, 1024 * 1024);
+	}
+	return VULKAN_DEFAULT_HEAP_BLOCK_SIZE;
+}
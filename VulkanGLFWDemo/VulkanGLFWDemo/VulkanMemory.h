@@ -1,9 +1,11 @@
 #pragma once
+#include <mutex>
 #include <vector>
 #include <vulkan/vulkan.h>
 
 class FVulkanDevice;
 class FVulkanFenceManager;
+class FVulkanResourceHeap;
 
 class FVulkanSemaphore
 {
@@ -46,6 +48,7 @@ public:
 	}
 
 	void Reset();
+	bool Wait(uint64_t InTimeoutNs);
 
 protected:
 	friend class FVulkanFenceManager;
@@ -78,6 +81,7 @@ public:
 	~FVulkanFenceManager();
 
 	FVulkanFence* GetNewFence(bool bCreateSignaled);
+	void ReleaseFence(FVulkanFence* InFence);
 
 protected:
 	friend class FVulkanFence;
@@ -89,5 +93,147 @@ private:
 	std::vector< FVulkanFence*> m_Fences;
 	std::vector< FVulkanFence*> m_FreeFences;
 
-	
+	std::mutex m_Mutex;
+};
+
+
+// A range of device memory handed out by FVulkanMemoryManager.
+// Allocations without an owning heap are dedicated and own their VkDeviceMemory.
+struct FVulkanAllocation
+{
+	VkDeviceMemory Memory = VK_NULL_HANDLE;
+	VkDeviceSize Offset = 0;
+	VkDeviceSize Size = 0;
+	void* MappedData = nullptr;
+
+	FVulkanResourceHeap* Heap = nullptr;
+	uint32_t NodeIndex = 0;
+	uint32_t MemoryTypeIndex = 0;
+
+	inline bool IsValid() const
+	{
+		return Memory != VK_NULL_HANDLE;
+	}
+
+	inline bool IsDedicated() const
+	{
+		return Heap == nullptr;
+	}
+};
+
+// One large VkDeviceMemory block, sub-allocated with a two-level segregated fit (TLSF) allocator.
+class FVulkanResourceHeap
+{
+public:
+	FVulkanResourceHeap(const FVulkanDevice* InDevice, VkDeviceMemory InMemory, uint32_t InMemoryTypeIndex, VkDeviceSize InSize, void* InMappedData);
+	~FVulkanResourceHeap();
+
+	bool TryAllocate(VkDeviceSize InSize, VkDeviceSize InAlignment, FVulkanAllocation& OutAllocation);
+	void Free(const FVulkanAllocation& InAllocation);
+
+	inline VkDeviceMemory GetMemory() const
+	{
+		return m_Memory;
+	}
+
+	inline VkDeviceSize GetSize() const
+	{
+		return m_Size;
+	}
+
+	inline VkDeviceSize GetUsedSize() const
+	{
+		return m_UsedSize;
+	}
+
+	inline bool IsEmpty() const
+	{
+		return m_UsedSize == 0;
+	}
+
+private:
+	enum : uint32_t
+	{
+		SL_BITS = 5,
+		SL_COUNT = 1 << SL_BITS,
+		FL_COUNT = 64,
+		INVALID_NODE = 0xFFFFFFFF,
+	};
+
+	struct FNode
+	{
+		VkDeviceSize Offset;
+		VkDeviceSize Size;
+		uint32_t PrevPhysical;
+		uint32_t NextPhysical;
+		uint32_t PrevFree;
+		uint32_t NextFree;
+		bool bFree;
+	};
+
+	static void MappingInsert(VkDeviceSize InSize, uint32_t& OutFL, uint32_t& OutSL);
+	static void MappingSearch(VkDeviceSize InSize, uint32_t& OutFL, uint32_t& OutSL);
+
+	uint32_t AcquireNode();
+	void ReleaseNode(uint32_t InIndex);
+	uint32_t FindFreeNode(uint32_t InFL, uint32_t InSL) const;
+	void InsertFreeNode(uint32_t InIndex);
+	void RemoveFreeNode(uint32_t InIndex);
+
+private:
+	const FVulkanDevice* m_Device;
+	VkDeviceMemory m_Memory;
+	uint32_t m_MemoryTypeIndex;
+	VkDeviceSize m_Size;
+	VkDeviceSize m_UsedSize;
+	void* m_MappedData;
+
+	std::vector<FNode> m_Nodes;
+	std::vector<uint32_t> m_FreeNodeSlots;
+
+	uint64_t m_FLBitmap;
+	uint32_t m_SLBitmap[FL_COUNT];
+	uint32_t m_FreeHeads[FL_COUNT][SL_COUNT];
+};
+
+// Device level allocator: every buffer and texture gets its memory from here.
+// Small resources are sub-allocated from per memory type heaps, big ones get a dedicated allocation.
+class FVulkanMemoryManager
+{
+public:
+	FVulkanMemoryManager(const FVulkanDevice* InDevice);
+	~FVulkanMemoryManager();
+
+	void Setup();
+	void Release();
+
+	void AllocateBufferMemory(VkBuffer InBuffer, VkMemoryPropertyFlags InProperties, FVulkanAllocation& OutAllocation);
+	void AllocateImageMemory(VkImage InImage, VkImageTiling InTiling, VkMemoryPropertyFlags InProperties, FVulkanAllocation& OutAllocation, bool bInDedicated = false);
+	void Free(FVulkanAllocation& InOutAllocation);
+
+	inline uint32_t GetNumDeviceMemoryAllocations() const
+	{
+		return m_NumDeviceMemoryAllocations;
+	}
+
+private:
+	// InDedicatedInfo names the resource a dedicated allocation is for, null where VK_KHR_dedicated_allocation isn't available
+	void Allocate(const VkMemoryRequirements& InRequirements, VkMemoryPropertyFlags InProperties, bool bInLinear, bool bInDedicated, const VkMemoryDedicatedAllocateInfo* InDedicatedInfo, FVulkanAllocation& OutAllocation);
+	void AllocateDedicated(uint32_t InMemoryTypeIndex, VkDeviceSize InSize, const VkMemoryDedicatedAllocateInfo* InDedicatedInfo, FVulkanAllocation& OutAllocation);
+	VkDeviceMemory AllocateDeviceMemory(uint32_t InMemoryTypeIndex, VkDeviceSize InSize, const void* InNext, void** OutMappedData);
+	VkDeviceSize GetHeapBlockSize(uint32_t InMemoryTypeIndex) const;
+
+private:
+	const FVulkanDevice* m_Device;
+	VkPhysicalDeviceMemoryProperties m_MemoryProperties;
+	VkDeviceSize m_BufferImageGranularity;
+	// Vulkan 1.1 devices tell which resources want memory of their own and get told which resource it is for
+	bool m_bDedicatedAllocation;
+
+	std::mutex m_Mutex;
+
+	// Heaps per memory type. When bufferImageGranularity is bigger than one, optimal tiling images
+	// live in their own heaps so linear and non-linear resources never share a granularity page.
+	std::vector<FVulkanResourceHeap*> m_Heaps[VK_MAX_MEMORY_TYPES][2];
+	uint32_t m_NumDeviceMemoryAllocations;
 };
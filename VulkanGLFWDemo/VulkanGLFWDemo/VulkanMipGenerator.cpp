@@ -0,0 +1,399 @@
+#include "VulkanMipGenerator.h"
+#include <algorithm>
+#include <stdexcept>
+#include "VulkanDevice.h"
+#include "VulkanShader.h"
+#include "VulkanPipeline.h"
+#include "VulkanDescriptorSet.h"
+#include "VulkanCommandBuffer.h"
+
+static const char* VULKAN_MIPGEN_SHADER_PATH = "./shader/mipgen_comp.spv";
+
+FVulkanMipGenerator::FVulkanMipGenerator(const FVulkanDevice * InDevice)
+	:m_Device(InDevice)
+{
+}
+
+FVulkanMipGenerator::~FVulkanMipGenerator()
+{
+	if (m_Pipeline) {
+		m_Pipeline->Release();
+	}
+	if (m_SetManager) {
+		m_SetManager->Release();
+	}
+	if (m_Shader) {
+		m_Shader->ReleaseAllShaders();
+	}
+}
+
+uint32_t FVulkanMipGenerator::GetMipLevelCount(uint32_t InWidth, uint32_t InHeight)
+{
+	uint32_t levels = 1;
+	uint32_t size = std::max(InWidth, InHeight);
+	while (size > 1) {
+		size >>= 1;
+		levels++;
+	}
+	return levels;
+}
+
+FVulkanMipGenerator::EMethod FVulkanMipGenerator::GetMethod(VkFormat InFormat) const
+{
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(m_Device->GetPhysicalDevice(), InFormat, &props);
+
+	// Blits need no extra usage or view formats, which could cost the image its compression
+	const VkFormatFeatureFlags blitFeatures = VK_FORMAT_FEATURE_BLIT_SRC_BIT | VK_FORMAT_FEATURE_BLIT_DST_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	if ((props.optimalTilingFeatures & blitFeatures) == blitFeatures) {
+		return EMethod::Blit;
+	}
+
+	if (IsComputeSupported(InFormat, props.optimalTilingFeatures)) {
+		return EMethod::Compute;
+	}
+	return EMethod::None;
+}
+
+bool FVulkanMipGenerator::IsComputeSupported(VkFormat InFormat, VkFormatFeatureFlags InFeatures) const
+{
+	// The shader reads and writes rgba8 storage images, so the levels are viewed as R8G8B8A8_UNORM.
+	// Only formats with the same 8 bit unorm channels can be filtered through such a view.
+	switch (InFormat)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+	case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
+	case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
+		break;
+	default:
+		return false;
+	}
+	if (!(InFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT)) return false;
+
+	VkFormatProperties viewProps;
+	vkGetPhysicalDeviceFormatProperties(m_Device->GetPhysicalDevice(), VK_FORMAT_R8G8B8A8_UNORM, &viewProps);
+	if (!(viewProps.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) return false;
+
+	// A format that can't be a storage image itself needs VK_IMAGE_CREATE_EXTENDED_USAGE_BIT (Vulkan 1.1)
+	if (!(InFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+		VkPhysicalDeviceProperties properties;
+		vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+		return properties.apiVersion >= VK_API_VERSION_1_1;
+	}
+	return true;
+}
+
+VkImageUsageFlags FVulkanMipGenerator::GetImageUsage(EMethod InMethod) const
+{
+	switch (InMethod)
+	{
+	case EMethod::Blit:
+		return VK_IMAGE_USAGE_TRANSFER_SRC_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT;
+	case EMethod::Compute:
+		return VK_IMAGE_USAGE_STORAGE_BIT;
+	default:
+		return 0;
+	}
+}
+
+VkImageCreateFlags FVulkanMipGenerator::GetImageFlags(EMethod InMethod, VkFormat InFormat) const
+{
+	if (InMethod != EMethod::Compute || InFormat == VK_FORMAT_R8G8B8A8_UNORM) return 0;
+
+	// The storage views reinterpret the image as R8G8B8A8_UNORM. If the format itself can't be a
+	// storage image, only those views may be (extended usage is core in Vulkan 1.1).
+	VkImageCreateFlags flags = VK_IMAGE_CREATE_MUTABLE_FORMAT_BIT;
+
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(m_Device->GetPhysicalDevice(), InFormat, &props);
+	if (!(props.optimalTilingFeatures & VK_FORMAT_FEATURE_STORAGE_IMAGE_BIT)) {
+		flags |= VK_IMAGE_CREATE_EXTENDED_USAGE_BIT;
+	}
+	return flags;
+}
+
+void FVulkanMipGenerator::CreateTarget(EMethod InMethod, VkImage InImage, VkFormat InFormat, uint32_t InWidth, uint32_t InHeight, uint32_t InLevels, uint32_t InLayers, FTarget & OutTarget)
+{
+	OutTarget.Method = InLevels > 1 ? InMethod : EMethod::None;
+	OutTarget.Image = InImage;
+	OutTarget.Width = InWidth;
+	OutTarget.Height = InHeight;
+	OutTarget.Levels = InLevels;
+	OutTarget.Layers = InLayers;
+	OutTarget.bSRGB = InFormat == VK_FORMAT_R8G8B8A8_SRGB || InFormat == VK_FORMAT_B8G8R8A8_SRGB || InFormat == VK_FORMAT_A8B8G8R8_SRGB_PACK32;
+
+	if (OutTarget.Method != EMethod::Compute) return;
+
+	SetupComputePipeline();
+
+	OutTarget.StorageViews.resize(InLevels);
+	for (uint32_t level = 0; level < InLevels; level++)
+	{
+		VkImageViewCreateInfo viewInfo = {};
+		viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+		viewInfo.image = InImage;
+		viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D_ARRAY;
+		viewInfo.format = VK_FORMAT_R8G8B8A8_UNORM;
+		viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		viewInfo.subresourceRange.baseMipLevel = level;
+		viewInfo.subresourceRange.levelCount = 1;
+		viewInfo.subresourceRange.baseArrayLayer = 0;
+		viewInfo.subresourceRange.layerCount = InLayers;
+
+		if (vkCreateImageView(m_Device->GetLogicalDevice(), &viewInfo, nullptr, &OutTarget.StorageViews[level]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create mip storage image view!");
+		}
+	}
+
+	// The views never change, so the sets are written once and reused by every generation
+	const uint32_t numPasses = (InLevels - 1 + LEVELS_PER_PASS - 1) / LEVELS_PER_PASS;
+
+	FVulkanDescriptorSetLayout passLayout;
+	GetPassLayout(passLayout);
+
+	OutTarget.SetManager.reset(new FVulkanDescriptorSetManager(m_Device, numPasses));
+	for (uint32_t pass = 0; pass < numPasses; pass++)
+	{
+		OutTarget.PassSets.push_back(OutTarget.SetManager->AddDescriptorSet(passLayout));
+	}
+	OutTarget.SetManager->Setup();
+
+	for (uint32_t pass = 0; pass < numPasses; pass++)
+	{
+		const uint32_t baseLevel = pass * LEVELS_PER_PASS;
+
+		VkDescriptorImageInfo srcInfo = {};
+		srcInfo.imageView = OutTarget.StorageViews[baseLevel];
+		srcInfo.imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+
+		// Slots past the last level still need a valid view, the shader never writes them
+		VkDescriptorImageInfo dstInfos[LEVELS_PER_PASS] = {};
+		for (uint32_t i = 0; i < LEVELS_PER_PASS; i++)
+		{
+			dstInfos[i].imageView = OutTarget.StorageViews[std::min(baseLevel + 1 + i, InLevels - 1)];
+			dstInfos[i].imageLayout = VK_IMAGE_LAYOUT_GENERAL;
+		}
+
+		FVulkanDescriptorSet* set = OutTarget.PassSets[pass];
+		set->BindStorageImage(0, &srcInfo, 1);
+		set->BindStorageImage(1, dstInfos, LEVELS_PER_PASS);
+		set->UpdateBindings();
+	}
+}
+
+void FVulkanMipGenerator::DestroyTarget(FTarget & InOutTarget)
+{
+	if (InOutTarget.SetManager) {
+		InOutTarget.SetManager->Release();
+		InOutTarget.SetManager.reset();
+	}
+	InOutTarget.PassSets.clear();
+
+	for (auto view : InOutTarget.StorageViews)
+	{
+		vkDestroyImageView(m_Device->GetLogicalDevice(), view, nullptr);
+	}
+	InOutTarget.StorageViews.clear();
+	InOutTarget.Method = EMethod::None;
+}
+
+void FVulkanMipGenerator::Generate(FVulkanCommandBuffer * InCmdBuffer, const FTarget & InTarget) const
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	// The passes record their own barriers, the tracker only learns where they leave the image
+	InCmdBuffer->GetImageStates().Flush();
+
+	switch (InTarget.Method)
+	{
+	case EMethod::Blit:
+		GenerateWithBlit(InCmdBuffer, InTarget);
+		break;
+	case EMethod::Compute:
+		GenerateWithCompute(InCmdBuffer, InTarget);
+		break;
+	default:
+	{
+		// Nothing to generate, still hand the levels over to the shaders
+		VkImageMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.image = InTarget.Image;
+		barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, InTarget.Levels, 0, InTarget.Layers };
+
+		vkCmdPipelineBarrier(InCmdBuffer->GetHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+		break;
+	}
+	}
+
+	const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, InTarget.Levels, 0, InTarget.Layers };
+	InCmdBuffer->GetImageStates().SetState(InTarget.Image, range, FVulkanImageStateTracker::GetLayoutState(VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL));
+}
+
+void FVulkanMipGenerator::GenerateWithBlit(FVulkanCommandBuffer * InCmdBuffer, const FTarget & InTarget) const
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = InTarget.Image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, InTarget.Layers };
+
+	int32_t width = static_cast<int32_t>(InTarget.Width);
+	int32_t height = static_cast<int32_t>(InTarget.Height);
+
+	for (uint32_t level = 1; level < InTarget.Levels; level++)
+	{
+		// The previous level has just been written, by the upload or the last blit
+		barrier.subresourceRange.baseMipLevel = level - 1;
+		barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+		barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+
+		vkCmdPipelineBarrier(InCmdBuffer->GetHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT,
+			0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+		const int32_t nextWidth = std::max(width / 2, 1);
+		const int32_t nextHeight = std::max(height / 2, 1);
+
+		VkImageBlit blit = {};
+		blit.srcOffsets[0] = { 0, 0, 0 };
+		blit.srcOffsets[1] = { width, height, 1 };
+		blit.srcSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level - 1, 0, InTarget.Layers };
+		blit.dstOffsets[0] = { 0, 0, 0 };
+		blit.dstOffsets[1] = { nextWidth, nextHeight, 1 };
+		blit.dstSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, level, 0, InTarget.Layers };
+
+		vkCmdBlitImage(InCmdBuffer->GetHandle(),
+			InTarget.Image, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL,
+			InTarget.Image, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			1, &blit, VK_FILTER_LINEAR);
+
+		width = nextWidth;
+		height = nextHeight;
+	}
+
+	// One barrier for the whole chain: every level but the last has been a blit source
+	VkImageMemoryBarrier barriers[2] = { barrier, barrier };
+	barriers[0].subresourceRange.baseMipLevel = 0;
+	barriers[0].subresourceRange.levelCount = InTarget.Levels - 1;
+	barriers[0].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	barriers[0].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[0].srcAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+	barriers[0].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	barriers[1].subresourceRange.baseMipLevel = InTarget.Levels - 1;
+	barriers[1].subresourceRange.levelCount = 1;
+	barriers[1].oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barriers[1].newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barriers[1].srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barriers[1].dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(InCmdBuffer->GetHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 2, barriers);
+}
+
+void FVulkanMipGenerator::GenerateWithCompute(FVulkanCommandBuffer * InCmdBuffer, const FTarget & InTarget) const
+{
+	VkImageMemoryBarrier barrier = {};
+	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
+	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.image = InTarget.Image;
+	barrier.subresourceRange = { VK_IMAGE_ASPECT_COLOR_BIT, 0, InTarget.Levels, 0, InTarget.Layers };
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+
+	vkCmdPipelineBarrier(InCmdBuffer->GetHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+
+	m_Pipeline->Bind(InCmdBuffer);
+
+	for (uint32_t pass = 0; pass < InTarget.PassSets.size(); pass++)
+	{
+		const uint32_t baseLevel = pass * LEVELS_PER_PASS;
+
+		if (pass > 0) {
+			// The next pass reads the last level the previous one wrote
+			barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.newLayout = VK_IMAGE_LAYOUT_GENERAL;
+			barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+			barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+			vkCmdPipelineBarrier(InCmdBuffer->GetHandle(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT,
+				0, 0, nullptr, 0, nullptr, 1, &barrier);
+		}
+
+		FPushConstants constants;
+		constants.SrcWidth = static_cast<int32_t>(std::max(InTarget.Width >> baseLevel, 1u));
+		constants.SrcHeight = static_cast<int32_t>(std::max(InTarget.Height >> baseLevel, 1u));
+		constants.NumLevels = static_cast<int32_t>(std::min<uint32_t>(LEVELS_PER_PASS, InTarget.Levels - 1 - baseLevel));
+		constants.bSRGB = InTarget.bSRGB ? 1 : 0;
+
+		const FVulkanDescriptorSet* set = InTarget.PassSets[pass];
+		m_Pipeline->BindDescriptorSets(InCmdBuffer, &set, 1);
+		m_Pipeline->PushConstants(InCmdBuffer, &constants, sizeof(constants));
+
+		// One thread per texel of the first level written
+		const uint32_t dstWidth = std::max<uint32_t>(constants.SrcWidth / 2, 1);
+		const uint32_t dstHeight = std::max<uint32_t>(constants.SrcHeight / 2, 1);
+		m_Pipeline->Dispatch(InCmdBuffer,
+			FVulkanComputePipeline::GetGroupCount(dstWidth, GROUP_SIZE),
+			FVulkanComputePipeline::GetGroupCount(dstHeight, GROUP_SIZE),
+			InTarget.Layers);
+	}
+
+	barrier.oldLayout = VK_IMAGE_LAYOUT_GENERAL;
+	barrier.newLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	barrier.srcAccessMask = VK_ACCESS_SHADER_WRITE_BIT;
+	barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+
+	vkCmdPipelineBarrier(InCmdBuffer->GetHandle(), VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT,
+		0, 0, nullptr, 0, nullptr, 1, &barrier);
+}
+
+void FVulkanMipGenerator::GetPassLayout(FVulkanDescriptorSetLayout & OutLayout) const
+{
+	VkDescriptorSetLayoutBinding srcBinding = {};
+	srcBinding.binding = 0;
+	srcBinding.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_IMAGE;
+	srcBinding.descriptorCount = 1;
+	srcBinding.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	OutLayout.AddDescriptor(srcBinding);
+
+	VkDescriptorSetLayoutBinding dstBinding = srcBinding;
+	dstBinding.binding = 1;
+	dstBinding.descriptorCount = LEVELS_PER_PASS;
+	OutLayout.AddDescriptor(dstBinding);
+}
+
+void FVulkanMipGenerator::SetupComputePipeline()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+	if (m_Pipeline) return;
+
+	m_Shader.reset(new FVulkanShader(m_Device));
+	m_Shader->LoadShaderFromFile(VULKAN_MIPGEN_SHADER_PATH, "main", FVulkanShader::SHADER_TYPE_COMPUTE);
+
+	// Only provides the pipeline layout, the sets of every target have an identical layout
+	FVulkanDescriptorSetLayout passLayout;
+	GetPassLayout(passLayout);
+	m_SetManager.reset(new FVulkanDescriptorSetManager(m_Device, 1));
+	m_SetManager->AddDescriptorSet(passLayout);
+	m_SetManager->Setup();
+
+	m_Pipeline.reset(new FVulkanComputePipeline(m_Device));
+	m_Pipeline->Setup(m_SetManager.get(), m_Shader.get(), sizeof(FPushConstants));
+}
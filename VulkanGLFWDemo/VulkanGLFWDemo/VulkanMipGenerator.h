@@ -0,0 +1,96 @@
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class FVulkanDevice;
+class FVulkanShader;
+class FVulkanCommandBuffer;
+class FVulkanComputePipeline;
+class FVulkanDescriptorSet;
+class FVulkanDescriptorSetLayout;
+class FVulkanDescriptorSetManager;
+
+// Fills the mip chain of an image on the GPU once level 0 has been uploaded.
+// Formats the device can blit with linear filtering go through a vkCmdBlitImage chain. 8 bit RGBA/BGRA
+// formats that can't fall back to a compute downsampler writing up to 4 levels per dispatch, as long as
+// the device can store them through R8G8B8A8_UNORM views.
+class FVulkanMipGenerator
+{
+public:
+	FVulkanMipGenerator(const FVulkanDevice* InDevice);
+	~FVulkanMipGenerator();
+
+	enum class EMethod : uint8_t
+	{
+		None,
+		Blit,
+		Compute,
+	};
+
+	// Everything the generator needs of one image, created alongside the image itself
+	struct FTarget
+	{
+		EMethod Method = EMethod::None;
+		VkImage Image = VK_NULL_HANDLE;
+		uint32_t Width = 0;
+		uint32_t Height = 0;
+		uint32_t Levels = 1;
+		uint32_t Layers = 1;
+		bool bSRGB = false;
+
+		// Compute only, a storage view per level and a descriptor set per dispatch
+		std::vector<VkImageView> StorageViews;
+		std::shared_ptr<FVulkanDescriptorSetManager> SetManager;
+		std::vector<FVulkanDescriptorSet*> PassSets;
+	};
+
+	static uint32_t GetMipLevelCount(uint32_t InWidth, uint32_t InHeight);
+
+	EMethod GetMethod(VkFormat InFormat) const;
+	// Extra usage and create flags of an image whose mips are generated with InMethod
+	VkImageUsageFlags GetImageUsage(EMethod InMethod) const;
+	VkImageCreateFlags GetImageFlags(EMethod InMethod, VkFormat InFormat) const;
+
+	// InImage has to be created with GetImageUsage() and GetImageFlags() of InMethod
+	void CreateTarget(EMethod InMethod, VkImage InImage, VkFormat InFormat, uint32_t InWidth, uint32_t InHeight, uint32_t InLevels, uint32_t InLayers, FTarget& OutTarget);
+	void DestroyTarget(FTarget& InOutTarget);
+
+	// Records the chain into InCmdBuffer, which must have begun, be outside a render pass and belong
+	// to a graphics queue. All levels have to be in TRANSFER_DST_OPTIMAL with level 0 written by transfer,
+	// afterwards they are all in SHADER_READ_ONLY_OPTIMAL and visible to fragment shaders.
+	void Generate(FVulkanCommandBuffer* InCmdBuffer, const FTarget& InTarget) const;
+
+private:
+	enum : uint32_t
+	{
+		LEVELS_PER_PASS = 4,
+		GROUP_SIZE = 8,
+	};
+
+	struct FPushConstants
+	{
+		int32_t SrcWidth;
+		int32_t SrcHeight;
+		int32_t NumLevels;
+		int32_t bSRGB;
+	};
+
+	void GenerateWithBlit(FVulkanCommandBuffer* InCmdBuffer, const FTarget& InTarget) const;
+	void GenerateWithCompute(FVulkanCommandBuffer* InCmdBuffer, const FTarget& InTarget) const;
+
+	bool IsComputeSupported(VkFormat InFormat, VkFormatFeatureFlags InFeatures) const;
+
+	void GetPassLayout(FVulkanDescriptorSetLayout& OutLayout) const;
+	void SetupComputePipeline();
+
+private:
+	const FVulkanDevice* m_Device;
+
+	// Only loaded once an image needs the compute path
+	std::mutex m_Mutex;
+	std::unique_ptr<FVulkanShader> m_Shader;
+	std::unique_ptr<FVulkanDescriptorSetManager> m_SetManager;
+	std::unique_ptr<FVulkanComputePipeline> m_Pipeline;
+};
@@ -0,0 +1,197 @@
+#include "VulkanOffscreenPresenter.h"
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanCommandBuffer.h"
+#include "VulkanBuffer.h"
+#include <algorithm>
+#include <stdexcept>
+
+
+FVulkanOffscreenPresenter::FVulkanOffscreenPresenter(const FVulkanDevice * InDevice, FVulkanQueue * InQueue)
+	:m_Device(InDevice), m_Queue(InQueue), m_Extent({ 0, 0 }), m_TexelSize(4), m_NextImage(0), m_PendingPresent(nullptr), m_PendingPresentImage(0)
+{
+	m_CmdBufferManager.reset(new FVulkanCommandBufferManager(m_Device, m_Queue));
+}
+
+FVulkanOffscreenPresenter::~FVulkanOffscreenPresenter()
+{
+	Release();
+
+	// Acquires without a present yet still reference command buffers of the manager
+	m_Queue->WaitForSerial(m_Queue->GetLastSubmittedSerial());
+	m_CmdBufferManager.reset();
+}
+
+void FVulkanOffscreenPresenter::Setup(VkExtent2D InExtent, VkFormat InFormat, uint32_t InImageCount)
+{
+	m_Extent = InExtent;
+	// The swap chain formats are all 32 bit per texel
+	m_TexelSize = 4;
+	m_NextImage = 0;
+
+	m_Images.resize(InImageCount);
+	m_ImageStates.resize(InImageCount);
+
+	for (uint32_t i = 0; i < InImageCount; i++) {
+		VkImageCreateInfo imageInfo = {};
+		imageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO;
+		imageInfo.imageType = VK_IMAGE_TYPE_2D;
+		imageInfo.extent = { m_Extent.width, m_Extent.height, 1 };
+		imageInfo.mipLevels = 1;
+		imageInfo.arrayLayers = 1;
+		imageInfo.format = InFormat;
+		imageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+		imageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+		imageInfo.usage = VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT;
+		imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+		imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+
+		if (vkCreateImage(m_Device->GetLogicalDevice(), &imageInfo, nullptr, &m_Images[i]) != VK_SUCCESS) {
+			throw std::runtime_error("failed to create offscreen image!");
+		}
+		m_Device->GetMemoryManager()->AllocateImageMemory(m_Images[i], VK_IMAGE_TILING_OPTIMAL, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT, m_ImageStates[i].Allocation);
+
+		if (m_ReadbackCallback) {
+			m_ImageStates[i].Readback.reset(new FVulkanReadbackBuffer(m_Device, (uint64_t)m_Extent.width * m_Extent.height * m_TexelSize));
+		}
+	}
+}
+
+void FVulkanOffscreenPresenter::Release()
+{
+	if (m_Images.empty()) return;
+
+	SubmitPendingPresent(nullptr);
+
+	uint64_t lastSerial = 0;
+	for (size_t i = 0; i < m_ImageStates.size(); i++) {
+		lastSerial = std::max(lastSerial, m_ImageStates[i].PresentSerial);
+	}
+	m_Queue->WaitForSerial(lastSerial);
+
+	for (size_t i = 0; i < m_Images.size(); i++) {
+		vkDestroyImage(m_Device->GetLogicalDevice(), m_Images[i], nullptr);
+		m_Device->GetMemoryManager()->Free(m_ImageStates[i].Allocation);
+	}
+	m_Images.clear();
+	m_ImageStates.clear();
+}
+
+VkResult FVulkanOffscreenPresenter::AcquireNextImage(const FVulkanSemaphore * InImageAvailable, uint32_t & OutImageIndex, uint64_t InTimeoutNs)
+{
+	const uint32_t imageIndex = m_NextImage;
+	FImage& state = m_ImageStates[imageIndex];
+
+	// Only with a single image, its own present has to go out before it can be waited for
+	if (m_PendingPresent && m_PendingPresentImage == imageIndex) {
+		SubmitPendingPresent(nullptr);
+	}
+
+	// The only throttle there is: the previous present of this image has to be done
+	if (!m_Queue->IsSerialCompleted(state.PresentSerial)) {
+		if (InTimeoutNs == 0) {
+			m_Queue->RefreshFenceStatus();
+		}
+		else {
+			m_Queue->WaitForSerial(state.PresentSerial, InTimeoutNs);
+		}
+		if (!m_Queue->IsSerialCompleted(state.PresentSerial)) {
+			return InTimeoutNs == 0 ? VK_NOT_READY : VK_TIMEOUT;
+		}
+	}
+	DeliverReadback(imageIndex);
+
+	// Nothing to wait for on the GPU, the semaphore rides along with the previous present.
+	// Only the first frame after a Release or WaitIdle has none and submits an empty command buffer.
+	if (!m_PendingPresent) {
+		m_PendingPresent = m_CmdBufferManager->GetNewCommandBuffer();
+		m_PendingPresent->Begin();
+		m_PendingPresent->End();
+		m_PendingPresentImage = UINT32_MAX;
+	}
+	SubmitPendingPresent(InImageAvailable);
+
+	m_NextImage = (m_NextImage + 1) % static_cast<uint32_t>(m_Images.size());
+	OutImageIndex = imageIndex;
+	return VK_SUCCESS;
+}
+
+VkResult FVulkanOffscreenPresenter::Present(uint32_t InImageIndex, const FVulkanSemaphore * InRenderFinished)
+{
+	FImage& state = m_ImageStates[InImageIndex];
+
+	// A present nobody acquired after, e.g. the acquire timed out
+	SubmitPendingPresent(nullptr);
+
+	FVulkanCommandBuffer* cmdBuffer = m_CmdBufferManager->GetNewCommandBuffer();
+	cmdBuffer->AddWaitSemaphore(VK_PIPELINE_STAGE_TRANSFER_BIT, InRenderFinished);
+	cmdBuffer->Begin();
+
+	if (state.Readback) {
+		VkBufferImageCopy region = {};
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.layerCount = 1;
+		region.imageExtent = { m_Extent.width, m_Extent.height, 1 };
+		vkCmdCopyImageToBuffer(cmdBuffer->GetHandle(), m_Images[InImageIndex], GetPresentLayout(), state.Readback->GetBuffer(), 1, &region);
+
+		VkBufferMemoryBarrier barrier = {};
+		barrier.sType = VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER;
+		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+		barrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+		barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+		barrier.buffer = state.Readback->GetBuffer();
+		barrier.offset = 0;
+		barrier.size = VK_WHOLE_SIZE;
+		vkCmdPipelineBarrier(cmdBuffer->GetHandle(), VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 0, nullptr, 1, &barrier, 0, nullptr);
+	}
+
+	cmdBuffer->End();
+	m_PendingPresent = cmdBuffer;
+	m_PendingPresentImage = InImageIndex;
+
+	return VK_SUCCESS;
+}
+
+void FVulkanOffscreenPresenter::SubmitPendingPresent(const FVulkanSemaphore * InSignalSemaphore)
+{
+	if (!m_PendingPresent) return;
+
+	if (InSignalSemaphore) {
+		m_PendingPresent->AddSignalSemaphore(InSignalSemaphore);
+	}
+
+	const uint64_t serial = m_Queue->Submit(m_PendingPresent);
+	m_PendingPresent = nullptr;
+
+	if (m_PendingPresentImage < m_ImageStates.size()) {
+		FImage& state = m_ImageStates[m_PendingPresentImage];
+		state.PresentSerial = serial;
+		state.bReadbackPending = state.Readback != nullptr;
+	}
+}
+
+void FVulkanOffscreenPresenter::WaitIdle()
+{
+	SubmitPendingPresent(nullptr);
+
+	for (size_t i = 0; i < m_ImageStates.size(); i++) {
+		m_Queue->WaitForSerial(m_ImageStates[i].PresentSerial);
+	}
+
+	// Oldest present first, the ring hands images out in order
+	for (size_t i = 0; i < m_ImageStates.size(); i++) {
+		DeliverReadback((m_NextImage + i) % static_cast<uint32_t>(m_ImageStates.size()));
+	}
+}
+
+void FVulkanOffscreenPresenter::DeliverReadback(uint32_t InImageIndex)
+{
+	FImage& state = m_ImageStates[InImageIndex];
+	if (!state.bReadbackPending) return;
+
+	state.bReadbackPending = false;
+	if (m_ReadbackCallback) {
+		m_ReadbackCallback(InImageIndex, state.Readback->GetMappedData(), m_Extent.width * m_TexelSize);
+	}
+}
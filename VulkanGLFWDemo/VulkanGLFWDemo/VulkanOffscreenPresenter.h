@@ -0,0 +1,85 @@
+#pragma once
+#include <functional>
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VulkanMemory.h"
+
+class FVulkanDevice;
+class FVulkanQueue;
+class FVulkanCommandBuffer;
+class FVulkanCommandBufferManager;
+class FVulkanReadbackBuffer;
+
+// Stands in for the VkSwapchainKHR of a headless window: a ring of color images that are
+// "acquired" and "presented" with queue submissions, so the frame loop stays exactly the same.
+// Nothing waits for a vblank, a frame only waits for the image it renders into to come back.
+// A present is only submitted by the next acquire, so that one submission both copies the
+// presented image back and signals the semaphore of the acquired one.
+class FVulkanOffscreenPresenter
+{
+public:
+	// Called from AcquireNextImage once the copy of a presented image has completed.
+	// InData holds the image tightly packed, InRowPitch bytes per row.
+	typedef std::function<void(uint32_t InImageIndex, const void* InData, uint32_t InRowPitch)> ReadbackCallbackFunction;
+
+	FVulkanOffscreenPresenter(const FVulkanDevice* InDevice, FVulkanQueue* InQueue);
+	~FVulkanOffscreenPresenter();
+
+	void Setup(VkExtent2D InExtent, VkFormat InFormat, uint32_t InImageCount);
+	void Release();
+
+	// Takes effect the next time the images are created
+	inline void SetReadbackCallback(ReadbackCallbackFunction InCallback)
+	{
+		m_ReadbackCallback = InCallback;
+	}
+
+	inline const std::vector<VkImage>& GetImages() const
+	{
+		return m_Images;
+	}
+
+	// Layout the images have to be in when presented, the render pass leaves them in it
+	inline VkImageLayout GetPresentLayout() const
+	{
+		return VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+	}
+
+	VkResult AcquireNextImage(const FVulkanSemaphore* InImageAvailable, uint32_t& OutImageIndex, uint64_t InTimeoutNs);
+	VkResult Present(uint32_t InImageIndex, const FVulkanSemaphore* InRenderFinished);
+
+	// Waits for every present and hands out the readbacks still pending
+	void WaitIdle();
+
+private:
+	struct FImage
+	{
+		FVulkanAllocation Allocation;
+		std::unique_ptr<FVulkanReadbackBuffer> Readback;
+		uint64_t PresentSerial = 0;
+		bool bReadbackPending = false;
+	};
+
+	void DeliverReadback(uint32_t InImageIndex);
+	// InSignalSemaphore may be null
+	void SubmitPendingPresent(const FVulkanSemaphore* InSignalSemaphore);
+
+private:
+	const FVulkanDevice* m_Device;
+	FVulkanQueue* m_Queue;
+	std::unique_ptr<FVulkanCommandBufferManager> m_CmdBufferManager;
+
+	VkExtent2D m_Extent;
+	uint32_t m_TexelSize;
+	uint32_t m_NextImage;
+
+	std::vector<VkImage> m_Images;
+	std::vector<FImage> m_ImageStates;
+
+	// Recorded by Present, submitted by the next acquire. UINT32_MAX for the empty one of the first acquire.
+	FVulkanCommandBuffer* m_PendingPresent;
+	uint32_t m_PendingPresentImage;
+
+	ReadbackCallbackFunction m_ReadbackCallback;
+};
@@ -0,0 +1,189 @@
+#include "VulkanParallelRecorder.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanCommandBuffer.h"
+
+FVulkanParallelRecorder::FVulkanParallelRecorder(const FVulkanDevice * InDevice, FVulkanQueue * InQueue, uint32_t InNumThreads)
+	:m_Device(InDevice), m_bQuit(false), m_JobSerial(0), m_NumBusyWorkers(0), m_Func(nullptr), m_NumTasks(0), m_NumJobWorkers(0), m_NextTask(0), m_NumFinishedTasks(0), m_bFailed(false)
+{
+	m_Inheritance = {};
+	m_Inheritance.sType = VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO;
+
+	if (InNumThreads == 0) {
+		InNumThreads = std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	m_Workers.resize(InNumThreads);
+	for (uint32_t i = 0; i < InNumThreads; i++)
+	{
+		m_Workers[i].CmdBufferManager.reset(new FVulkanCommandBufferManager(m_Device, InQueue));
+	}
+	for (uint32_t i = 0; i < InNumThreads; i++)
+	{
+		m_Workers[i].Thread = std::thread(&FVulkanParallelRecorder::WorkerLoop, this, i);
+	}
+}
+
+FVulkanParallelRecorder::~FVulkanParallelRecorder()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bQuit = true;
+	}
+	m_WorkReady.notify_all();
+
+	for (size_t i = 0; i < m_Workers.size(); i++)
+	{
+		m_Workers[i].Thread.join();
+	}
+	m_Workers.clear();
+}
+
+void FVulkanParallelRecorder::Record(FVulkanCommandBuffer * InPrimary, VkRenderPass InRenderPass, uint32_t InSubpass, VkFramebuffer InFramebuffer,
+	uint32_t InNumTasks, const RecordFunc & InFunc)
+{
+	if (InNumTasks == 0 || !InPrimary->IsInsideRenderPass()) return;
+
+	RecordTasks(InRenderPass, InSubpass, InFramebuffer, InNumTasks, InFunc, GetNumThreads());
+
+	// Keep task order so the draw order doesn't depend on thread scheduling
+	InPrimary->ExecuteCommands(m_Recorded.data(), InNumTasks);
+}
+
+void FVulkanParallelRecorder::RunBenchmark(VkRenderPass InRenderPass, uint32_t InSubpass, VkFramebuffer InFramebuffer,
+	uint32_t InNumTasks, const RecordFunc & InFunc, uint32_t InIterations)
+{
+	if (InNumTasks == 0 || InIterations == 0) return;
+
+	printf("parallel recording, %u secondary command buffers, %u iterations\n", InNumTasks, InIterations);
+
+	double singleMs = 0.0;
+	for (uint32_t numWorkers = 1;; numWorkers = std::min(numWorkers * 2, GetNumThreads()))
+	{
+		const auto start = std::chrono::steady_clock::now();
+		for (uint32_t i = 0; i < InIterations; i++) {
+			RecordTasks(InRenderPass, InSubpass, InFramebuffer, InNumTasks, InFunc, numWorkers);
+			RecycleRecorded();
+		}
+		const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / InIterations;
+
+		if (numWorkers == 1) {
+			singleMs = ms;
+		}
+		printf("  %2u threads %8.3f ms  %5.2fx\n", numWorkers, ms, singleMs / ms);
+
+		if (numWorkers == GetNumThreads()) break;
+	}
+}
+
+void FVulkanParallelRecorder::RecordTasks(VkRenderPass InRenderPass, uint32_t InSubpass, VkFramebuffer InFramebuffer,
+	uint32_t InNumTasks, const RecordFunc & InFunc, uint32_t InNumWorkers)
+{
+	{
+		// A worker that woke up late for the previous job must be done with it before the job state changes
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkDone.wait(lock, [this] { return m_NumBusyWorkers == 0; });
+
+		m_Func = &InFunc;
+		m_Inheritance.renderPass = InRenderPass;
+		m_Inheritance.subpass = InSubpass;
+		m_Inheritance.framebuffer = InFramebuffer;
+		m_NumTasks = InNumTasks;
+		m_NumJobWorkers = InNumWorkers;
+		m_NextTask = 0;
+		m_NumFinishedTasks = 0;
+		m_Recorded.assign(InNumTasks, nullptr);
+		m_Error = nullptr;
+		m_bFailed = false;
+		m_JobSerial++;
+	}
+	m_WorkReady.notify_all();
+
+	{
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkDone.wait(lock, [this] { return m_NumFinishedTasks == m_NumTasks && m_NumBusyWorkers == 0; });
+		m_Func = nullptr;
+	}
+
+	if (m_Error) {
+		RecycleRecorded();
+		std::rethrow_exception(m_Error);
+	}
+}
+
+void FVulkanParallelRecorder::RecycleRecorded()
+{
+	for (FVulkanCommandBuffer* cmdBuffer : m_Recorded)
+	{
+		if (cmdBuffer) {
+			cmdBuffer->OnSubmissionCompleted();
+		}
+	}
+	m_Recorded.clear();
+}
+
+void FVulkanParallelRecorder::WorkerLoop(uint32_t InWorkerIndex)
+{
+	FVulkanCommandBufferManager* cmdBufferManager = m_Workers[InWorkerIndex].CmdBufferManager.get();
+	uint64_t lastJobSerial = 0;
+
+	for (;;)
+	{
+		{
+			std::unique_lock<std::mutex> lock(m_Mutex);
+			m_WorkReady.wait(lock, [this, lastJobSerial] { return m_bQuit || m_JobSerial != lastJobSerial; });
+			if (m_bQuit) return;
+			lastJobSerial = m_JobSerial;
+			m_NumBusyWorkers++;
+		}
+
+		// Workers beyond the job's count sit it out, e.g. while benchmarking fewer threads
+		uint32_t numRecorded = 0;
+		for (;;)
+		{
+			if (InWorkerIndex >= m_NumJobWorkers) break;
+
+			uint32_t taskIndex = m_NextTask.fetch_add(1);
+			if (taskIndex >= m_NumTasks) break;
+
+			numRecorded++;
+			if (m_bFailed) continue;
+
+			FVulkanCommandBuffer* cmdBuffer = nullptr;
+			try
+			{
+				cmdBuffer = cmdBufferManager->GetNewSecondaryCommandBuffer();
+				cmdBuffer->BeginSecondary(m_Inheritance);
+				(*m_Func)(cmdBuffer, taskIndex);
+				cmdBuffer->End();
+			}
+			catch (...)
+			{
+				// The worker stays alive, Record() rethrows on the calling thread
+				if (cmdBuffer && (cmdBuffer->HasBegun() || cmdBuffer->IsInsideRenderPass())) {
+					cmdBuffer->End();
+				}
+
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				if (!m_Error) {
+					m_Error = std::current_exception();
+				}
+				m_bFailed = true;
+			}
+
+			m_Recorded[taskIndex] = cmdBuffer;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(m_Mutex);
+			m_NumFinishedTasks += numRecorded;
+			m_NumBusyWorkers--;
+			if (m_NumBusyWorkers == 0) {
+				m_WorkDone.notify_all();
+			}
+		}
+	}
+}
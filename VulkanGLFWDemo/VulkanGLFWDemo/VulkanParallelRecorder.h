@@ -0,0 +1,83 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class FVulkanDevice;
+class FVulkanQueue;
+class FVulkanCommandBuffer;
+class FVulkanCommandBufferManager;
+
+// Records the contents of a render pass as secondary command buffers on a pool of worker threads.
+// Every worker owns a FVulkanCommandBufferManager, so no command pool is ever shared between threads.
+class FVulkanParallelRecorder
+{
+public:
+	// InNumThreads = 0 uses one worker per hardware thread
+	FVulkanParallelRecorder(const FVulkanDevice* InDevice, FVulkanQueue* InQueue, uint32_t InNumThreads = 0);
+	~FVulkanParallelRecorder();
+
+	// Called on a worker with a secondary command buffer that already continues the render pass
+	typedef std::function<void(FVulkanCommandBuffer* InCmdBuffer, uint32_t InTaskIndex)> RecordFunc;
+
+	// Records InNumTasks secondary command buffers in parallel and executes them from InPrimary.
+	// InPrimary must be inside a render pass begun with VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS.
+	// An exception thrown by InFunc is rethrown here once all workers are idle, nothing is executed then.
+	void Record(FVulkanCommandBuffer* InPrimary, VkRenderPass InRenderPass, uint32_t InSubpass, VkFramebuffer InFramebuffer,
+		uint32_t InNumTasks, const RecordFunc& InFunc);
+
+	// Records InNumTasks secondary command buffers with 1, 2, 4 ... GetNumThreads() workers, InIterations
+	// times each, and prints the recording time per frame and the speedup over a single worker.
+	// Nothing is executed, the command buffers are recycled right away.
+	void RunBenchmark(VkRenderPass InRenderPass, uint32_t InSubpass, VkFramebuffer InFramebuffer,
+		uint32_t InNumTasks, const RecordFunc& InFunc, uint32_t InIterations = 50);
+
+	inline uint32_t GetNumThreads() const
+	{
+		return static_cast<uint32_t>(m_Workers.size());
+	}
+
+private:
+	struct FWorker
+	{
+		std::thread Thread;
+		std::unique_ptr<FVulkanCommandBufferManager> CmdBufferManager;
+	};
+
+	// Records into m_Recorded with the first InNumWorkers workers, rethrows what a task threw
+	void RecordTasks(VkRenderPass InRenderPass, uint32_t InSubpass, VkFramebuffer InFramebuffer,
+		uint32_t InNumTasks, const RecordFunc& InFunc, uint32_t InNumWorkers);
+	// Gives back recorded command buffers that will never be executed
+	void RecycleRecorded();
+
+	void WorkerLoop(uint32_t InWorkerIndex);
+
+private:
+	const FVulkanDevice* m_Device;
+	std::vector<FWorker> m_Workers;
+
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkDone;
+	bool m_bQuit;
+	uint64_t m_JobSerial;
+	uint32_t m_NumBusyWorkers;
+
+	// Current job, only valid while Record() is waiting on the workers
+	const RecordFunc* m_Func;
+	VkCommandBufferInheritanceInfo m_Inheritance;
+	uint32_t m_NumTasks;
+	uint32_t m_NumJobWorkers;
+	std::atomic<uint32_t> m_NextTask;
+	uint32_t m_NumFinishedTasks;
+	std::vector<FVulkanCommandBuffer*> m_Recorded;
+	// First exception thrown by a task, the remaining tasks are skipped
+	std::exception_ptr m_Error;
+	std::atomic<bool> m_bFailed;
+};
@@ -5,6 +5,7 @@
 #include "VulkanRenderPass.h"
 #include "VulkanDescriptorSet.h"
 #include "VulkanShader.h"
+#include "VulkanCommandBuffer.h"
 
 
 FVulkanGraphicsPipeline::FVulkanGraphicsPipeline(const FVulkanDevice * InDevice)
@@ -171,3 +172,115 @@ void FVulkanGraphicsPipeline::CreateGraphicsPipeline(
 		throw std::runtime_error("failed to create graphics pipeline!");
 	}
 }
+
+
+FVulkanComputePipeline::FVulkanComputePipeline(const FVulkanDevice * InDevice)
+	:m_Device(InDevice), m_PipelineLayout(VK_NULL_HANDLE), m_ComputePipeline(VK_NULL_HANDLE), m_PushConstantSize(0)
+{
+}
+
+FVulkanComputePipeline::~FVulkanComputePipeline()
+{
+}
+
+void FVulkanComputePipeline::Setup(const FVulkanDescriptorSetManager * InSetManager, const FVulkanShader * InShader, uint32_t InPushConstantSize)
+{
+	std::vector<VkPipelineShaderStageCreateInfo> shaderStages;
+	InShader->GetShaderStages(shaderStages);
+
+	const VkPipelineShaderStageCreateInfo* computeStage = nullptr;
+	for (const auto& stage : shaderStages)
+	{
+		if (stage.stage == VK_SHADER_STAGE_COMPUTE_BIT) {
+			computeStage = &stage;
+			break;
+		}
+	}
+	if (!computeStage) {
+		throw std::runtime_error("failed to find compute shader stage!");
+	}
+
+	std::vector<VkDescriptorSetLayout> setLayouts;
+	InSetManager->GetLayouts(setLayouts);
+
+	VkPushConstantRange pushConstantRange = {};
+	pushConstantRange.stageFlags = VK_SHADER_STAGE_COMPUTE_BIT;
+	pushConstantRange.offset = 0;
+	pushConstantRange.size = InPushConstantSize;
+	m_PushConstantSize = InPushConstantSize;
+
+	VkPipelineLayoutCreateInfo pipelineLayoutInfo = {};
+	pipelineLayoutInfo.sType = VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO;
+	pipelineLayoutInfo.setLayoutCount = static_cast<uint32_t>(setLayouts.size());
+	pipelineLayoutInfo.pSetLayouts = setLayouts.data();
+	pipelineLayoutInfo.pushConstantRangeCount = InPushConstantSize > 0 ? 1 : 0;
+	pipelineLayoutInfo.pPushConstantRanges = InPushConstantSize > 0 ? &pushConstantRange : nullptr;
+
+	if (vkCreatePipelineLayout(m_Device->GetLogicalDevice(), &pipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline layout!");
+	}
+
+	VkComputePipelineCreateInfo pipelineInfo = {};
+	pipelineInfo.sType = VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO;
+	pipelineInfo.stage = *computeStage;
+	pipelineInfo.layout = m_PipelineLayout;
+	pipelineInfo.basePipelineHandle = VK_NULL_HANDLE;
+	pipelineInfo.basePipelineIndex = -1;
+
+	if (vkCreateComputePipelines(m_Device->GetLogicalDevice(), VK_NULL_HANDLE, 1, &pipelineInfo, nullptr, &m_ComputePipeline) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create compute pipeline!");
+	}
+}
+
+void FVulkanComputePipeline::Release()
+{
+	vkDestroyPipeline(m_Device->GetLogicalDevice(), m_ComputePipeline, nullptr);
+	vkDestroyPipelineLayout(m_Device->GetLogicalDevice(), m_PipelineLayout, nullptr);
+	m_ComputePipeline = VK_NULL_HANDLE;
+	m_PipelineLayout = VK_NULL_HANDLE;
+}
+
+void FVulkanComputePipeline::Bind(FVulkanCommandBuffer * InCmdBuffer) const
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	vkCmdBindPipeline(InCmdBuffer->GetHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_ComputePipeline);
+}
+
+void FVulkanComputePipeline::BindDescriptorSets(FVulkanCommandBuffer * InCmdBuffer, const FVulkanDescriptorSet * const * InSets, uint32_t InNumSets, uint32_t InFirstSet) const
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	std::vector<VkDescriptorSet> sets(InNumSets);
+	for (uint32_t i = 0; i < InNumSets; i++)
+	{
+		sets[i] = InSets[i]->GetHandle();
+	}
+
+	vkCmdBindDescriptorSets(InCmdBuffer->GetHandle(), VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, InFirstSet, InNumSets, sets.data(), 0, nullptr);
+}
+
+void FVulkanComputePipeline::PushConstants(FVulkanCommandBuffer * InCmdBuffer, const void * InData, uint32_t InSize, uint32_t InOffset) const
+{
+	if (!InCmdBuffer->HasBegun()) return;
+	if (InOffset + InSize > m_PushConstantSize) return;
+
+	vkCmdPushConstants(InCmdBuffer->GetHandle(), m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, InOffset, InSize, InData);
+}
+
+void FVulkanComputePipeline::Dispatch(FVulkanCommandBuffer * InCmdBuffer, uint32_t InGroupCountX, uint32_t InGroupCountY, uint32_t InGroupCountZ) const
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	InCmdBuffer->GetImageStates().Flush();
+	vkCmdDispatch(InCmdBuffer->GetHandle(), InGroupCountX, InGroupCountY, InGroupCountZ);
+}
+
+void FVulkanComputePipeline::DispatchIndirect(FVulkanCommandBuffer * InCmdBuffer, VkBuffer InArgsBuffer, VkDeviceSize InArgsOffset) const
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	InCmdBuffer->GetImageStates().Flush();
+	vkCmdDispatchIndirect(InCmdBuffer->GetHandle(), InArgsBuffer, InArgsOffset);
+}
+
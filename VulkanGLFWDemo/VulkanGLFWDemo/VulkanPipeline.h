@@ -7,6 +7,8 @@ class FVulkanRenderTargetInfo;
 class FVulkanRenderPass;
 class FVulkanDescriptorSetManager;
 class FVulkanShader;
+class FVulkanDescriptorSet;
+class FVulkanCommandBuffer;
 
 
 class FVulkanGraphicsPipeline
@@ -36,3 +38,46 @@ private:
 	VkPipeline m_GraphicsPipeline;
 
 };
+
+
+class FVulkanComputePipeline
+{
+public:
+	FVulkanComputePipeline(const FVulkanDevice* InDevice);
+	~FVulkanComputePipeline();
+
+	// InShader needs a SHADER_TYPE_COMPUTE stage, InPushConstantSize = 0 creates no push constant range
+	void Setup(const FVulkanDescriptorSetManager* InSetManager, const FVulkanShader* InShader, uint32_t InPushConstantSize = 0);
+	void Release();
+
+	inline VkPipeline GetHandle() const
+	{
+		return m_ComputePipeline;
+	}
+
+	inline VkPipelineLayout GetLayout() const
+	{
+		return m_PipelineLayout;
+	}
+
+	// Recording helpers, the command buffer must have begun and be outside a render pass
+	void Bind(FVulkanCommandBuffer* InCmdBuffer) const;
+	void BindDescriptorSets(FVulkanCommandBuffer* InCmdBuffer, const FVulkanDescriptorSet* const* InSets, uint32_t InNumSets, uint32_t InFirstSet = 0) const;
+	void PushConstants(FVulkanCommandBuffer* InCmdBuffer, const void* InData, uint32_t InSize, uint32_t InOffset = 0) const;
+
+	void Dispatch(FVulkanCommandBuffer* InCmdBuffer, uint32_t InGroupCountX, uint32_t InGroupCountY, uint32_t InGroupCountZ) const;
+	// Group counts are read from a VkDispatchIndirectCommand in InArgsBuffer (created with VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT)
+	void DispatchIndirect(FVulkanCommandBuffer* InCmdBuffer, VkBuffer InArgsBuffer, VkDeviceSize InArgsOffset) const;
+
+	static inline uint32_t GetGroupCount(uint32_t InThreadCount, uint32_t InGroupSize)
+	{
+		return (InThreadCount + InGroupSize - 1) / InGroupSize;
+	}
+
+private:
+	const FVulkanDevice* m_Device;
+
+	VkPipelineLayout m_PipelineLayout;
+	VkPipeline m_ComputePipeline;
+	uint32_t m_PushConstantSize;
+};
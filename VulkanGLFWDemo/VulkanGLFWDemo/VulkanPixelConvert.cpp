@@ -0,0 +1,764 @@
+#include "VulkanPixelConvert.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define VULKAN_PIXEL_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#else
+#include <cpuid.h>
+#endif
+#elif defined(__ARM_NEON) || defined(_M_ARM64)
+#define VULKAN_PIXEL_NEON 1
+#include <arm_neon.h>
+#endif
+
+// GCC and Clang only emit SSE4.1/AVX2 instructions in functions marked for them,
+// MSVC allows the intrinsics anywhere
+#if VULKAN_PIXEL_X86 && !defined(_MSC_VER)
+#define VULKAN_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define VULKAN_TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define VULKAN_TARGET_SSE41
+#define VULKAN_TARGET_AVX2
+#endif
+
+typedef FVulkanPixelConvert::ESimdLevel ESimdLevel;
+
+namespace
+{
+	// 8 bit fixed point, limited range: 255/219 * 256 = 298 for luma
+	struct FYuvCoefficients
+	{
+		int32_t YMul;
+		int32_t RV;
+		int32_t GU;
+		int32_t GV;
+		int32_t BU;
+	};
+
+	const FYuvCoefficients YuvBT601 = { 298, 409, -100, -208, 516 };
+	const FYuvCoefficients YuvBT709 = { 298, 459, -55, -136, 541 };
+
+	// Row kernels, the frame level functions walk the rows with their pitches
+	struct FKernels
+	{
+		void(*RGBToRGBA)(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth, bool bInSwapRB);
+		void(*SwizzleRB)(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth);
+		void(*Narrow16To8)(const uint16_t* InSrc, uint8_t* OutDst, uint32_t InCount);
+		// U and V samples are InUVStep bytes apart, 1 for I420 planes and 2 for interleaved NV12
+		void(*YuvToRGBA)(const uint8_t* InY, const uint8_t* InU, const uint8_t* InV, uint32_t InUVStep, uint8_t* OutDst, uint32_t InWidth, const FYuvCoefficients& InCoeffs);
+		// Feeds InBytes bytes into the HASH_LANES accumulators of InOutLanes
+		void(*HashRow)(const uint8_t* InSrc, uint32_t InBytes, uint32_t* InOutLanes);
+	};
+
+	// The hash runs the xxHash32 round on 8 independent 32 bit lanes, 32 bytes of a row at a time.
+	// The rest of a row goes word by word (zero padded) into lanes 0, 1, ... so every level hashes the same.
+	enum : uint32_t
+	{
+		HASH_LANES = 8,
+		HASH_CHUNK = HASH_LANES * 4,
+	};
+
+	const uint32_t HashPrime1 = 0x9E3779B1u;
+	const uint32_t HashPrime2 = 0x85EBCA77u;
+
+	inline uint32_t HashRound(uint32_t InAcc, uint32_t InWord)
+	{
+		InAcc += InWord * HashPrime2;
+		InAcc = (InAcc << 13) | (InAcc >> 19);
+		return InAcc * HashPrime1;
+	}
+
+	void HashTail(const uint8_t* InSrc, uint32_t InBytes, uint32_t* InOutLanes)
+	{
+		for (uint32_t i = 0, lane = 0; i < InBytes; i += 4, lane++) {
+			uint32_t word = 0;
+			memcpy(&word, InSrc + i, InBytes - i < 4 ? InBytes - i : 4);
+			InOutLanes[lane] = HashRound(InOutLanes[lane], word);
+		}
+	}
+
+	inline uint8_t ClampToByte(int32_t InValue)
+	{
+		return static_cast<uint8_t>(InValue < 0 ? 0 : (InValue > 255 ? 255 : InValue));
+	}
+
+	// Scalar reference
+
+	void RGBToRGBARow_Scalar(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth, bool bInSwapRB)
+	{
+		const uint32_t r = bInSwapRB ? 2 : 0;
+		const uint32_t b = bInSwapRB ? 0 : 2;
+		for (uint32_t x = 0; x < InWidth; x++) {
+			OutDst[x * 4 + 0] = InSrc[x * 3 + r];
+			OutDst[x * 4 + 1] = InSrc[x * 3 + 1];
+			OutDst[x * 4 + 2] = InSrc[x * 3 + b];
+			OutDst[x * 4 + 3] = 0xFF;
+		}
+	}
+
+	void SwizzleRBRow_Scalar(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth)
+	{
+		for (uint32_t x = 0; x < InWidth; x++) {
+			const uint8_t r = InSrc[x * 4 + 0];
+			const uint8_t b = InSrc[x * 4 + 2];
+			OutDst[x * 4 + 0] = b;
+			OutDst[x * 4 + 1] = InSrc[x * 4 + 1];
+			OutDst[x * 4 + 2] = r;
+			OutDst[x * 4 + 3] = InSrc[x * 4 + 3];
+		}
+	}
+
+	void Narrow16To8Row_Scalar(const uint16_t* InSrc, uint8_t* OutDst, uint32_t InCount)
+	{
+		for (uint32_t i = 0; i < InCount; i++) {
+			OutDst[i] = static_cast<uint8_t>(InSrc[i] >> 8);
+		}
+	}
+
+	void YuvToRGBARow_Scalar(const uint8_t* InY, const uint8_t* InU, const uint8_t* InV, uint32_t InUVStep, uint8_t* OutDst, uint32_t InWidth, const FYuvCoefficients& InCoeffs)
+	{
+		for (uint32_t x = 0; x < InWidth; x++) {
+			const int32_t c = InCoeffs.YMul * (InY[x] - 16) + 128;
+			const int32_t d = InU[(x / 2) * InUVStep] - 128;
+			const int32_t e = InV[(x / 2) * InUVStep] - 128;
+			OutDst[x * 4 + 0] = ClampToByte((c + InCoeffs.RV * e) >> 8);
+			OutDst[x * 4 + 1] = ClampToByte((c + InCoeffs.GU * d + InCoeffs.GV * e) >> 8);
+			OutDst[x * 4 + 2] = ClampToByte((c + InCoeffs.BU * d) >> 8);
+			OutDst[x * 4 + 3] = 0xFF;
+		}
+	}
+
+	void HashRow_Scalar(const uint8_t* InSrc, uint32_t InBytes, uint32_t* InOutLanes)
+	{
+		uint32_t i = 0;
+		for (; i + HASH_CHUNK <= InBytes; i += HASH_CHUNK) {
+			for (uint32_t lane = 0; lane < HASH_LANES; lane++) {
+				uint32_t word;
+				memcpy(&word, InSrc + i + lane * 4, 4);
+				InOutLanes[lane] = HashRound(InOutLanes[lane], word);
+			}
+		}
+		HashTail(InSrc + i, InBytes - i, InOutLanes);
+	}
+
+	const FKernels KernelsScalar = { RGBToRGBARow_Scalar, SwizzleRBRow_Scalar, Narrow16To8Row_Scalar, YuvToRGBARow_Scalar, HashRow_Scalar };
+
+#if VULKAN_PIXEL_X86
+
+	// SSE4.1, 4 (RGB, swizzle), 16 (narrow) or 8 (YUV) pixels per iteration
+
+	VULKAN_TARGET_SSE41 void RGBToRGBARow_SSE41(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth, bool bInSwapRB)
+	{
+		const __m128i shuffle = bInSwapRB ?
+			_mm_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m128i alpha = _mm_set1_epi32((int)0xFF000000);
+
+		// Every load reads 16 bytes for 12 used ones, stop before it runs past the row
+		uint32_t x = 0;
+		for (; x + 6 <= InWidth; x += 4) {
+			__m128i rgb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + x * 3));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(OutDst + x * 4), _mm_or_si128(_mm_shuffle_epi8(rgb, shuffle), alpha));
+		}
+		RGBToRGBARow_Scalar(InSrc + x * 3, OutDst + x * 4, InWidth - x, bInSwapRB);
+	}
+
+	VULKAN_TARGET_SSE41 void SwizzleRBRow_SSE41(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth)
+	{
+		const __m128i shuffle = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		uint32_t x = 0;
+		for (; x + 4 <= InWidth; x += 4) {
+			__m128i rgba = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + x * 4));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(OutDst + x * 4), _mm_shuffle_epi8(rgba, shuffle));
+		}
+		SwizzleRBRow_Scalar(InSrc + x * 4, OutDst + x * 4, InWidth - x);
+	}
+
+	VULKAN_TARGET_SSE41 void Narrow16To8Row_SSE41(const uint16_t* InSrc, uint8_t* OutDst, uint32_t InCount)
+	{
+		uint32_t i = 0;
+		for (; i + 16 <= InCount; i += 16) {
+			__m128i a = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + i)), 8);
+			__m128i b = _mm_srli_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + i + 8)), 8);
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(OutDst + i), _mm_packus_epi16(a, b));
+		}
+		Narrow16To8Row_Scalar(InSrc + i, OutDst + i, InCount - i);
+	}
+
+	// Chroma of 8 pixels, every sample twice
+	VULKAN_TARGET_SSE41 inline void LoadChroma8_SSE41(const uint8_t* InU, const uint8_t* InV, uint32_t InUVStep, __m128i& OutU, __m128i& OutV)
+	{
+		if (InUVStep == 2) {
+			const __m128i deinterleave = _mm_setr_epi8(0, 0, 2, 2, 4, 4, 6, 6, 1, 1, 3, 3, 5, 5, 7, 7);
+			__m128i uv = _mm_shuffle_epi8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(InU)), deinterleave);
+			OutU = uv;
+			OutV = _mm_srli_si128(uv, 8);
+		}
+		else {
+			int32_t u4, v4;
+			memcpy(&u4, InU, 4);
+			memcpy(&v4, InV, 4);
+			OutU = _mm_unpacklo_epi8(_mm_cvtsi32_si128(u4), _mm_cvtsi32_si128(u4));
+			OutV = _mm_unpacklo_epi8(_mm_cvtsi32_si128(v4), _mm_cvtsi32_si128(v4));
+		}
+	}
+
+	// Packs 8 pixels of 32 bit R, G and B (two halves each) to RGBA with opaque alpha
+	VULKAN_TARGET_SSE41 inline void StoreRGBA8_SSE41(__m128i InR0, __m128i InR1, __m128i InG0, __m128i InG1, __m128i InB0, __m128i InB1, uint8_t* OutDst)
+	{
+		const __m128i alpha = _mm_set1_epi8((char)0xFF);
+		__m128i r = _mm_packus_epi16(_mm_packs_epi32(InR0, InR1), alpha);
+		__m128i g = _mm_packus_epi16(_mm_packs_epi32(InG0, InG1), alpha);
+		__m128i b = _mm_packus_epi16(_mm_packs_epi32(InB0, InB1), alpha);
+
+		__m128i rg = _mm_unpacklo_epi8(r, g);
+		__m128i ba = _mm_unpacklo_epi8(b, alpha);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(OutDst), _mm_unpacklo_epi16(rg, ba));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(OutDst + 16), _mm_unpackhi_epi16(rg, ba));
+	}
+
+	VULKAN_TARGET_SSE41 void YuvToRGBARow_SSE41(const uint8_t* InY, const uint8_t* InU, const uint8_t* InV, uint32_t InUVStep, uint8_t* OutDst, uint32_t InWidth, const FYuvCoefficients& InCoeffs)
+	{
+		const __m128i yOffset = _mm_set1_epi32(16);
+		const __m128i uvOffset = _mm_set1_epi32(128);
+		const __m128i yMul = _mm_set1_epi32(InCoeffs.YMul);
+		const __m128i rv = _mm_set1_epi32(InCoeffs.RV);
+		const __m128i gu = _mm_set1_epi32(InCoeffs.GU);
+		const __m128i gv = _mm_set1_epi32(InCoeffs.GV);
+		const __m128i bu = _mm_set1_epi32(InCoeffs.BU);
+
+		uint32_t x = 0;
+		for (; x + 8 <= InWidth; x += 8) {
+			__m128i y8 = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(InY + x));
+			__m128i u8, v8;
+			LoadChroma8_SSE41(InU + (x / 2) * InUVStep, InV + (x / 2) * InUVStep, InUVStep, u8, v8);
+
+			__m128i r[2], g[2], b[2];
+			for (int half = 0; half < 2; half++) {
+				__m128i y = _mm_cvtepu8_epi32(half ? _mm_srli_si128(y8, 4) : y8);
+				__m128i d = _mm_sub_epi32(_mm_cvtepu8_epi32(half ? _mm_srli_si128(u8, 4) : u8), uvOffset);
+				__m128i e = _mm_sub_epi32(_mm_cvtepu8_epi32(half ? _mm_srli_si128(v8, 4) : v8), uvOffset);
+				__m128i c = _mm_add_epi32(_mm_mullo_epi32(_mm_sub_epi32(y, yOffset), yMul), uvOffset);
+
+				r[half] = _mm_srai_epi32(_mm_add_epi32(c, _mm_mullo_epi32(e, rv)), 8);
+				g[half] = _mm_srai_epi32(_mm_add_epi32(c, _mm_add_epi32(_mm_mullo_epi32(d, gu), _mm_mullo_epi32(e, gv))), 8);
+				b[half] = _mm_srai_epi32(_mm_add_epi32(c, _mm_mullo_epi32(d, bu)), 8);
+			}
+			StoreRGBA8_SSE41(r[0], r[1], g[0], g[1], b[0], b[1], OutDst + x * 4);
+		}
+		YuvToRGBARow_Scalar(InY + x, InU + (x / 2) * InUVStep, InV + (x / 2) * InUVStep, InUVStep, OutDst + x * 4, InWidth - x, InCoeffs);
+	}
+
+	VULKAN_TARGET_SSE41 inline __m128i HashRound_SSE41(__m128i InAcc, __m128i InWords)
+	{
+		InAcc = _mm_add_epi32(InAcc, _mm_mullo_epi32(InWords, _mm_set1_epi32((int)HashPrime2)));
+		InAcc = _mm_or_si128(_mm_slli_epi32(InAcc, 13), _mm_srli_epi32(InAcc, 19));
+		return _mm_mullo_epi32(InAcc, _mm_set1_epi32((int)HashPrime1));
+	}
+
+	VULKAN_TARGET_SSE41 void HashRow_SSE41(const uint8_t* InSrc, uint32_t InBytes, uint32_t* InOutLanes)
+	{
+		__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InOutLanes));
+		__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InOutLanes + 4));
+
+		uint32_t i = 0;
+		for (; i + HASH_CHUNK <= InBytes; i += HASH_CHUNK) {
+			lo = HashRound_SSE41(lo, _mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + i)));
+			hi = HashRound_SSE41(hi, _mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + i + 16)));
+		}
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(InOutLanes), lo);
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(InOutLanes + 4), hi);
+		HashTail(InSrc + i, InBytes - i, InOutLanes);
+	}
+
+	const FKernels KernelsSSE41 = { RGBToRGBARow_SSE41, SwizzleRBRow_SSE41, Narrow16To8Row_SSE41, YuvToRGBARow_SSE41, HashRow_SSE41 };
+
+	// AVX2, twice the pixels of the SSE4.1 kernels. Byte shuffles stay within 128 bit lanes.
+
+	VULKAN_TARGET_AVX2 void RGBToRGBARow_AVX2(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth, bool bInSwapRB)
+	{
+		const __m256i shuffle = bInSwapRB ?
+			_mm256_setr_epi8(2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1, 2, 1, 0, -1, 5, 4, 3, -1, 8, 7, 6, -1, 11, 10, 9, -1) :
+			_mm256_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1, 0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+		const __m256i alpha = _mm256_set1_epi32((int)0xFF000000);
+
+		// 4 pixels per lane, the upper lane is loaded 12 bytes further
+		uint32_t x = 0;
+		for (; x + 10 <= InWidth; x += 8) {
+			__m128i lo = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + x * 3));
+			__m128i hi = _mm_loadu_si128(reinterpret_cast<const __m128i*>(InSrc + x * 3 + 12));
+			__m256i rgb = _mm256_inserti128_si256(_mm256_castsi128_si256(lo), hi, 1);
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(OutDst + x * 4), _mm256_or_si256(_mm256_shuffle_epi8(rgb, shuffle), alpha));
+		}
+		RGBToRGBARow_SSE41(InSrc + x * 3, OutDst + x * 4, InWidth - x, bInSwapRB);
+	}
+
+	VULKAN_TARGET_AVX2 void SwizzleRBRow_AVX2(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth)
+	{
+		const __m256i shuffle = _mm256_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15, 2, 1, 0, 3, 6, 5, 4, 7, 10, 9, 8, 11, 14, 13, 12, 15);
+
+		uint32_t x = 0;
+		for (; x + 8 <= InWidth; x += 8) {
+			__m256i rgba = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(InSrc + x * 4));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(OutDst + x * 4), _mm256_shuffle_epi8(rgba, shuffle));
+		}
+		SwizzleRBRow_SSE41(InSrc + x * 4, OutDst + x * 4, InWidth - x);
+	}
+
+	VULKAN_TARGET_AVX2 void Narrow16To8Row_AVX2(const uint16_t* InSrc, uint8_t* OutDst, uint32_t InCount)
+	{
+		uint32_t i = 0;
+		for (; i + 32 <= InCount; i += 32) {
+			__m256i a = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(InSrc + i)), 8);
+			__m256i b = _mm256_srli_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(InSrc + i + 16)), 8);
+			// The pack interleaves the lanes of a and b, put them back in order
+			__m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+			_mm256_storeu_si256(reinterpret_cast<__m256i*>(OutDst + i), packed);
+		}
+		Narrow16To8Row_SSE41(InSrc + i, OutDst + i, InCount - i);
+	}
+
+	VULKAN_TARGET_AVX2 void YuvToRGBARow_AVX2(const uint8_t* InY, const uint8_t* InU, const uint8_t* InV, uint32_t InUVStep, uint8_t* OutDst, uint32_t InWidth, const FYuvCoefficients& InCoeffs)
+	{
+		const __m256i yOffset = _mm256_set1_epi32(16);
+		const __m256i uvOffset = _mm256_set1_epi32(128);
+		const __m256i yMul = _mm256_set1_epi32(InCoeffs.YMul);
+		const __m256i rv = _mm256_set1_epi32(InCoeffs.RV);
+		const __m256i gu = _mm256_set1_epi32(InCoeffs.GU);
+		const __m256i gv = _mm256_set1_epi32(InCoeffs.GV);
+		const __m256i bu = _mm256_set1_epi32(InCoeffs.BU);
+
+		// 8 pixels in one register each, half the multiplies of the SSE4.1 kernel
+		uint32_t x = 0;
+		for (; x + 8 <= InWidth; x += 8) {
+			__m128i u8, v8;
+			LoadChroma8_SSE41(InU + (x / 2) * InUVStep, InV + (x / 2) * InUVStep, InUVStep, u8, v8);
+
+			__m256i y = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(InY + x)));
+			__m256i d = _mm256_sub_epi32(_mm256_cvtepu8_epi32(u8), uvOffset);
+			__m256i e = _mm256_sub_epi32(_mm256_cvtepu8_epi32(v8), uvOffset);
+			__m256i c = _mm256_add_epi32(_mm256_mullo_epi32(_mm256_sub_epi32(y, yOffset), yMul), uvOffset);
+
+			__m256i r = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(e, rv)), 8);
+			__m256i g = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_add_epi32(_mm256_mullo_epi32(d, gu), _mm256_mullo_epi32(e, gv))), 8);
+			__m256i b = _mm256_srai_epi32(_mm256_add_epi32(c, _mm256_mullo_epi32(d, bu)), 8);
+
+			StoreRGBA8_SSE41(_mm256_castsi256_si128(r), _mm256_extracti128_si256(r, 1),
+				_mm256_castsi256_si128(g), _mm256_extracti128_si256(g, 1),
+				_mm256_castsi256_si128(b), _mm256_extracti128_si256(b, 1), OutDst + x * 4);
+		}
+		YuvToRGBARow_Scalar(InY + x, InU + (x / 2) * InUVStep, InV + (x / 2) * InUVStep, InUVStep, OutDst + x * 4, InWidth - x, InCoeffs);
+	}
+
+	// All 8 lanes in one register
+	VULKAN_TARGET_AVX2 void HashRow_AVX2(const uint8_t* InSrc, uint32_t InBytes, uint32_t* InOutLanes)
+	{
+		const __m256i prime1 = _mm256_set1_epi32((int)HashPrime1);
+		const __m256i prime2 = _mm256_set1_epi32((int)HashPrime2);
+		__m256i acc = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(InOutLanes));
+
+		uint32_t i = 0;
+		for (; i + HASH_CHUNK <= InBytes; i += HASH_CHUNK) {
+			__m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(InSrc + i));
+			acc = _mm256_add_epi32(acc, _mm256_mullo_epi32(words, prime2));
+			acc = _mm256_or_si256(_mm256_slli_epi32(acc, 13), _mm256_srli_epi32(acc, 19));
+			acc = _mm256_mullo_epi32(acc, prime1);
+		}
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(InOutLanes), acc);
+		HashTail(InSrc + i, InBytes - i, InOutLanes);
+	}
+
+	const FKernels KernelsAVX2 = { RGBToRGBARow_AVX2, SwizzleRBRow_AVX2, Narrow16To8Row_AVX2, YuvToRGBARow_AVX2, HashRow_AVX2 };
+
+	void CpuId(int32_t OutInfo[4], int32_t InLeaf, int32_t InSubLeaf)
+	{
+#ifdef _MSC_VER
+		__cpuidex(OutInfo, InLeaf, InSubLeaf);
+#else
+		unsigned int a, b, c, d;
+		__cpuid_count(InLeaf, InSubLeaf, a, b, c, d);
+		OutInfo[0] = a; OutInfo[1] = b; OutInfo[2] = c; OutInfo[3] = d;
+#endif
+	}
+
+	uint64_t ReadXCR0()
+	{
+#ifdef _MSC_VER
+		return _xgetbv(0);
+#else
+		uint32_t eax, edx;
+		__asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(0));
+		return ((uint64_t)edx << 32) | eax;
+#endif
+	}
+
+#elif VULKAN_PIXEL_NEON
+
+	// NEON, 16 (RGB, swizzle, narrow) or 8 (YUV) pixels per iteration
+
+	void RGBToRGBARow_NEON(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth, bool bInSwapRB)
+	{
+		uint32_t x = 0;
+		for (; x + 16 <= InWidth; x += 16) {
+			uint8x16x3_t rgb = vld3q_u8(InSrc + x * 3);
+			uint8x16x4_t rgba;
+			rgba.val[0] = bInSwapRB ? rgb.val[2] : rgb.val[0];
+			rgba.val[1] = rgb.val[1];
+			rgba.val[2] = bInSwapRB ? rgb.val[0] : rgb.val[2];
+			rgba.val[3] = vdupq_n_u8(0xFF);
+			vst4q_u8(OutDst + x * 4, rgba);
+		}
+		RGBToRGBARow_Scalar(InSrc + x * 3, OutDst + x * 4, InWidth - x, bInSwapRB);
+	}
+
+	void SwizzleRBRow_NEON(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth)
+	{
+		uint32_t x = 0;
+		for (; x + 16 <= InWidth; x += 16) {
+			uint8x16x4_t rgba = vld4q_u8(InSrc + x * 4);
+			uint8x16_t r = rgba.val[0];
+			rgba.val[0] = rgba.val[2];
+			rgba.val[2] = r;
+			vst4q_u8(OutDst + x * 4, rgba);
+		}
+		SwizzleRBRow_Scalar(InSrc + x * 4, OutDst + x * 4, InWidth - x);
+	}
+
+	void Narrow16To8Row_NEON(const uint16_t* InSrc, uint8_t* OutDst, uint32_t InCount)
+	{
+		uint32_t i = 0;
+		for (; i + 16 <= InCount; i += 16) {
+			uint8x8_t lo = vshrn_n_u16(vld1q_u16(InSrc + i), 8);
+			uint8x8_t hi = vshrn_n_u16(vld1q_u16(InSrc + i + 8), 8);
+			vst1q_u8(OutDst + i, vcombine_u8(lo, hi));
+		}
+		Narrow16To8Row_Scalar(InSrc + i, OutDst + i, InCount - i);
+	}
+
+	void YuvToRGBARow_NEON(const uint8_t* InY, const uint8_t* InU, const uint8_t* InV, uint32_t InUVStep, uint8_t* OutDst, uint32_t InWidth, const FYuvCoefficients& InCoeffs)
+	{
+		const int32x4_t round = vdupq_n_s32(128);
+
+		uint32_t x = 0;
+		for (; x + 8 <= InWidth; x += 8) {
+			uint8x8_t u4, v4;
+			if (InUVStep == 2) {
+				uint8x8_t uv = vld1_u8(InU + x);
+				uint8x8x2_t split = vuzp_u8(uv, uv);
+				u4 = split.val[0];
+				v4 = split.val[1];
+			}
+			else {
+				uint32_t u32, v32;
+				memcpy(&u32, InU + x / 2, 4);
+				memcpy(&v32, InV + x / 2, 4);
+				u4 = vreinterpret_u8_u32(vdup_n_u32(u32));
+				v4 = vreinterpret_u8_u32(vdup_n_u32(v32));
+			}
+			int16x8_t y16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vld1_u8(InY + x))), vdupq_n_s16(16));
+			int16x8_t d16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vzip_u8(u4, u4).val[0])), vdupq_n_s16(128));
+			int16x8_t e16 = vsubq_s16(vreinterpretq_s16_u16(vmovl_u8(vzip_u8(v4, v4).val[0])), vdupq_n_s16(128));
+
+			int16x4_t r16[2], g16[2], b16[2];
+			for (int half = 0; half < 2; half++) {
+				int32x4_t y = vmovl_s16(half ? vget_high_s16(y16) : vget_low_s16(y16));
+				int32x4_t d = vmovl_s16(half ? vget_high_s16(d16) : vget_low_s16(d16));
+				int32x4_t e = vmovl_s16(half ? vget_high_s16(e16) : vget_low_s16(e16));
+				int32x4_t c = vmlaq_n_s32(round, y, InCoeffs.YMul);
+
+				r16[half] = vqmovn_s32(vshrq_n_s32(vmlaq_n_s32(c, e, InCoeffs.RV), 8));
+				g16[half] = vqmovn_s32(vshrq_n_s32(vmlaq_n_s32(vmlaq_n_s32(c, d, InCoeffs.GU), e, InCoeffs.GV), 8));
+				b16[half] = vqmovn_s32(vshrq_n_s32(vmlaq_n_s32(c, d, InCoeffs.BU), 8));
+			}
+
+			uint8x8x4_t rgba;
+			rgba.val[0] = vqmovun_s16(vcombine_s16(r16[0], r16[1]));
+			rgba.val[1] = vqmovun_s16(vcombine_s16(g16[0], g16[1]));
+			rgba.val[2] = vqmovun_s16(vcombine_s16(b16[0], b16[1]));
+			rgba.val[3] = vdup_n_u8(0xFF);
+			vst4_u8(OutDst + x * 4, rgba);
+		}
+		YuvToRGBARow_Scalar(InY + x, InU + (x / 2) * InUVStep, InV + (x / 2) * InUVStep, InUVStep, OutDst + x * 4, InWidth - x, InCoeffs);
+	}
+
+	inline uint32x4_t HashRound_NEON(uint32x4_t InAcc, uint32x4_t InWords)
+	{
+		InAcc = vmlaq_n_u32(InAcc, InWords, HashPrime2);
+		InAcc = vorrq_u32(vshlq_n_u32(InAcc, 13), vshrq_n_u32(InAcc, 19));
+		return vmulq_n_u32(InAcc, HashPrime1);
+	}
+
+	void HashRow_NEON(const uint8_t* InSrc, uint32_t InBytes, uint32_t* InOutLanes)
+	{
+		uint32x4_t lo = vld1q_u32(InOutLanes);
+		uint32x4_t hi = vld1q_u32(InOutLanes + 4);
+
+		uint32_t i = 0;
+		for (; i + HASH_CHUNK <= InBytes; i += HASH_CHUNK) {
+			lo = HashRound_NEON(lo, vreinterpretq_u32_u8(vld1q_u8(InSrc + i)));
+			hi = HashRound_NEON(hi, vreinterpretq_u32_u8(vld1q_u8(InSrc + i + 16)));
+		}
+		vst1q_u32(InOutLanes, lo);
+		vst1q_u32(InOutLanes + 4, hi);
+		HashTail(InSrc + i, InBytes - i, InOutLanes);
+	}
+
+	const FKernels KernelsNEON = { RGBToRGBARow_NEON, SwizzleRBRow_NEON, Narrow16To8Row_NEON, YuvToRGBARow_NEON, HashRow_NEON };
+
+#endif
+
+	ESimdLevel DetectSimdLevel()
+	{
+#if VULKAN_PIXEL_X86
+		int32_t info[4];
+		CpuId(info, 0, 0);
+		const int32_t maxLeaf = info[0];
+
+		CpuId(info, 1, 0);
+		const bool bSSE41 = (info[2] & (1 << 19)) != 0;
+		const bool bOSXSAVE = (info[2] & (1 << 27)) != 0;
+		const bool bAVX = (info[2] & (1 << 28)) != 0;
+
+		// The OS also has to save the YMM registers on context switches
+		if (maxLeaf >= 7 && bOSXSAVE && bAVX && (ReadXCR0() & 6) == 6) {
+			CpuId(info, 7, 0);
+			if (info[1] & (1 << 5)) return ESimdLevel::AVX2;
+		}
+		return bSSE41 ? ESimdLevel::SSE41 : ESimdLevel::Scalar;
+#elif VULKAN_PIXEL_NEON
+		return ESimdLevel::NEON;
+#else
+		return ESimdLevel::Scalar;
+#endif
+	}
+
+	std::atomic<int> s_SimdLevel(-1);
+
+	const FKernels& GetKernels()
+	{
+		switch (FVulkanPixelConvert::GetSimdLevel())
+		{
+#if VULKAN_PIXEL_X86
+		case ESimdLevel::SSE41:
+			return KernelsSSE41;
+		case ESimdLevel::AVX2:
+			return KernelsAVX2;
+#elif VULKAN_PIXEL_NEON
+		case ESimdLevel::NEON:
+			return KernelsNEON;
+#endif
+		default:
+			return KernelsScalar;
+		}
+	}
+
+	const FYuvCoefficients& GetYuvCoefficients(FVulkanPixelConvert::EYuvMatrix InMatrix)
+	{
+		return InMatrix == FVulkanPixelConvert::EYuvMatrix::BT709 ? YuvBT709 : YuvBT601;
+	}
+}
+
+
+FVulkanPixelConvert::ESimdLevel FVulkanPixelConvert::GetSimdLevel()
+{
+	int level = s_SimdLevel.load(std::memory_order_relaxed);
+	if (level < 0) {
+		level = static_cast<int>(GetSupportedSimdLevel());
+		s_SimdLevel.store(level, std::memory_order_relaxed);
+	}
+	return static_cast<ESimdLevel>(level);
+}
+
+FVulkanPixelConvert::ESimdLevel FVulkanPixelConvert::GetSupportedSimdLevel()
+{
+	static const ESimdLevel supported = DetectSimdLevel();
+	return supported;
+}
+
+void FVulkanPixelConvert::SetSimdLevel(ESimdLevel InLevel)
+{
+	const ESimdLevel supported = GetSupportedSimdLevel();
+	// NEON and the x86 levels don't mix, anything the CPU lacks falls back to scalar
+	const bool bAvailable = InLevel == supported || InLevel == ESimdLevel::Scalar ||
+		(supported == ESimdLevel::AVX2 && InLevel == ESimdLevel::SSE41);
+	s_SimdLevel.store(static_cast<int>(bAvailable ? InLevel : ESimdLevel::Scalar), std::memory_order_relaxed);
+}
+
+void FVulkanPixelConvert::RGBToRGBA(const void * InSrc, uint32_t InSrcPitch, void * OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight)
+{
+	const FKernels& kernels = GetKernels();
+	for (uint32_t y = 0; y < InHeight; y++) {
+		kernels.RGBToRGBA(static_cast<const uint8_t*>(InSrc) + (size_t)y * InSrcPitch, static_cast<uint8_t*>(OutDst) + (size_t)y * InDstPitch, InWidth, false);
+	}
+}
+
+void FVulkanPixelConvert::BGRToRGBA(const void * InSrc, uint32_t InSrcPitch, void * OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight)
+{
+	const FKernels& kernels = GetKernels();
+	for (uint32_t y = 0; y < InHeight; y++) {
+		kernels.RGBToRGBA(static_cast<const uint8_t*>(InSrc) + (size_t)y * InSrcPitch, static_cast<uint8_t*>(OutDst) + (size_t)y * InDstPitch, InWidth, true);
+	}
+}
+
+void FVulkanPixelConvert::SwizzleRB(const void * InSrc, uint32_t InSrcPitch, void * OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight)
+{
+	const FKernels& kernels = GetKernels();
+	for (uint32_t y = 0; y < InHeight; y++) {
+		kernels.SwizzleRB(static_cast<const uint8_t*>(InSrc) + (size_t)y * InSrcPitch, static_cast<uint8_t*>(OutDst) + (size_t)y * InDstPitch, InWidth);
+	}
+}
+
+void FVulkanPixelConvert::Narrow16To8(const void * InSrc, uint32_t InSrcPitch, void * OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight, uint32_t InChannels)
+{
+	const FKernels& kernels = GetKernels();
+	for (uint32_t y = 0; y < InHeight; y++) {
+		const uint16_t* src = reinterpret_cast<const uint16_t*>(static_cast<const uint8_t*>(InSrc) + (size_t)y * InSrcPitch);
+		kernels.Narrow16To8(src, static_cast<uint8_t*>(OutDst) + (size_t)y * InDstPitch, InWidth * InChannels);
+	}
+}
+
+void FVulkanPixelConvert::I420ToRGBA(const void * InY, uint32_t InYPitch, const void * InU, const void * InV, uint32_t InUVPitch,
+	void * OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight, EYuvMatrix InMatrix)
+{
+	const FKernels& kernels = GetKernels();
+	const FYuvCoefficients& coeffs = GetYuvCoefficients(InMatrix);
+	for (uint32_t y = 0; y < InHeight; y++) {
+		const size_t uvOffset = (size_t)(y / 2) * InUVPitch;
+		kernels.YuvToRGBA(static_cast<const uint8_t*>(InY) + (size_t)y * InYPitch,
+			static_cast<const uint8_t*>(InU) + uvOffset, static_cast<const uint8_t*>(InV) + uvOffset, 1,
+			static_cast<uint8_t*>(OutDst) + (size_t)y * InDstPitch, InWidth, coeffs);
+	}
+}
+
+void FVulkanPixelConvert::NV12ToRGBA(const void * InY, uint32_t InYPitch, const void * InUV, uint32_t InUVPitch,
+	void * OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight, EYuvMatrix InMatrix)
+{
+	const FKernels& kernels = GetKernels();
+	const FYuvCoefficients& coeffs = GetYuvCoefficients(InMatrix);
+	for (uint32_t y = 0; y < InHeight; y++) {
+		const uint8_t* uv = static_cast<const uint8_t*>(InUV) + (size_t)(y / 2) * InUVPitch;
+		kernels.YuvToRGBA(static_cast<const uint8_t*>(InY) + (size_t)y * InYPitch, uv, uv + 1, 2,
+			static_cast<uint8_t*>(OutDst) + (size_t)y * InDstPitch, InWidth, coeffs);
+	}
+}
+
+uint64_t FVulkanPixelConvert::HashRect(const void * InSrc, uint32_t InSrcPitch, uint32_t InRowBytes, uint32_t InHeight)
+{
+	const FKernels& kernels = GetKernels();
+	uint32_t lanes[HASH_LANES];
+	for (uint32_t lane = 0; lane < HASH_LANES; lane++) {
+		lanes[lane] = HashPrime1 * (lane + 1);
+	}
+	for (uint32_t y = 0; y < InHeight; y++) {
+		kernels.HashRow(static_cast<const uint8_t*>(InSrc) + (size_t)y * InSrcPitch, InRowBytes, lanes);
+	}
+
+	// Folds the lanes and the size into 64 bits, then the murmur3 finalizer
+	uint64_t hash = ((uint64_t)InRowBytes << 32) | InHeight;
+	for (uint32_t lane = 0; lane < HASH_LANES; lane++) {
+		hash = (hash ^ lanes[lane]) * 0x9E3779B97F4A7C15ull;
+		hash ^= hash >> 29;
+	}
+	hash ^= hash >> 33;
+	hash *= 0xFF51AFD7ED558CCDull;
+	hash ^= hash >> 33;
+	hash *= 0xC4CEB9FE1A85EC53ull;
+	hash ^= hash >> 33;
+	return hash;
+}
+
+void FVulkanPixelConvert::RunBenchmark(uint32_t InWidth, uint32_t InHeight, uint32_t InIterations)
+{
+	static const char* levelNames[] = { "Scalar", "SSE4.1", "AVX2", "NEON" };
+
+	const ESimdLevel previousLevel = GetSimdLevel();
+	const ESimdLevel supported = GetSupportedSimdLevel();
+
+	std::vector<ESimdLevel> levels;
+	levels.push_back(ESimdLevel::Scalar);
+	if (supported == ESimdLevel::AVX2) {
+		levels.push_back(ESimdLevel::SSE41);
+	}
+	if (supported != ESimdLevel::Scalar) {
+		levels.push_back(supported);
+	}
+
+	// Odd sized source rows so the tails get exercised too
+	const uint32_t width = InWidth | 1;
+	const uint32_t height = InHeight & ~1u;
+	const uint32_t chromaWidth = (width + 1) / 2;
+
+	std::vector<uint8_t> src((size_t)width * height * 8);
+	uint32_t seed = 0x12345678;
+	for (size_t i = 0; i < src.size(); i++) {
+		seed = seed * 1664525 + 1013904223;
+		src[i] = static_cast<uint8_t>(seed >> 24);
+	}
+
+	const uint32_t dstPitch = width * 4;
+	std::vector<uint8_t> reference((size_t)dstPitch * height);
+	std::vector<uint8_t> result((size_t)dstPitch * height);
+
+	struct FCase
+	{
+		const char* Name;
+		void(*Run)(const uint8_t* InSrc, uint8_t* OutDst, uint32_t InWidth, uint32_t InHeight, uint32_t InChromaWidth);
+	};
+
+	const FCase cases[] = {
+		{ "RGB24 -> RGBA", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t) { RGBToRGBA(s, w * 3, d, w * 4, w, h); } },
+		{ "BGR24 -> RGBA", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t) { BGRToRGBA(s, w * 3, d, w * 4, w, h); } },
+		{ "BGRA <-> RGBA", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t) { SwizzleRB(s, w * 4, d, w * 4, w, h); } },
+		{ "RGBA16 -> RGBA8", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t) { Narrow16To8(s, w * 8, d, w * 4, w, h, 4); } },
+		{ "I420 -> RGBA", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t cw) {
+			// Both chroma planes are half height, V follows right after U
+			const uint8_t* u = s + (size_t)w * h;
+			I420ToRGBA(s, w, u, u + (size_t)cw * (h / 2), cw, d, w * 4, w, h); } },
+		{ "NV12 -> RGBA", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t cw) {
+			NV12ToRGBA(s, w, s + (size_t)w * h, cw * 2, d, w * 4, w, h); } },
+		{ "RGBA 64x64 hash", [](const uint8_t* s, uint8_t* d, uint32_t w, uint32_t h, uint32_t) {
+			// One hash per tile at the start of the output, the odd width leaves a narrow last column
+			uint64_t* hashes = reinterpret_cast<uint64_t*>(d);
+			for (uint32_t ty = 0; ty < h; ty += 64) {
+				for (uint32_t tx = 0; tx < w; tx += 64) {
+					const uint32_t tw = w - tx < 64 ? w - tx : 64;
+					const uint32_t th = h - ty < 64 ? h - ty : 64;
+					*hashes++ = HashRect(s + (size_t)ty * w * 4 + tx * 4, w * 4, tw * 4, th);
+				}
+			} } },
+	};
+
+	printf("pixel conversion, %ux%u, %u iterations\n", width, height, InIterations);
+	for (const FCase& conversion : cases) {
+		double scalarMs = 0.0;
+		for (ESimdLevel level : levels) {
+			SetSimdLevel(level);
+			std::vector<uint8_t>& dst = level == ESimdLevel::Scalar ? reference : result;
+
+			const auto start = std::chrono::steady_clock::now();
+			for (uint32_t i = 0; i < InIterations; i++) {
+				conversion.Run(src.data(), dst.data(), width, height, chromaWidth);
+			}
+			const double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / InIterations;
+
+			if (level == ESimdLevel::Scalar) {
+				scalarMs = ms;
+				printf("  %-16s %-7s %8.3f ms\n", conversion.Name, levelNames[(int)level], ms);
+			}
+			else {
+				const bool bMatch = memcmp(reference.data(), result.data(), reference.size()) == 0;
+				printf("  %-16s %-7s %8.3f ms  %5.2fx  %s\n", conversion.Name, levelNames[(int)level], ms, scalarMs / ms, bMatch ? "match" : "MISMATCH");
+			}
+		}
+	}
+
+	SetSimdLevel(previousLevel);
+}
@@ -0,0 +1,54 @@
+#pragma once
+#include <cstdint>
+
+// CPU pixel conversion for formats the device can't sample, written to go straight into mapped
+// staging memory. Source and destination take their own row pitch in bytes.
+// Every kernel has a scalar reference and SSE4.1/AVX2 or NEON versions, the best one the CPU
+// runs is picked the first time a conversion is called.
+class FVulkanPixelConvert
+{
+public:
+	enum class ESimdLevel : uint8_t
+	{
+		Scalar,
+		SSE41,
+		AVX2,
+		NEON,
+	};
+
+	enum class EYuvMatrix : uint8_t
+	{
+		// Limited range BT.601 (SD video) and BT.709 (HD video)
+		BT601,
+		BT709,
+	};
+
+	static ESimdLevel GetSimdLevel();
+	static ESimdLevel GetSupportedSimdLevel();
+	// Forces a lower level, e.g. to compare against the scalar reference. Clamped to what the CPU supports.
+	static void SetSimdLevel(ESimdLevel InLevel);
+
+	// 24 bit RGB (or BGR) to 32 bit RGBA with opaque alpha
+	static void RGBToRGBA(const void* InSrc, uint32_t InSrcPitch, void* OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight);
+	static void BGRToRGBA(const void* InSrc, uint32_t InSrcPitch, void* OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight);
+
+	// Swaps R and B of 32 bit pixels, BGRA <-> RGBA. Source and destination may be the same memory.
+	static void SwizzleRB(const void* InSrc, uint32_t InSrcPitch, void* OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight);
+
+	// 16 bit to 8 bit per component, InChannels components per pixel
+	static void Narrow16To8(const void* InSrc, uint32_t InSrcPitch, void* OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight, uint32_t InChannels);
+
+	// 4:2:0 YUV to RGBA, chroma planes at half resolution. I420 has separate U and V planes, NV12 one interleaved UV plane.
+	static void I420ToRGBA(const void* InY, uint32_t InYPitch, const void* InU, const void* InV, uint32_t InUVPitch,
+		void* OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight, EYuvMatrix InMatrix = EYuvMatrix::BT601);
+	static void NV12ToRGBA(const void* InY, uint32_t InYPitch, const void* InUV, uint32_t InUVPitch,
+		void* OutDst, uint32_t InDstPitch, uint32_t InWidth, uint32_t InHeight, EYuvMatrix InMatrix = EYuvMatrix::BT601);
+
+	// 64 bit hash of InHeight rows of InRowBytes bytes, e.g. to find the tiles of a frame that changed.
+	// Every SIMD level returns the same value for the same bytes.
+	static uint64_t HashRect(const void* InSrc, uint32_t InSrcPitch, uint32_t InRowBytes, uint32_t InHeight);
+
+	// Times every conversion at each supported level against the scalar reference on an
+	// InWidth x InHeight frame, checks the outputs match and prints the results.
+	static void RunBenchmark(uint32_t InWidth = 1920, uint32_t InHeight = 1080, uint32_t InIterations = 50);
+};
@@ -0,0 +1,328 @@
+#include "VulkanPnm.h"
+#include "VulkanPixelConvert.h"
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment ( lib, "psapi.lib")
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace
+{
+	struct FPnmReader
+	{
+		const uint8_t* Cur;
+		const uint8_t* End;
+	};
+
+	bool IsSpace(uint8_t c)
+	{
+		return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\v' || c == '\f';
+	}
+
+	// Comments run from '#' to the end of the line, anywhere whitespace is allowed
+	void SkipSpaceAndComments(FPnmReader& InOutReader)
+	{
+		while (InOutReader.Cur < InOutReader.End)
+		{
+			if (*InOutReader.Cur == '#') {
+				while (InOutReader.Cur < InOutReader.End && *InOutReader.Cur != '\n') {
+					InOutReader.Cur++;
+				}
+			}
+			else if (IsSpace(*InOutReader.Cur)) {
+				InOutReader.Cur++;
+			}
+			else {
+				break;
+			}
+		}
+	}
+
+	uint32_t ReadNumber(FPnmReader& InOutReader)
+	{
+		SkipSpaceAndComments(InOutReader);
+
+		uint64_t value = 0;
+		const uint8_t* start = InOutReader.Cur;
+		while (InOutReader.Cur < InOutReader.End && *InOutReader.Cur >= '0' && *InOutReader.Cur <= '9')
+		{
+			value = value * 10 + (*InOutReader.Cur - '0');
+			if (value > UINT32_MAX) {
+				throw std::runtime_error("failed to load PNM, header value out of range!");
+			}
+			InOutReader.Cur++;
+		}
+		if (InOutReader.Cur == start) {
+			throw std::runtime_error("failed to load PNM, malformed header!");
+		}
+		return static_cast<uint32_t>(value);
+	}
+
+	std::string ReadToken(FPnmReader& InOutReader)
+	{
+		SkipSpaceAndComments(InOutReader);
+
+		const uint8_t* start = InOutReader.Cur;
+		while (InOutReader.Cur < InOutReader.End && !IsSpace(*InOutReader.Cur)) {
+			InOutReader.Cur++;
+		}
+		return std::string(reinterpret_cast<const char*>(start), InOutReader.Cur - start);
+	}
+
+	void SkipLine(FPnmReader& InOutReader)
+	{
+		while (InOutReader.Cur < InOutReader.End && *InOutReader.Cur++ != '\n');
+	}
+
+	// What FVulkanTexture2D::UpdateFromPnm() writes into staging memory for an RGBA texture
+	void ConvertToRGBA(const FVulkanPnmImage& InImage, uint8_t* OutDst)
+	{
+		if (InImage.Channels == 3) {
+			FVulkanPixelConvert::RGBToRGBA(InImage.Pixels, InImage.Pitch, OutDst, InImage.Width * 4, InImage.Width, InImage.Height);
+		}
+		else {
+			memcpy(OutDst, InImage.Pixels, (size_t)InImage.Pitch * InImage.Height);
+		}
+	}
+
+	// Highest resident set of the process so far, it never goes down again
+	size_t GetPeakResidentBytes()
+	{
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters = {};
+		GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+		return counters.PeakWorkingSetSize;
+#else
+		struct rusage usage;
+		getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+		return static_cast<size_t>(usage.ru_maxrss);
+#else
+		// Kilobytes on Linux
+		return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+}
+
+FVulkanMappedFile::FVulkanMappedFile(const char * InPath)
+	:m_Data(nullptr), m_Size(0)
+{
+#ifdef _WIN32
+	m_File = CreateFileA(InPath, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+	if (m_File == INVALID_HANDLE_VALUE) {
+		throw std::runtime_error("failed to open file!");
+	}
+
+	LARGE_INTEGER size;
+	if (!GetFileSizeEx(m_File, &size) || size.QuadPart == 0) {
+		CloseHandle(m_File);
+		throw std::runtime_error("failed to map file, it is empty!");
+	}
+
+	m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+	if (m_Mapping == nullptr) {
+		CloseHandle(m_File);
+		throw std::runtime_error("failed to map file!");
+	}
+
+	m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+	if (m_Data == nullptr) {
+		CloseHandle(m_Mapping);
+		CloseHandle(m_File);
+		throw std::runtime_error("failed to map file!");
+	}
+	m_Size = static_cast<size_t>(size.QuadPart);
+#else
+	const int file = open(InPath, O_RDONLY);
+	if (file < 0) {
+		throw std::runtime_error("failed to open file!");
+	}
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0) {
+		close(file);
+		throw std::runtime_error("failed to map file, it is empty!");
+	}
+
+	// The mapping keeps its own reference to the file
+	void* data = mmap(nullptr, static_cast<size_t>(info.st_size), PROT_READ, MAP_PRIVATE, file, 0);
+	close(file);
+	if (data == MAP_FAILED) {
+		throw std::runtime_error("failed to map file!");
+	}
+
+	// Read once front to back, pages can be read ahead and dropped right after
+	posix_madvise(data, static_cast<size_t>(info.st_size), POSIX_MADV_SEQUENTIAL);
+
+	m_Data = static_cast<const uint8_t*>(data);
+	m_Size = static_cast<size_t>(info.st_size);
+#endif
+}
+
+FVulkanMappedFile::~FVulkanMappedFile()
+{
+#ifdef _WIN32
+	UnmapViewOfFile(m_Data);
+	CloseHandle(m_Mapping);
+	CloseHandle(m_File);
+#else
+	munmap(const_cast<uint8_t*>(m_Data), m_Size);
+#endif
+}
+
+void FVulkanPnmLoader::LoadFromMemory(const void * InFileData, size_t InFileSize, FVulkanPnmImage & OutImage)
+{
+	FPnmReader reader;
+	reader.Cur = static_cast<const uint8_t*>(InFileData);
+	reader.End = reader.Cur + InFileSize;
+
+	if (InFileSize < 3 || reader.Cur[0] != 'P' || (reader.Cur[1] != '6' && reader.Cur[1] != '7') || !IsSpace(reader.Cur[2])) {
+		throw std::runtime_error("failed to load PNM, not a binary PPM or PAM file!");
+	}
+	const bool bPam = reader.Cur[1] == '7';
+	reader.Cur += 2;
+
+	uint32_t width = 0;
+	uint32_t height = 0;
+	uint32_t channels = 0;
+	uint32_t maxValue = 0;
+	if (bPam)
+	{
+		std::string tupleType;
+		for (;;)
+		{
+			const std::string key = ReadToken(reader);
+			if (key.empty()) {
+				throw std::runtime_error("failed to load PNM, header has no ENDHDR!");
+			}
+
+			if (key == "ENDHDR") {
+				SkipLine(reader);
+				break;
+			}
+			else if (key == "WIDTH") {
+				width = ReadNumber(reader);
+			}
+			else if (key == "HEIGHT") {
+				height = ReadNumber(reader);
+			}
+			else if (key == "DEPTH") {
+				channels = ReadNumber(reader);
+			}
+			else if (key == "MAXVAL") {
+				maxValue = ReadNumber(reader);
+			}
+			else if (key == "TUPLTYPE") {
+				tupleType = ReadToken(reader);
+			}
+			SkipLine(reader);
+		}
+
+		if (!tupleType.empty() && tupleType != "RGB" && tupleType != "RGB_ALPHA") {
+			throw std::runtime_error("failed to load PNM, only RGB and RGB_ALPHA PAM files are supported!");
+		}
+		if (channels != 3 && channels != 4) {
+			throw std::runtime_error("failed to load PNM, only RGB and RGB_ALPHA PAM files are supported!");
+		}
+		if ((tupleType == "RGB" && channels != 3) || (tupleType == "RGB_ALPHA" && channels != 4)) {
+			throw std::runtime_error("failed to load PNM, TUPLTYPE doesn't match DEPTH!");
+		}
+	}
+	else
+	{
+		width = ReadNumber(reader);
+		height = ReadNumber(reader);
+		maxValue = ReadNumber(reader);
+		channels = 3;
+
+		// Exactly one whitespace character separates the header from the pixels
+		if (reader.Cur == reader.End || !IsSpace(*reader.Cur)) {
+			throw std::runtime_error("failed to load PNM, malformed header!");
+		}
+		reader.Cur++;
+	}
+
+	if (width == 0 || height == 0) {
+		throw std::runtime_error("failed to load PNM, image is empty!");
+	}
+	// 16 bit files are big endian and anything below 255 would have to be rescaled
+	if (maxValue != 255) {
+		throw std::runtime_error("failed to load PNM, only 8 bit files with a maxval of 255 are supported!");
+	}
+
+	const uint64_t pitch = (uint64_t)width * channels;
+	if (pitch > UINT32_MAX || pitch * height > (uint64_t)(reader.End - reader.Cur)) {
+		throw std::runtime_error("failed to load PNM, file is truncated!");
+	}
+
+	OutImage.Width = width;
+	OutImage.Height = height;
+	OutImage.Channels = channels;
+	OutImage.Pitch = static_cast<uint32_t>(pitch);
+	OutImage.Pixels = reader.Cur;
+}
+
+void FVulkanPnmLoader::RunBenchmark(const char * InPath, uint32_t InIterations)
+{
+	size_t width = 0, height = 0;
+	{
+		FVulkanMappedFile file(InPath);
+		FVulkanPnmImage image;
+		LoadFromMemory(file.GetData(), file.GetSize(), image);
+		width = image.Width;
+		height = image.Height;
+	}
+
+	// Stands in for staging memory, both loaders end up with the RGBA pixels in it
+	std::vector<uint8_t> staging(width * height * 4, 0);
+
+	printf("PNM load %s, %zux%zu, %u iterations\n", InPath, width, height, InIterations);
+
+	// The mapped loader runs first, the peak resident set only grows
+	auto start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < InIterations; i++) {
+		FVulkanMappedFile file(InPath);
+		FVulkanPnmImage image;
+		LoadFromMemory(file.GetData(), file.GetSize(), image);
+		ConvertToRGBA(image, staging.data());
+	}
+	double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / InIterations;
+	printf("  %-8s %8.3f ms  peak RSS %8.1f MB\n", "mapped", ms, GetPeakResidentBytes() / (1024.0 * 1024.0));
+	const double mappedMs = ms;
+
+	// Whole file read into the heap, converted into a heap image, then copied to staging
+	start = std::chrono::steady_clock::now();
+	for (uint32_t i = 0; i < InIterations; i++) {
+		std::ifstream file(InPath, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) {
+			throw std::runtime_error("failed to open file!");
+		}
+		std::vector<uint8_t> data(static_cast<size_t>(file.tellg()));
+		file.seekg(0);
+		file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+		FVulkanPnmImage image;
+		LoadFromMemory(data.data(), data.size(), image);
+		std::vector<uint8_t> pixels(staging.size());
+		ConvertToRGBA(image, pixels.data());
+		memcpy(staging.data(), pixels.data(), pixels.size());
+	}
+	ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / InIterations;
+	printf("  %-8s %8.3f ms  peak RSS %8.1f MB  %5.2fx\n", "copying", ms, GetPeakResidentBytes() / (1024.0 * 1024.0), ms / mappedMs);
+}
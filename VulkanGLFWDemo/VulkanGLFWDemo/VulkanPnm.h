@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+// A file mapped read only into memory, its pages are only read from disk when they are touched
+// and can be dropped again by the OS at any time. Errors throw std::runtime_error.
+class FVulkanMappedFile
+{
+public:
+	FVulkanMappedFile(const char* InPath);
+	~FVulkanMappedFile();
+
+	FVulkanMappedFile(const FVulkanMappedFile&) = delete;
+	FVulkanMappedFile& operator=(const FVulkanMappedFile&) = delete;
+
+	inline const uint8_t* GetData() const
+	{
+		return m_Data;
+	}
+	inline size_t GetSize() const
+	{
+		return m_Size;
+	}
+
+private:
+	const uint8_t* m_Data;
+	size_t m_Size;
+#ifdef _WIN32
+	void* m_File;
+	void* m_Mapping;
+#endif
+};
+
+// 8 bit RGB or RGBA pixels of a PNM file, pointing into the file's memory
+struct FVulkanPnmImage
+{
+	uint32_t Width = 0;
+	uint32_t Height = 0;
+	// 3 for RGB, 4 for RGBA
+	uint32_t Channels = 0;
+	uint32_t Pitch = 0;
+	const uint8_t* Pixels = nullptr;
+};
+
+// Reads binary PPM (P6) and PAM (P7, TUPLTYPE RGB or RGB_ALPHA) images with a maxval of 255.
+// Nothing is copied, the pixels stay where they are in the file, so together with FVulkanMappedFile
+// and FVulkanTexture2D::UpdateFromPnm() they go from the page cache straight into staging memory.
+// Errors throw std::runtime_error.
+class FVulkanPnmLoader
+{
+public:
+	static void LoadFromMemory(const void* InFileData, size_t InFileSize, FVulkanPnmImage& OutImage);
+
+	// Loads InPath into an RGBA buffer standing in for staging memory, once through FVulkanMappedFile and once
+	// through a loader that reads the file into the heap and converts into a heap image first. Prints the time
+	// per load and the peak resident set after each, the file is expected to be in the page cache for both.
+	static void RunBenchmark(const char* InPath, uint32_t InIterations = 20);
+};
@@ -0,0 +1,126 @@
+#include "VulkanPresentPacer.h"
+#include <algorithm>
+
+// Presents per evaluation window and how many of them may miss before VSync falls back to FIFO_RELAXED
+static const uint32_t VULKAN_PRESENT_WINDOW_FRAMES = 120;
+static const uint32_t VULKAN_PRESENT_MAX_MISSED_FRAMES = 6;
+// No display refreshes faster than 360Hz, shorter estimates come from presents queued back to back
+static const int64_t VULKAN_PRESENT_MIN_PERIOD_US = 1000000 / 360;
+static const size_t VULKAN_PRESENT_PERIOD_PERCENTILE = 5;
+
+FVulkanPresentPacer::FVulkanPresentPacer(EVulkanPresentPolicy InPolicy)
+	:m_Policy(InPolicy), m_PresentMode(VK_PRESENT_MODE_FIFO_KHR), m_bRelaxedFallback(false), m_bRelaxedSupported(false),
+	m_bHasLastPresent(false), m_ReportedPeriodUs(0), m_EstimatedPeriodUs(0), m_WindowMissedFrames(0)
+{
+	m_WindowIntervalsUs.reserve(VULKAN_PRESENT_WINDOW_FRAMES);
+}
+
+void FVulkanPresentPacer::SetPolicy(EVulkanPresentPolicy InPolicy)
+{
+	m_Policy = InPolicy;
+	m_bRelaxedFallback = false;
+}
+
+VkPresentModeKHR FVulkanPresentPacer::ChoosePresentMode(const std::vector<VkPresentModeKHR>& InAvailablePresentModes)
+{
+	auto isAvailable = [&InAvailablePresentModes](VkPresentModeKHR InMode) {
+		return std::find(InAvailablePresentModes.begin(), InAvailablePresentModes.end(), InMode) != InAvailablePresentModes.end();
+	};
+	m_bRelaxedSupported = isAvailable(VK_PRESENT_MODE_FIFO_RELAXED_KHR);
+
+	// FIFO is the only mode every implementation has to support
+	switch (m_Policy)
+	{
+	case EVulkanPresentPolicy::LowLatency:
+		if (isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) return VK_PRESENT_MODE_MAILBOX_KHR;
+		if (isAvailable(VK_PRESENT_MODE_IMMEDIATE_KHR)) return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		break;
+	case EVulkanPresentPolicy::VSync:
+		if (m_bRelaxedFallback && m_bRelaxedSupported) return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		break;
+	case EVulkanPresentPolicy::Uncapped:
+		if (isAvailable(VK_PRESENT_MODE_IMMEDIATE_KHR)) return VK_PRESENT_MODE_IMMEDIATE_KHR;
+		if (isAvailable(VK_PRESENT_MODE_MAILBOX_KHR)) return VK_PRESENT_MODE_MAILBOX_KHR;
+		break;
+	case EVulkanPresentPolicy::RelaxedVSync:
+		if (m_bRelaxedSupported) return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+		break;
+	default:
+		break;
+	}
+
+	return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+uint32_t FVulkanPresentPacer::ChooseImageCount(const VkSurfaceCapabilitiesKHR & InCapabilities, VkPresentModeKHR InPresentMode) const
+{
+	uint32_t imageCount = InCapabilities.minImageCount + 1;
+
+	if (InPresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
+		// One image on screen, one queued, one to render into
+		imageCount = std::max(imageCount, 3u);
+	}
+	else if (m_Policy == EVulkanPresentPolicy::LowLatency) {
+		// Every extra image in a FIFO queue is another refresh of latency
+		imageCount = std::max(InCapabilities.minImageCount, 2u);
+	}
+
+	if (InCapabilities.maxImageCount > 0 && imageCount > InCapabilities.maxImageCount) {
+		imageCount = InCapabilities.maxImageCount;
+	}
+	return imageCount;
+}
+
+void FVulkanPresentPacer::OnSwapChainCreated(VkPresentModeKHR InPresentMode)
+{
+	// The new swap chain may be on another display, its period is reported or estimated again
+	m_PresentMode = InPresentMode;
+	m_bHasLastPresent = false;
+	m_ReportedPeriodUs = 0;
+	m_EstimatedPeriodUs = 0;
+	m_WindowIntervalsUs.clear();
+	m_WindowMissedFrames = 0;
+}
+
+void FVulkanPresentPacer::SetRefreshPeriod(uint64_t InPeriodNs)
+{
+	m_ReportedPeriodUs = static_cast<int64_t>(InPeriodNs / 1000);
+}
+
+bool FVulkanPresentPacer::TrackPresent()
+{
+	const auto now = std::chrono::steady_clock::now();
+	const bool bFirst = !m_bHasLastPresent;
+	const int64_t intervalUs = std::chrono::duration_cast<std::chrono::microseconds>(now - m_LastPresentTime).count();
+	m_LastPresentTime = now;
+	m_bHasLastPresent = true;
+
+	// Only FIFO waits for the vblank, the other modes have no refresh period to miss
+	if (bFirst || m_PresentMode != VK_PRESENT_MODE_FIFO_KHR) return false;
+
+	// Until the first window is through there is no estimate, so startup hitches aren't counted
+	const int64_t periodUs = m_ReportedPeriodUs > 0 ? m_ReportedPeriodUs : m_EstimatedPeriodUs;
+	if (periodUs > 0 && intervalUs * 2 > periodUs * 3) {
+		m_WindowMissedFrames++;
+	}
+
+	m_WindowIntervalsUs.push_back(intervalUs);
+	if (m_WindowIntervalsUs.size() < VULKAN_PRESENT_WINDOW_FRAMES) return false;
+
+	// Missed frames only ever make intervals longer, so the period is the shortest interval seen since the
+	// swap chain was created. A low percentile instead of the minimum skips presents queued back to back.
+	const size_t percentile = m_WindowIntervalsUs.size() * VULKAN_PRESENT_PERIOD_PERCENTILE / 100;
+	std::nth_element(m_WindowIntervalsUs.begin(), m_WindowIntervalsUs.begin() + percentile, m_WindowIntervalsUs.end());
+	const int64_t shortestUs = std::max(m_WindowIntervalsUs[percentile], VULKAN_PRESENT_MIN_PERIOD_US);
+	m_EstimatedPeriodUs = m_EstimatedPeriodUs > 0 ? std::min(m_EstimatedPeriodUs, shortestUs) : shortestUs;
+
+	const bool bMissing = m_WindowMissedFrames >= VULKAN_PRESENT_MAX_MISSED_FRAMES;
+	m_WindowIntervalsUs.clear();
+	m_WindowMissedFrames = 0;
+
+	if (bMissing && m_Policy == EVulkanPresentPolicy::VSync && m_bRelaxedSupported && !m_bRelaxedFallback) {
+		m_bRelaxedFallback = true;
+		return true;
+	}
+	return false;
+}
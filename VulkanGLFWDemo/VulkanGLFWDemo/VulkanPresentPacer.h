@@ -0,0 +1,66 @@
+#pragma once
+#include <chrono>
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Picks the present mode and how many images the swap chain queues
+enum class EVulkanPresentPolicy : uint8_t
+{
+	// Newest frame replaces queued ones (MAILBOX), shortest FIFO queue otherwise
+	LowLatency,
+	// FIFO, never tears. Falls back to FIFO_RELAXED when frames keep missing the vblank
+	VSync,
+	// IMMEDIATE, presents as fast as frames are rendered
+	Uncapped,
+	// FIFO_RELAXED, late frames tear instead of waiting a full refresh
+	RelaxedVSync,
+};
+
+// Applies a EVulkanPresentPolicy to a swap chain and watches its presents for missed vblanks.
+// Only needs Vulkan itself, so FVulkanSwapChain and the plain Vulkan VulkanGLFWApp share it.
+class FVulkanPresentPacer
+{
+public:
+	FVulkanPresentPacer(EVulkanPresentPolicy InPolicy);
+
+	inline EVulkanPresentPolicy GetPolicy() const
+	{
+		return m_Policy;
+	}
+	inline VkPresentModeKHR GetPresentMode() const
+	{
+		return m_PresentMode;
+	}
+
+	// Also drops a FIFO_RELAXED fallback. Takes effect the next time the swap chain is created.
+	void SetPolicy(EVulkanPresentPolicy InPolicy);
+
+	VkPresentModeKHR ChoosePresentMode(const std::vector<VkPresentModeKHR>& InAvailablePresentModes);
+	uint32_t ChooseImageCount(const VkSurfaceCapabilitiesKHR& InCapabilities, VkPresentModeKHR InPresentMode) const;
+
+	// Call whenever a swap chain has been (re)created, intervals measured before say nothing about it
+	void OnSwapChainCreated(VkPresentModeKHR InPresentMode);
+	// Refresh period the display reports, e.g. through VK_GOOGLE_display_timing or the monitor's video mode.
+	// Without one it is estimated from the shortest presents, which a steady rate below the refresh never shows.
+	void SetRefreshPeriod(uint64_t InPeriodNs);
+
+	// Call after every successful present. Returns true when the policy switched to another present mode
+	// because of missed frames, the swap chain has to be recreated to apply it.
+	bool TrackPresent();
+
+private:
+	EVulkanPresentPolicy m_Policy;
+	VkPresentModeKHR m_PresentMode;
+	bool m_bRelaxedFallback;
+	bool m_bRelaxedSupported;
+
+	// Present intervals of the current window. Intervals longer than 1.5 refresh periods count as missed,
+	// the period is the reported one or else the shortest intervals seen since the swap chain was created.
+	std::chrono::steady_clock::time_point m_LastPresentTime;
+	bool m_bHasLastPresent;
+	int64_t m_ReportedPeriodUs;
+	int64_t m_EstimatedPeriodUs;
+	std::vector<int64_t> m_WindowIntervalsUs;
+	uint32_t m_WindowMissedFrames;
+};
@@ -4,40 +4,179 @@
 #include "VulkanDevice.h"
 #include "VulkanCommandBuffer.h"
 #include "VulkanMemory.h"
+#include "VulkanDeletionQueue.h"
+#include <stdexcept>
 
 FVulkanQueue::FVulkanQueue(const FVulkanDevice * InDevice, uint32_t InFamilyIndex)
-	:m_Device(InDevice), m_FamilyIndex(InFamilyIndex)
+	:m_Device(InDevice), m_FamilyIndex(InFamilyIndex), m_QueueIndex(0), m_NumWaiters(0), m_LastSubmittedSerial(0), m_LastCompletedSerial(0)
 {
-	vkGetDeviceQueue(m_Device->GetLogicalDevice(), m_FamilyIndex, 0, &m_Handle);
+	vkGetDeviceQueue(m_Device->GetLogicalDevice(), m_FamilyIndex, m_QueueIndex, &m_Handle);
 }
 
 FVulkanQueue::~FVulkanQueue()
 {
 }
 
-void FVulkanQueue::Submit(FVulkanCommandBuffer * CmdBuffer) const
+uint64_t FVulkanQueue::Submit(FVulkanCommandBuffer * CmdBuffer)
 {
+	return Submit(&CmdBuffer, 1);
+}
 
-	const VkCommandBuffer cmdBuffers[] = { CmdBuffer->GetHandle() };
-
-	VkSubmitInfo submitInfo = {};
-	submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
-	submitInfo.commandBufferCount = 1;
-	submitInfo.pCommandBuffers = cmdBuffers;
-	submitInfo.signalSemaphoreCount = CmdBuffer->m_SignalSemaphores.size();
-	submitInfo.pSignalSemaphores = CmdBuffer->m_SignalSemaphores.data();
+uint64_t FVulkanQueue::Submit(FVulkanCommandBuffer * const * CmdBuffers, uint32_t NumCmdBuffers)
+{
+	if (NumCmdBuffers == 0) return GetLastSubmittedSerial();
+
+	std::unique_lock<std::mutex> submitLock(m_SubmitMutex);
+
+	// Sized up front, the submit infos point into m_SubmitHandles
+	m_SubmitInfos.resize(NumCmdBuffers);
+	m_SubmitHandles.resize(NumCmdBuffers);
+
+	for (uint32_t i = 0; i < NumCmdBuffers; i++)
+	{
+		FVulkanCommandBuffer* CmdBuffer = CmdBuffers[i];
+		m_SubmitHandles[i] = CmdBuffer->GetHandle();
+
+		VkSubmitInfo& submitInfo = m_SubmitInfos[i];
+		submitInfo = {};
+		submitInfo.sType = VK_STRUCTURE_TYPE_SUBMIT_INFO;
+		submitInfo.commandBufferCount = 1;
+		submitInfo.pCommandBuffers = &m_SubmitHandles[i];
+		submitInfo.signalSemaphoreCount = CmdBuffer->m_SignalSemaphores.size();
+		submitInfo.pSignalSemaphores = CmdBuffer->m_SignalSemaphores.data();
+
+		submitInfo.waitSemaphoreCount = CmdBuffer->m_WaitSemaphores.size();
+		submitInfo.pWaitSemaphores = CmdBuffer->m_WaitSemaphores.data();
+		submitInfo.pWaitDstStageMask = CmdBuffer->m_WaitFlags.data();
+	}
 
-	submitInfo.waitSemaphoreCount = CmdBuffer->m_WaitSemaphores.size();
-	submitInfo.pWaitSemaphores = CmdBuffer->m_WaitSemaphores.data();
-	submitInfo.pWaitDstStageMask = CmdBuffer->m_WaitFlags.data();
-	///
+	// The headers we build against predate VK_KHR_timeline_semaphore, so the serial is
+	// signaled through one fence per batch and advanced in submission order.
+	FVulkanFence* fence = m_Device->GetFenceManager()->GetNewFence(false);
 
-	if (vkQueueSubmit(m_Handle, 1, &submitInfo, CmdBuffer->m_Fence->GetHandle()) != VK_SUCCESS) {
+	if (vkQueueSubmit(m_Handle, NumCmdBuffers, m_SubmitInfos.data(), fence->GetHandle()) != VK_SUCCESS) {
 		throw std::runtime_error("failed to submit draw command buffer!");
 	}
 
-	CmdBuffer->m_State = FVulkanCommandBuffer::EState::Submitted;
-	CmdBuffer->GetOwner()->RefreshFenceStatus(CmdBuffer);
+	// Serials are handed out under the submit lock, so they follow the order on the VkQueue.
+	// Command buffers are marked before the batch becomes visible to RefreshFenceStatus on other threads.
+	const uint64_t serial = GetLastSubmittedSerial() + 1;
+	for (uint32_t i = 0; i < NumCmdBuffers; i++)
+	{
+		CmdBuffers[i]->MarkSubmitted(serial);
+	}
+	{
+		FSubmittedBatch batch;
+		batch.Serial = serial;
+		batch.Fence = fence;
+		batch.CmdBuffers.assign(CmdBuffers, CmdBuffers + NumCmdBuffers);
+
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		m_SubmittedBatches.push_back(std::move(batch));
+		m_LastSubmittedSerial.store(serial, std::memory_order_release);
+	}
+	submitLock.unlock();
+
+	RefreshFenceStatus();
+
+	return serial;
+}
+
+VkResult FVulkanQueue::Present(const VkPresentInfoKHR & InPresentInfo)
+{
+	std::lock_guard<std::mutex> submitLock(m_SubmitMutex);
+	return vkQueuePresentKHR(m_Handle, &InPresentInfo);
+}
+
+void FVulkanQueue::RefreshFenceStatus()
+{
+	// Only completed batches are touched, the first pending one ends the walk
+	std::unique_lock<std::mutex> batchLock(m_BatchMutex);
+	bool bRetired = false;
+	while (m_SubmittedBatches.size() > 0)
+	{
+		FSubmittedBatch& batch = m_SubmittedBatches.front();
+		if (!batch.Fence->IsSignaled()) break;
+
+		m_LastCompletedSerial.store(batch.Serial, std::memory_order_release);
+
+		for (size_t i = 0; i < batch.CmdBuffers.size(); i++)
+		{
+			batch.CmdBuffers[i]->OnSubmissionCompleted();
+		}
+		if (m_NumWaiters > 0) {
+			m_RetiredFences.push_back(batch.Fence);
+		}
+		else {
+			m_Device->GetFenceManager()->ReleaseFence(batch.Fence);
+		}
+
+		m_SubmittedBatches.pop_front();
+		bRetired = true;
+	}
+
+	batchLock.unlock();
+
+	if (bRetired && m_Device->GetDeletionQueue()) {
+		m_Device->GetDeletionQueue()->ReleaseCompleted();
+	}
+}
+
+void FVulkanQueue::WaitForSerial(uint64_t InSerial, uint64_t InTimeoutNs)
+{
+	if (IsSerialCompleted(InSerial) || InSerial > GetLastSubmittedSerial()) return;
+
+	// Wait for every batch up to InSerial so the completed serial can advance in order.
+	// The wait itself happens unlocked, submits and polls keep going meanwhile.
+	std::vector<VkFence> fences;
+	{
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		for (size_t i = 0; i < m_SubmittedBatches.size() && m_SubmittedBatches[i].Serial <= InSerial; i++)
+		{
+			fences.push_back(m_SubmittedBatches[i].Fence->GetHandle());
+		}
+		m_NumWaiters++;
+	}
+
+	if (fences.size() > 0) {
+		vkWaitForFences(m_Device->GetLogicalDevice(), static_cast<uint32_t>(fences.size()), fences.data(), VK_TRUE, InTimeoutNs);
+	}
+
+	{
+		std::lock_guard<std::mutex> batchLock(m_BatchMutex);
+		if (--m_NumWaiters == 0) {
+			for (FVulkanFence* fence : m_RetiredFences) {
+				m_Device->GetFenceManager()->ReleaseFence(fence);
+			}
+			m_RetiredFences.clear();
+		}
+	}
+
+	RefreshFenceStatus();
+}
+
+
+FVulkanSubmitBatch::FVulkanSubmitBatch(FVulkanQueue * InQueue)
+	:m_Queue(InQueue)
+{
+}
+
+FVulkanSubmitBatch::~FVulkanSubmitBatch()
+{
+	Flush();
+}
+
+void FVulkanSubmitBatch::Add(FVulkanCommandBuffer * CmdBuffer)
+{
+	m_CmdBuffers.push_back(CmdBuffer);
+}
+
+void FVulkanSubmitBatch::Flush()
+{
+	if (m_CmdBuffers.empty()) return;
+
+	m_Queue->Submit(m_CmdBuffers.data(), static_cast<uint32_t>(m_CmdBuffers.size()));
+	m_CmdBuffers.clear();
 }
 
 
@@ -56,19 +195,19 @@ void FVulkanQueueManager::Setup()
 	FVulkanUtil::QueueFamilyIndices indices = FVulkanUtil::FindQueueFamilies(m_Device->GetPhysicalDevice(), m_Device->GetInstance()->GetSurface());
 
 	if (indices.GraphicsIndex >= 0) {
-		m_GraphicsQueue.reset(new FVulkanQueue(m_Device, indices.GraphicsIndex));
+		m_GraphicsQueue = GetQueueForFamily(indices.GraphicsIndex);
 	}
 
 	if (indices.PresentIndex >= 0) {
-		m_PresentQueue.reset(new FVulkanQueue(m_Device, indices.PresentIndex));
+		m_PresentQueue = GetQueueForFamily(indices.PresentIndex);
 	}
 
 	if (indices.ComputeIndex >= 0) {
-		m_ComputeQueue.reset(new FVulkanQueue(m_Device, indices.ComputeIndex));
+		m_ComputeQueue = GetQueueForFamily(indices.ComputeIndex);
 	}
 
 	if (indices.TransferIndex >= 0) {
-		m_TransferQueue.reset(new FVulkanQueue(m_Device, indices.TransferIndex));
+		m_TransferQueue = GetQueueForFamily(indices.TransferIndex);
 	}
 
 
@@ -82,3 +221,16 @@ void FVulkanQueueManager::Release()
 	m_TransferQueue.reset();
 	
 }
+
+std::shared_ptr<FVulkanQueue> FVulkanQueueManager::GetQueueForFamily(uint32_t InFamilyIndex)
+{
+	// Every family is created with a single queue, so the family alone identifies the VkQueue
+	const std::shared_ptr<FVulkanQueue>* queues[] = { &m_GraphicsQueue, &m_PresentQueue, &m_ComputeQueue, &m_TransferQueue };
+	for (const std::shared_ptr<FVulkanQueue>* queue : queues)
+	{
+		if (*queue && (*queue)->GetFamilyIndex() == InFamilyIndex) {
+			return *queue;
+		}
+	}
+	return std::make_shared<FVulkanQueue>(m_Device, InFamilyIndex);
+}
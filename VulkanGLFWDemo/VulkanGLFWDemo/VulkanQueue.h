@@ -1,11 +1,17 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <memory>
+#include <mutex>
+#include <vector>
 #include <vulkan/vulkan.h>
 
 class FVulkanDevice;
 class FVulkanCommandBuffer;
 class FVulkanSemaphore;
+class FVulkanFence;
 
 class FVulkanQueue
 {
@@ -24,16 +30,94 @@ public:
 		return m_FamilyIndex;
 	}
 
-	void Submit(FVulkanCommandBuffer* CmdBuffer) const;
+	// Every submission gets the next value of a 64-bit serial. Work is complete once
+	// GetLastCompletedSerial() has reached the serial it was submitted with.
+	inline uint64_t GetLastSubmittedSerial() const
+	{
+		return m_LastSubmittedSerial.load(std::memory_order_acquire);
+	}
+
+	inline uint64_t GetLastCompletedSerial() const
+	{
+		return m_LastCompletedSerial.load(std::memory_order_acquire);
+	}
+
+	inline bool IsSerialCompleted(uint64_t InSerial) const
+	{
+		return InSerial <= GetLastCompletedSerial();
+	}
+
+	// Safe to call from any thread, but the caller blocks inside vkQueueSubmit.
+	// FVulkanSubmissionThread moves that call off the recording threads.
+	uint64_t Submit(FVulkanCommandBuffer* CmdBuffer);
 
+	// All command buffers go out in one vkQueueSubmit and share one serial
+	uint64_t Submit(FVulkanCommandBuffer* const* CmdBuffers, uint32_t NumCmdBuffers);
 
+	// vkQueuePresentKHR under the submit lock, the VkQueue is shared with the submitting threads
+	VkResult Present(const VkPresentInfoKHR& InPresentInfo);
+
+	// Advances the completed serial and retires the command buffers of the completed batches
+	void RefreshFenceStatus();
+	void WaitForSerial(uint64_t InSerial, uint64_t InTimeoutNs = UINT64_MAX);
 
 private:
+	struct FSubmittedBatch
+	{
+		uint64_t Serial;
+		FVulkanFence* Fence;
+		std::vector<FVulkanCommandBuffer*> CmdBuffers;
+	};
+
 	const FVulkanDevice* m_Device;
 	VkQueue m_Handle;
 	uint32_t m_FamilyIndex;
 	uint32_t m_QueueIndex;
 
+	// VkQueue needs external synchronization, m_SubmitMutex covers vkQueueSubmit and the scratch storage.
+	// m_BatchMutex only guards the bookkeeping, so polling never waits on a submit in the driver.
+	std::mutex m_SubmitMutex;
+	std::mutex m_BatchMutex;
+
+	// In submission order, consecutive serials
+	std::deque<FSubmittedBatch> m_SubmittedBatches;
+	// Fences of retired batches go back to the fence manager only once no WaitForSerial is waiting on them,
+	// otherwise they could be reset and reused for another submission in the middle of the wait
+	uint32_t m_NumWaiters;
+	std::vector<FVulkanFence*> m_RetiredFences;
+	std::atomic<uint64_t> m_LastSubmittedSerial;
+	std::atomic<uint64_t> m_LastCompletedSerial;
+
+	// Scratch storage reused by every submit
+	std::vector<VkSubmitInfo> m_SubmitInfos;
+	std::vector<VkCommandBuffer> m_SubmitHandles;
+};
+
+
+// Gathers command buffers over a frame (or any other span of work) and hands them
+// to the queue as a single submission when flushed.
+class FVulkanSubmitBatch
+{
+public:
+	FVulkanSubmitBatch(FVulkanQueue* InQueue);
+	~FVulkanSubmitBatch();
+
+	inline FVulkanQueue* GetQueue() const
+	{
+		return m_Queue;
+	}
+
+	inline bool IsEmpty() const
+	{
+		return m_CmdBuffers.empty();
+	}
+
+	void Add(FVulkanCommandBuffer* CmdBuffer);
+	void Flush();
+
+private:
+	FVulkanQueue* m_Queue;
+	std::vector<FVulkanCommandBuffer*> m_CmdBuffers;
 };
 
 
@@ -43,19 +127,19 @@ public:
 	FVulkanQueueManager(const FVulkanDevice* InDevice);
 	~FVulkanQueueManager();
 
-	inline const FVulkanQueue* GetGraphicsQueue() const 
+	inline FVulkanQueue* GetGraphicsQueue() const 
 	{
 		return m_GraphicsQueue.get();
 	}
-	inline const FVulkanQueue* GetPresentQueue() const
+	inline FVulkanQueue* GetPresentQueue() const
 	{
 		return m_PresentQueue.get();
 	}
-	inline const FVulkanQueue* GetComputeQueue() const
+	inline FVulkanQueue* GetComputeQueue() const
 	{
 		return m_ComputeQueue.get();
 	}
-	inline const FVulkanQueue* GetTransferQueue() const
+	inline FVulkanQueue* GetTransferQueue() const
 	{
 		return m_TransferQueue.get();
 	}
@@ -63,12 +147,16 @@ public:
 	void Setup();
 	void Release();
 
+private:
+	// Roles on the same family share one FVulkanQueue, so one submit lock and one serial cover the VkQueue
+	std::shared_ptr<FVulkanQueue> GetQueueForFamily(uint32_t InFamilyIndex);
+
 private:
 	const FVulkanDevice* m_Device;
 
-	std::unique_ptr<FVulkanQueue> m_GraphicsQueue;
-	std::unique_ptr<FVulkanQueue> m_PresentQueue;
-	std::unique_ptr<FVulkanQueue> m_ComputeQueue;
-	std::unique_ptr<FVulkanQueue> m_TransferQueue;
+	std::shared_ptr<FVulkanQueue> m_GraphicsQueue;
+	std::shared_ptr<FVulkanQueue> m_PresentQueue;
+	std::shared_ptr<FVulkanQueue> m_ComputeQueue;
+	std::shared_ptr<FVulkanQueue> m_TransferQueue;
 };
 
@@ -0,0 +1,150 @@
+#include "VulkanSamplerCache.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include "VulkanDevice.h"
+
+static_assert(sizeof(VkFilter) == 4 && sizeof(VkSamplerCreateFlags) == 4, "sampler keys are hashed as plain 4 byte words");
+
+FVulkanSamplerCache::FVulkanSamplerCache(const FVulkanDevice * InDevice)
+	:m_Device(InDevice)
+{
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+	m_MaxSamplers = properties.limits.maxSamplerAllocationCount;
+	m_MaxAnisotropy = std::min(properties.limits.maxSamplerAnisotropy, 16.0f);
+}
+
+FVulkanSamplerCache::~FVulkanSamplerCache()
+{
+	for (auto& entry : m_Entries) {
+		vkDestroySampler(m_Device->GetLogicalDevice(), entry.second.Sampler, nullptr);
+	}
+}
+
+VkSampler FVulkanSamplerCache::Acquire(const VkSamplerCreateInfo & InInfo)
+{
+	if (InInfo.pNext != nullptr) {
+		throw std::invalid_argument("sampler create infos with a pNext chain can't be cached!");
+	}
+
+	FKey key;
+	key.Flags = InInfo.flags;
+	key.MagFilter = InInfo.magFilter;
+	key.MinFilter = InInfo.minFilter;
+	key.MipmapMode = InInfo.mipmapMode;
+	key.AddressModeU = InInfo.addressModeU;
+	key.AddressModeV = InInfo.addressModeV;
+	key.AddressModeW = InInfo.addressModeW;
+	key.MipLodBias = InInfo.mipLodBias;
+	key.AnisotropyEnable = InInfo.anisotropyEnable;
+	// Ignored without anisotropy, so it doesn't tell samplers apart
+	key.MaxAnisotropy = InInfo.anisotropyEnable ? InInfo.maxAnisotropy : 1.0f;
+	key.CompareEnable = InInfo.compareEnable;
+	key.CompareOp = InInfo.compareOp;
+	key.MinLod = InInfo.minLod;
+	key.MaxLod = InInfo.maxLod;
+	key.BorderColor = InInfo.borderColor;
+	key.UnnormalizedCoordinates = InInfo.unnormalizedCoordinates;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto found = m_Entries.find(key);
+	if (found != m_Entries.end()) {
+		found->second.RefCount++;
+		return found->second.Sampler;
+	}
+
+	if (m_Entries.size() >= m_MaxSamplers) {
+		throw std::runtime_error("failed to create texture sampler, maxSamplerAllocationCount reached!");
+	}
+
+	VkSampler sampler;
+	if (vkCreateSampler(m_Device->GetLogicalDevice(), &InInfo, nullptr, &sampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create texture sampler!");
+	}
+
+	FEntry& entry = m_Entries[key];
+	entry.Sampler = sampler;
+	entry.RefCount = 1;
+	m_EntriesBySampler[sampler] = &entry;
+	return sampler;
+}
+
+VkSampler FVulkanSamplerCache::Acquire(EVulkanSamplerQuality InQuality, float InMaxLod, VkSamplerAddressMode InAddressMode)
+{
+	VkSamplerCreateInfo samplerInfo;
+	GetCreateInfo(InQuality, InMaxLod, InAddressMode, m_MaxAnisotropy, samplerInfo);
+	return Acquire(samplerInfo);
+}
+
+void FVulkanSamplerCache::Release(VkSampler InSampler)
+{
+	if (InSampler == VK_NULL_HANDLE) return;
+
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	auto found = m_EntriesBySampler.find(InSampler);
+	if (found != m_EntriesBySampler.end() && found->second->RefCount > 0) {
+		found->second->RefCount--;
+	}
+}
+
+void FVulkanSamplerCache::Trim()
+{
+	std::lock_guard<std::mutex> lock(m_Mutex);
+
+	for (auto it = m_Entries.begin(); it != m_Entries.end();)
+	{
+		if (it->second.RefCount == 0) {
+			vkDestroySampler(m_Device->GetLogicalDevice(), it->second.Sampler, nullptr);
+			m_EntriesBySampler.erase(it->second.Sampler);
+			it = m_Entries.erase(it);
+		}
+		else {
+			++it;
+		}
+	}
+}
+
+void FVulkanSamplerCache::GetCreateInfo(EVulkanSamplerQuality InQuality, float InMaxLod, VkSamplerAddressMode InAddressMode, float InMaxAnisotropy, VkSamplerCreateInfo & OutInfo)
+{
+	const bool bNearest = InQuality == EVulkanSamplerQuality::Nearest;
+	const bool bAnisotropic = InQuality == EVulkanSamplerQuality::Anisotropic && InMaxAnisotropy > 1.0f;
+
+	OutInfo = {};
+	OutInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	OutInfo.magFilter = bNearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+	OutInfo.minFilter = bNearest ? VK_FILTER_NEAREST : VK_FILTER_LINEAR;
+	OutInfo.mipmapMode = bNearest ? VK_SAMPLER_MIPMAP_MODE_NEAREST : VK_SAMPLER_MIPMAP_MODE_LINEAR;
+	OutInfo.addressModeU = InAddressMode;
+	OutInfo.addressModeV = InAddressMode;
+	OutInfo.addressModeW = InAddressMode;
+	OutInfo.anisotropyEnable = bAnisotropic ? VK_TRUE : VK_FALSE;
+	OutInfo.maxAnisotropy = bAnisotropic ? InMaxAnisotropy : 1.0f;
+	OutInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	OutInfo.unnormalizedCoordinates = VK_FALSE;
+	OutInfo.compareEnable = VK_FALSE;
+	OutInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+	OutInfo.mipLodBias = 0.0f;
+	OutInfo.minLod = 0.0f;
+	OutInfo.maxLod = InMaxLod;
+}
+
+bool FVulkanSamplerCache::FKey::operator==(const FKey & InOther) const
+{
+	return memcmp(this, &InOther, sizeof(FKey)) == 0;
+}
+
+size_t FVulkanSamplerCache::FKeyHash::operator()(const FKey & InKey) const
+{
+	// FNV-1a over the 4 byte words of the key
+	uint32_t words[sizeof(FKey) / 4];
+	memcpy(words, &InKey, sizeof(FKey));
+
+	uint64_t hash = 0xCBF29CE484222325ull;
+	for (uint32_t word : words) {
+		hash = (hash ^ word) * 0x100000001B3ull;
+	}
+	return static_cast<size_t>(hash);
+}
@@ -0,0 +1,89 @@
+#pragma once
+#include <cstdint>
+#include <mutex>
+#include <unordered_map>
+#include <vulkan/vulkan.h>
+
+class FVulkanDevice;
+
+// Filtering a texture pays for, from cheapest to most expensive
+enum class EVulkanSamplerQuality : uint8_t
+{
+	// Point sampling, for images drawn 1:1 like video blits
+	Nearest,
+	// Bilinear, trilinear across mips
+	Linear,
+	// Trilinear with the device's maximum anisotropy (at most 16x)
+	Anisotropic,
+};
+
+// Shares one VkSampler between everything created with the same VkSamplerCreateInfo, so thousands of
+// textures don't run into maxSamplerAllocationCount or pay for a vkCreateSampler each.
+// Samplers are reference counted. Unreferenced ones stay cached for the next texture until Trim().
+// Create infos with a pNext chain (e.g. a Ycbcr conversion) can't be cached, create those directly.
+class FVulkanSamplerCache
+{
+public:
+	FVulkanSamplerCache(const FVulkanDevice* InDevice);
+	~FVulkanSamplerCache();
+
+	// Every Acquire needs a Release of the returned sampler
+	VkSampler Acquire(const VkSamplerCreateInfo& InInfo);
+	VkSampler Acquire(EVulkanSamplerQuality InQuality, float InMaxLod = 0.0f, VkSamplerAddressMode InAddressMode = VK_SAMPLER_ADDRESS_MODE_REPEAT);
+	void Release(VkSampler InSampler);
+
+	// Destroys the unreferenced samplers, the GPU must no longer be using them
+	void Trim();
+
+	inline uint32_t GetNumSamplers() const
+	{
+		return static_cast<uint32_t>(m_Entries.size());
+	}
+
+	static void GetCreateInfo(EVulkanSamplerQuality InQuality, float InMaxLod, VkSamplerAddressMode InAddressMode, float InMaxAnisotropy, VkSamplerCreateInfo& OutInfo);
+
+private:
+	// The create info without sType and pNext, all 4 byte members so there is no padding to hash or compare
+	struct FKey
+	{
+		VkSamplerCreateFlags Flags;
+		VkFilter MagFilter;
+		VkFilter MinFilter;
+		VkSamplerMipmapMode MipmapMode;
+		VkSamplerAddressMode AddressModeU;
+		VkSamplerAddressMode AddressModeV;
+		VkSamplerAddressMode AddressModeW;
+		float MipLodBias;
+		VkBool32 AnisotropyEnable;
+		float MaxAnisotropy;
+		VkBool32 CompareEnable;
+		VkCompareOp CompareOp;
+		float MinLod;
+		float MaxLod;
+		VkBorderColor BorderColor;
+		VkBool32 UnnormalizedCoordinates;
+
+		bool operator==(const FKey& InOther) const;
+	};
+
+	struct FKeyHash
+	{
+		size_t operator()(const FKey& InKey) const;
+	};
+
+	struct FEntry
+	{
+		VkSampler Sampler;
+		uint32_t RefCount;
+	};
+
+private:
+	const FVulkanDevice* m_Device;
+	uint32_t m_MaxSamplers;
+	float m_MaxAnisotropy;
+
+	std::mutex m_Mutex;
+	std::unordered_map<FKey, FEntry, FKeyHash> m_Entries;
+	// Elements of an unordered_map keep their address, so Release() finds its entry directly
+	std::unordered_map<VkSampler, FEntry*> m_EntriesBySampler;
+};
@@ -58,12 +58,16 @@ void FVulkanShader::GetShaderStages(std::vector<VkPipelineShaderStageCreateInfo>
 			{
 			case SHADER_TYPE_VERTEX:
 				shaderStageInfo.stage = VK_SHADER_STAGE_VERTEX_BIT;
+				break;
 			case SHADER_TYPE_FRAGMENT:
 				shaderStageInfo.stage = VK_SHADER_STAGE_FRAGMENT_BIT;
+				break;
 			case SHADER_TYPE_COMPUTE:
 				shaderStageInfo.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+				break;
 			case SHADER_TYPE_GEOMETRY:
 				shaderStageInfo.stage = VK_SHADER_STAGE_GEOMETRY_BIT;
+				break;
 			default:
 				break;
 			}
@@ -0,0 +1,149 @@
+#include "VulkanSubmissionThread.h"
+#include "VulkanQueue.h"
+#include "VulkanCommandBuffer.h"
+#include <algorithm>
+
+// Upper bound for one vkQueueSubmit, keeps a burst of producers from delaying the first of them
+static const uint32_t VULKAN_SUBMISSION_MAX_GATHER = 64;
+
+FVulkanSubmissionThread::FVulkanSubmissionThread(FVulkanQueue * InQueue, uint32_t InCapacity)
+	:m_Queue(InQueue), m_EnqueuePos(0), m_DequeuePos(0), m_SubmittedTicket(0),
+	m_bSleeping(false), m_NumWaiters(0), m_bQuit(false)
+{
+	uint64_t capacity = 2;
+	while (capacity < InCapacity) capacity <<= 1;
+
+	m_Slots.reset(new FSlot[capacity]);
+	m_Mask = capacity - 1;
+	for (uint64_t i = 0; i < capacity; i++)
+	{
+		m_Slots[i].Sequence.store(i, std::memory_order_relaxed);
+		m_Slots[i].NumCmdBuffers = 0;
+	}
+
+	m_Gathered.reserve(VULKAN_SUBMISSION_MAX_GATHER + MAX_CMD_BUFFERS_PER_SLOT);
+	m_Thread = std::thread(&FVulkanSubmissionThread::ThreadLoop, this);
+}
+
+FVulkanSubmissionThread::~FVulkanSubmissionThread()
+{
+	{
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_bQuit = true;
+	}
+	m_WorkReady.notify_one();
+	m_Thread.join();
+}
+
+uint64_t FVulkanSubmissionThread::Enqueue(FVulkanCommandBuffer * InCmdBuffer)
+{
+	return Push(&InCmdBuffer, 1);
+}
+
+uint64_t FVulkanSubmissionThread::Enqueue(FVulkanCommandBuffer * const * InCmdBuffers, uint32_t InNumCmdBuffers)
+{
+	uint64_t ticket = m_SubmittedTicket.load(std::memory_order_acquire);
+	for (uint32_t i = 0; i < InNumCmdBuffers; i += MAX_CMD_BUFFERS_PER_SLOT)
+	{
+		ticket = Push(InCmdBuffers + i, std::min<uint32_t>(InNumCmdBuffers - i, MAX_CMD_BUFFERS_PER_SLOT));
+	}
+	return ticket;
+}
+
+void FVulkanSubmissionThread::WaitForSubmission(uint64_t InTicket)
+{
+	if (m_SubmittedTicket.load(std::memory_order_acquire) >= InTicket) return;
+
+	std::unique_lock<std::mutex> lock(m_Mutex);
+	m_NumWaiters.fetch_add(1);
+	m_WorkSubmitted.wait(lock, [this, InTicket] { return m_SubmittedTicket.load(std::memory_order_acquire) >= InTicket; });
+	m_NumWaiters.fetch_sub(1);
+}
+
+void FVulkanSubmissionThread::Flush()
+{
+	WaitForSubmission(m_EnqueuePos.load(std::memory_order_acquire));
+}
+
+uint64_t FVulkanSubmissionThread::Push(FVulkanCommandBuffer * const * InCmdBuffers, uint32_t InNumCmdBuffers)
+{
+	FSlot* slot;
+	uint64_t pos = m_EnqueuePos.load(std::memory_order_relaxed);
+	for (;;)
+	{
+		slot = &m_Slots[pos & m_Mask];
+		const uint64_t sequence = slot->Sequence.load(std::memory_order_acquire);
+		const int64_t diff = (int64_t)sequence - (int64_t)pos;
+
+		if (diff == 0) {
+			if (m_EnqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+		}
+		else if (diff < 0) {
+			// Full, the submission thread frees slots as soon as it has read them
+			std::this_thread::yield();
+			pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		}
+		else {
+			pos = m_EnqueuePos.load(std::memory_order_relaxed);
+		}
+	}
+
+	slot->NumCmdBuffers = InNumCmdBuffers;
+	std::copy(InCmdBuffers, InCmdBuffers + InNumCmdBuffers, slot->CmdBuffers);
+	slot->Sequence.store(pos + 1, std::memory_order_release);
+
+	// Pairs with the fence in ThreadLoop, either this sees the thread going to sleep or the thread sees the slot
+	std::atomic_thread_fence(std::memory_order_seq_cst);
+	if (m_bSleeping.load()) {
+		std::lock_guard<std::mutex> lock(m_Mutex);
+		m_WorkReady.notify_one();
+	}
+
+	return pos + 1;
+}
+
+bool FVulkanSubmissionThread::IsEmpty() const
+{
+	const FSlot& slot = m_Slots[m_DequeuePos & m_Mask];
+	return slot.Sequence.load(std::memory_order_acquire) != m_DequeuePos + 1;
+}
+
+void FVulkanSubmissionThread::ThreadLoop()
+{
+	for (;;)
+	{
+		// Take everything that has been published so far, in ring order
+		m_Gathered.clear();
+		while (m_Gathered.size() < VULKAN_SUBMISSION_MAX_GATHER && !IsEmpty())
+		{
+			FSlot& slot = m_Slots[m_DequeuePos & m_Mask];
+			m_Gathered.insert(m_Gathered.end(), slot.CmdBuffers, slot.CmdBuffers + slot.NumCmdBuffers);
+			slot.Sequence.store(m_DequeuePos + m_Mask + 1, std::memory_order_release);
+			m_DequeuePos++;
+		}
+
+		if (!m_Gathered.empty()) {
+			m_Queue->Submit(m_Gathered.data(), static_cast<uint32_t>(m_Gathered.size()));
+
+			m_SubmittedTicket.store(m_DequeuePos);
+			if (m_NumWaiters.load() > 0) {
+				std::lock_guard<std::mutex> lock(m_Mutex);
+				m_WorkSubmitted.notify_all();
+			}
+			continue;
+		}
+
+		m_bSleeping.store(true);
+		std::atomic_thread_fence(std::memory_order_seq_cst);
+		if (!IsEmpty()) {
+			m_bSleeping.store(false);
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(m_Mutex);
+		m_WorkReady.wait(lock, [this] { return m_bQuit || !IsEmpty(); });
+		m_bSleeping.store(false);
+
+		if (m_bQuit && IsEmpty()) break;
+	}
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+class FVulkanQueue;
+class FVulkanCommandBuffer;
+
+// Owns all vkQueueSubmit calls of one queue. Recording threads hand over ended command buffers
+// through a bounded lock-free multi producer / single consumer ring, the thread drains whatever
+// has arrived and submits it as one batch.
+class FVulkanSubmissionThread
+{
+public:
+	// InCapacity is rounded up to a power of two
+	FVulkanSubmissionThread(FVulkanQueue* InQueue, uint32_t InCapacity = 256);
+	// Submits what is still queued, then stops the thread
+	~FVulkanSubmissionThread();
+
+	inline FVulkanQueue* GetQueue() const
+	{
+		return m_Queue;
+	}
+
+	// Lock free from any thread, only spins while the ring is full.
+	// Returns a ticket for WaitForSubmission, command buffers of one call keep their order.
+	uint64_t Enqueue(FVulkanCommandBuffer* InCmdBuffer);
+	uint64_t Enqueue(FVulkanCommandBuffer* const* InCmdBuffers, uint32_t InNumCmdBuffers);
+
+	// Blocks until the ticket went through vkQueueSubmit, the command buffers then have their serial
+	void WaitForSubmission(uint64_t InTicket);
+	void Flush();
+
+private:
+	enum : uint32_t
+	{
+		MAX_CMD_BUFFERS_PER_SLOT = 8,
+	};
+
+	struct FSlot
+	{
+		// Vyukov bounded queue: equals the position when free, position + 1 once written
+		std::atomic<uint64_t> Sequence;
+		uint32_t NumCmdBuffers;
+		FVulkanCommandBuffer* CmdBuffers[MAX_CMD_BUFFERS_PER_SLOT];
+	};
+
+	uint64_t Push(FVulkanCommandBuffer* const* InCmdBuffers, uint32_t InNumCmdBuffers);
+	bool IsEmpty() const;
+	void ThreadLoop();
+
+private:
+	FVulkanQueue* m_Queue;
+
+	std::unique_ptr<FSlot[]> m_Slots;
+	uint64_t m_Mask;
+
+	std::atomic<uint64_t> m_EnqueuePos;
+	// Only touched by the submission thread
+	uint64_t m_DequeuePos;
+	std::atomic<uint64_t> m_SubmittedTicket;
+
+	// Only used to sleep and wake up, never on the enqueue fast path
+	std::mutex m_Mutex;
+	std::condition_variable m_WorkReady;
+	std::condition_variable m_WorkSubmitted;
+	std::atomic<bool> m_bSleeping;
+	std::atomic<uint32_t> m_NumWaiters;
+	bool m_bQuit;
+
+	std::vector<FVulkanCommandBuffer*> m_Gathered;
+	std::thread m_Thread;
+};
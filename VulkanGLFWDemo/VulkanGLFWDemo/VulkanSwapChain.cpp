@@ -4,12 +4,20 @@
 #include "VulkanWindow.h"
 #include "VulkanInstance.h"
 #include "VulkanDevice.h"
+#include "VulkanQueue.h"
+#include "VulkanMemory.h"
+#include "VulkanDeletionQueue.h"
 #include "VulkanRenderPass.h"
 
-FVulkanSwapChain::FVulkanSwapChain(const FVulkanDevice* InDevice)
-	:m_Device(InDevice)
-{
+// Offscreen ring of a headless swap chain: one image on the GPU, one being read back, one to render into
+static const uint32_t VULKAN_HEADLESS_IMAGE_COUNT = 3;
 
+FVulkanSwapChain::FVulkanSwapChain(const FVulkanDevice* InDevice, FVulkanQueue* InPresentQueue, EVulkanPresentPolicy InPolicy)
+	:m_Device(InDevice), m_PresentQueue(InPresentQueue), m_Handle(VK_NULL_HANDLE), m_RenderPass(nullptr), m_Pacer(InPolicy), m_bRecreatePending(false)
+{
+	if (m_Device->GetInstance()->GetSurface() == VK_NULL_HANDLE) {
+		m_Offscreen.reset(new FVulkanOffscreenPresenter(m_Device, m_PresentQueue));
+	}
 }
 
 FVulkanSwapChain::~FVulkanSwapChain()
@@ -18,11 +26,100 @@ FVulkanSwapChain::~FVulkanSwapChain()
 
 void FVulkanSwapChain::Setup()
 {
-	CreateSwapChain();
+	if (m_Offscreen) {
+		CreateOffscreenImages();
+	}
+	else {
+		CreateSwapChain(VK_NULL_HANDLE);
+	}
 	CreateSwapChainImageViews();
 }
 
 void FVulkanSwapChain::Release()
+{
+	DestoryFramebuffersAndViews();
+	if (m_Offscreen) {
+		m_Offscreen->Release();
+	}
+	else {
+		vkDestroySwapchainKHR(m_Device->GetLogicalDevice(), m_Handle, nullptr);
+	}
+}
+
+void FVulkanSwapChain::SetPresentPolicy(EVulkanPresentPolicy InPolicy)
+{
+	if (InPolicy == m_Pacer.GetPolicy()) return;
+	m_Pacer.SetPolicy(InPolicy);
+	m_bRecreatePending = true;
+}
+
+void FVulkanSwapChain::SetReadbackCallback(FVulkanOffscreenPresenter::ReadbackCallbackFunction InCallback)
+{
+	if (m_Offscreen) {
+		m_Offscreen->SetReadbackCallback(InCallback);
+	}
+}
+
+VkResult FVulkanSwapChain::AcquireNextImage(const FVulkanSemaphore * InImageAvailable, uint32_t & OutImageIndex, uint64_t InTimeoutNs)
+{
+	if (m_Offscreen) {
+		return m_Offscreen->AcquireNextImage(InImageAvailable, OutImageIndex, InTimeoutNs);
+	}
+	return vkAcquireNextImageKHR(m_Device->GetLogicalDevice(), m_Handle, InTimeoutNs, InImageAvailable->GetHandle(), VK_NULL_HANDLE, &OutImageIndex);
+}
+
+VkResult FVulkanSwapChain::Present(uint32_t InImageIndex, const FVulkanSemaphore * InRenderFinished)
+{
+	if (m_Offscreen) {
+		return m_Offscreen->Present(InImageIndex, InRenderFinished);
+	}
+
+	VkSemaphore waitSemaphore = InRenderFinished->GetHandle();
+
+	VkPresentInfoKHR presentInfo = {};
+	presentInfo.sType = VK_STRUCTURE_TYPE_PRESENT_INFO_KHR;
+	presentInfo.waitSemaphoreCount = 1;
+	presentInfo.pWaitSemaphores = &waitSemaphore;
+	presentInfo.swapchainCount = 1;
+	presentInfo.pSwapchains = &m_Handle;
+	presentInfo.pImageIndices = &InImageIndex;
+
+	VkResult result = m_PresentQueue->Present(presentInfo);
+	if (result == VK_SUCCESS && m_Pacer.TrackPresent()) {
+		m_bRecreatePending = true;
+	}
+	if (result == VK_SUCCESS && m_bRecreatePending) {
+		result = VK_SUBOPTIMAL_KHR;
+	}
+	return result;
+}
+
+void FVulkanSwapChain::Recreate(FVulkanQueue* InRenderQueue)
+{
+	// Frames in flight still render into the old images and framebuffers, they go once those are done
+	const uint64_t lastSerial = InRenderQueue->GetLastSubmittedSerial();
+	RetireFramebuffersAndViews(InRenderQueue, lastSerial);
+
+	if (m_Offscreen) {
+		// Only waits for the presents of the old images
+		m_Offscreen->Release();
+		CreateOffscreenImages();
+	}
+	else {
+		// Handing over the old swap chain lets the driver reuse its resources, it is retired either way
+		VkSwapchainKHR oldSwapChain = m_Handle;
+		CreateSwapChain(oldSwapChain);
+		m_Device->GetDeletionQueue()->Enqueue(InRenderQueue, lastSerial, FVulkanDeletionQueue::EType::SwapChain, (uint64_t)oldSwapChain);
+	}
+	CreateSwapChainImageViews();
+
+	if (m_RenderPass) {
+		CreateFramebuffers(m_RenderPass);
+	}
+	m_bRecreatePending = false;
+}
+
+void FVulkanSwapChain::DestoryFramebuffersAndViews()
 {
 	for (size_t i = 0; i < m_Framebuffers.size(); i++) {
 		vkDestroyFramebuffer(m_Device->GetLogicalDevice(), m_Framebuffers[i], nullptr);
@@ -30,11 +127,26 @@ void FVulkanSwapChain::Release()
 	for (size_t i = 0; i < m_SwapChainImageViews.size(); i++) {
 		vkDestroyImageView(m_Device->GetLogicalDevice(), m_SwapChainImageViews[i], nullptr);
 	}
-	vkDestroySwapchainKHR(m_Device->GetLogicalDevice(), m_Handle, nullptr);
+	m_Framebuffers.clear();
+	m_SwapChainImageViews.clear();
+}
+
+void FVulkanSwapChain::RetireFramebuffersAndViews(FVulkanQueue * InQueue, uint64_t InSerial)
+{
+	FVulkanDeletionQueue* deletionQueue = m_Device->GetDeletionQueue();
+	for (size_t i = 0; i < m_Framebuffers.size(); i++) {
+		deletionQueue->Enqueue(InQueue, InSerial, FVulkanDeletionQueue::EType::Framebuffer, (uint64_t)m_Framebuffers[i]);
+	}
+	for (size_t i = 0; i < m_SwapChainImageViews.size(); i++) {
+		deletionQueue->Enqueue(InQueue, InSerial, FVulkanDeletionQueue::EType::ImageView, (uint64_t)m_SwapChainImageViews[i]);
+	}
+	m_Framebuffers.clear();
+	m_SwapChainImageViews.clear();
 }
 
 void FVulkanSwapChain::CreateFramebuffers(const FVulkanRenderPass * InRenderPass)
 {
+	m_RenderPass = InRenderPass;
 	m_Framebuffers.resize(m_SwapChainImageViews.size());
 
 	for (size_t i = 0; i < m_Framebuffers.size(); i++) {
@@ -57,19 +169,16 @@ void FVulkanSwapChain::CreateFramebuffers(const FVulkanRenderPass * InRenderPass
 	}
 }
 
-void FVulkanSwapChain::CreateSwapChain()
+void FVulkanSwapChain::CreateSwapChain(VkSwapchainKHR InOldSwapChain)
 {
 	FVulkanUtil::SwapChainSupportDetails swapChainSupport = FVulkanUtil::QuerySwapChainSupport(m_Device->GetPhysicalDevice(), m_Device->GetInstance()->GetSurface());
 
 	VkSurfaceFormatKHR surfaceFormat = ChooseSwapSurfaceFormat(swapChainSupport.Formats);
-	VkPresentModeKHR presentMode = ChooseSwapPresentMode(swapChainSupport.PresentModes);
+	VkPresentModeKHR presentMode = m_Pacer.ChoosePresentMode(swapChainSupport.PresentModes);
 	VkExtent2D extent = ChooseSwapExtent(swapChainSupport.Capabilities);
 
 
-	uint32_t imageCount = swapChainSupport.Capabilities.minImageCount + 1;
-	if (swapChainSupport.Capabilities.maxImageCount > 0 && imageCount > swapChainSupport.Capabilities.maxImageCount) {
-		imageCount = swapChainSupport.Capabilities.maxImageCount;
-	}
+	uint32_t imageCount = m_Pacer.ChooseImageCount(swapChainSupport.Capabilities, presentMode);
 
 	VkSwapchainCreateInfoKHR createInfo = {};
 	createInfo.sType = VK_STRUCTURE_TYPE_SWAPCHAIN_CREATE_INFO_KHR;
@@ -100,7 +209,7 @@ void FVulkanSwapChain::CreateSwapChain()
 	createInfo.presentMode = presentMode;
 	createInfo.clipped = VK_TRUE;
 
-	createInfo.oldSwapchain = VK_NULL_HANDLE;
+	createInfo.oldSwapchain = InOldSwapChain;
 
 	if (vkCreateSwapchainKHR(m_Device->GetLogicalDevice(), &createInfo, nullptr, &m_Handle) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create swap chain!");
@@ -112,6 +221,32 @@ void FVulkanSwapChain::CreateSwapChain()
 
 	m_SwapChainImageFormat = surfaceFormat.format;
 	m_SwapChainExtent = extent;
+
+	m_Pacer.OnSwapChainCreated(presentMode);
+	if (m_Device->IsDisplayTimingSupported()) {
+		auto getRefreshCycleDuration = reinterpret_cast<PFN_vkGetRefreshCycleDurationGOOGLE>(vkGetDeviceProcAddr(m_Device->GetLogicalDevice(), "vkGetRefreshCycleDurationGOOGLE"));
+		VkRefreshCycleDurationGOOGLE refreshCycle = {};
+		if (getRefreshCycleDuration && getRefreshCycleDuration(m_Device->GetLogicalDevice(), m_Handle, &refreshCycle) == VK_SUCCESS) {
+			m_Pacer.SetRefreshPeriod(refreshCycle.refreshDuration);
+		}
+	}
+}
+
+void FVulkanSwapChain::CreateOffscreenImages()
+{
+	uint32_t width = 0, height = 0;
+	if (!m_Device->GetInstance()->GetWindow()->GetWindowSize(width, height)) {
+		throw std::runtime_error("failed to create offscreen images, window has no size!");
+	}
+
+	m_SwapChainImageFormat = VK_FORMAT_B8G8R8A8_UNORM;
+	m_SwapChainExtent = { width, height };
+
+	m_Offscreen->Setup(m_SwapChainExtent, m_SwapChainImageFormat, VULKAN_HEADLESS_IMAGE_COUNT);
+	m_SwapChainImages = m_Offscreen->GetImages();
+
+	// Runs as fast as the GPU renders, there is no refresh for the pacer to measure
+	m_Pacer.OnSwapChainCreated(VK_PRESENT_MODE_IMMEDIATE_KHR);
 }
 
 void FVulkanSwapChain::CreateSwapChainImageViews()
@@ -139,25 +274,6 @@ VkSurfaceFormatKHR FVulkanSwapChain::ChooseSwapSurfaceFormat(const std::vector<V
 	return InAvailableFormats[0];
 }
 
-VkPresentModeKHR FVulkanSwapChain::ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> InAvailablePresentModes)
-{
-	VkPresentModeKHR bestMode = VK_PRESENT_MODE_FIFO_KHR;
-
-	for (const auto& availablePresentMode : InAvailablePresentModes) {
-		if (availablePresentMode == VK_PRESENT_MODE_MAILBOX_KHR) {
-			return availablePresentMode;
-		}
-		else if (availablePresentMode == VK_PRESENT_MODE_FIFO_KHR) {
-			break;
-		}
-		else if (availablePresentMode == VK_PRESENT_MODE_IMMEDIATE_KHR) {
-			bestMode = availablePresentMode;
-		}
-	}
-
-	return bestMode;
-}
-
 VkExtent2D FVulkanSwapChain::ChooseSwapExtent(const VkSurfaceCapabilitiesKHR & InCapabilities)
 {
 	if (InCapabilities.currentExtent.width != std::numeric_limits<uint32_t>::max()) {
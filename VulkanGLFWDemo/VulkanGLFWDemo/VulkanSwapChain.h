@@ -1,20 +1,30 @@
 #pragma once
+#include <memory>
 #include <vector>
 #include <vulkan/vulkan.h>
+#include "VulkanOffscreenPresenter.h"
+#include "VulkanPresentPacer.h"
 
 class FVulkanDevice;
+class FVulkanQueue;
+class FVulkanSemaphore;
 class FVulkanRenderPass;
 
 class FVulkanSwapChain
 {
 public:
-	FVulkanSwapChain(const FVulkanDevice* InDevice);
+	// Without a surface (headless window) the images come from an offscreen ring presented on InPresentQueue
+	FVulkanSwapChain(const FVulkanDevice* InDevice, FVulkanQueue* InPresentQueue, EVulkanPresentPolicy InPolicy = EVulkanPresentPolicy::LowLatency);
 	~FVulkanSwapChain();
 
 	void Setup();
 	void Release();
 
 	void CreateFramebuffers(const FVulkanRenderPass* InRenderPass);
+	// Call when AcquireNextImage or Present return VK_SUBOPTIMAL_KHR or VK_ERROR_OUT_OF_DATE_KHR.
+	// Nothing waits: the old swap chain, views and framebuffers go to the deletion queue until the work
+	// submitted to InRenderQueue so far has completed. The framebuffers are rebuilt for the render pass given to CreateFramebuffers.
+	void Recreate(FVulkanQueue* InRenderQueue);
 
 	inline VkFormat GetImageFormat() const
 	{
@@ -26,10 +36,42 @@ public:
 		return m_SwapChainExtent;
 	}
 
-	/*inline uint32_t GetImageCount() const
+	inline uint32_t GetImageCount() const
 	{
-		return m_SwapChainImages.size();
-	}*/
+		return static_cast<uint32_t>(m_SwapChainImages.size());
+	}
+
+	inline EVulkanPresentPolicy GetPresentPolicy() const
+	{
+		return m_Pacer.GetPolicy();
+	}
+
+	inline VkPresentModeKHR GetPresentMode() const
+	{
+		return m_Pacer.GetPresentMode();
+	}
+
+	// Present returns VK_SUBOPTIMAL_KHR until the swap chain has been recreated with the new policy
+	void SetPresentPolicy(EVulkanPresentPolicy InPolicy);
+
+	inline bool IsHeadless() const
+	{
+		return m_Offscreen != nullptr;
+	}
+
+	// Final layout of the render pass writing the swap chain images
+	inline VkImageLayout GetPresentLayout() const
+	{
+		return m_Offscreen ? m_Offscreen->GetPresentLayout() : VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+	}
+
+	// Headless only, every presented image is copied back and handed to InCallback.
+	// Takes effect the next time the swap chain is created.
+	void SetReadbackCallback(FVulkanOffscreenPresenter::ReadbackCallbackFunction InCallback);
+
+	VkResult AcquireNextImage(const FVulkanSemaphore* InImageAvailable, uint32_t& OutImageIndex, uint64_t InTimeoutNs = UINT64_MAX);
+	// Also returns VK_SUBOPTIMAL_KHR when missed frames made the policy switch to another present mode
+	VkResult Present(uint32_t InImageIndex, const FVulkanSemaphore* InRenderFinished);
 
 	inline const std::vector<VkImageView>& GetImageViews() const
 	{
@@ -49,25 +91,32 @@ public:
 	
 
 private:
-	void CreateSwapChain();
+	void CreateSwapChain(VkSwapchainKHR InOldSwapChain);
+	void CreateOffscreenImages();
 	void CreateSwapChainImageViews();
-	
+	void DestoryFramebuffersAndViews();
+	void RetireFramebuffersAndViews(FVulkanQueue* InQueue, uint64_t InSerial);
 
 	VkSurfaceFormatKHR ChooseSwapSurfaceFormat(const std::vector<VkSurfaceFormatKHR>& InAvailableFormats);
-	VkPresentModeKHR ChooseSwapPresentMode(const std::vector<VkPresentModeKHR> InAvailablePresentModes);
 	VkExtent2D ChooseSwapExtent(const VkSurfaceCapabilitiesKHR& InCapabilities);
 	VkImageView CreateImageView(VkImage& image, VkFormat& format);
 
 
 private:
 	const FVulkanDevice* m_Device;
+	FVulkanQueue* m_PresentQueue;
 
 	VkSwapchainKHR m_Handle;
+	std::unique_ptr<FVulkanOffscreenPresenter> m_Offscreen;
 
 	VkExtent2D m_SwapChainExtent;
 	VkFormat m_SwapChainImageFormat;
 	std::vector<VkImage> m_SwapChainImages;
 	std::vector<VkImageView> m_SwapChainImageViews;
 	std::vector<VkFramebuffer> m_Framebuffers;
-	
+	const FVulkanRenderPass* m_RenderPass;
+
+	FVulkanPresentPacer m_Pacer;
+	// The present mode has to change, set until Recreate()
+	bool m_bRecreatePending;
 };
@@ -4,9 +4,16 @@
 #include "VulkanQueue.h"
 #include "VulkanCommandBuffer.h"
 #include "VulkanBuffer.h"
+#include "VulkanFormat.h"
+#include "VulkanKtx2.h"
+#include "VulkanPixelConvert.h"
+#include "VulkanPnm.h"
+#include "VulkanTileDiff.h"
+#include <algorithm>
+#include <cstring>
 
 FVulkanTexture::FVulkanTexture(const FVulkanDevice * InDevice)
-	:m_Device(InDevice)
+	:m_TextureSampler(VK_NULL_HANDLE), m_bCachedSampler(false), m_SamplerQuality(EVulkanSamplerQuality::Linear), m_SamplerMaxLod(0.0f), m_Device(InDevice)
 {
 }
 
@@ -16,7 +23,7 @@ FVulkanTexture::~FVulkanTexture()
 
 void FVulkanTexture::CreateTexture(VkImageType imagetype, VkFormat format, VkExtent3D extent,
 	uint32_t miplevels, uint32_t arraylayers, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-	VkImage& image, VkDeviceMemory& memory)
+	VkImage& image, FVulkanAllocation& allocation, bool dedicated, VkImageCreateFlags flags)
 {
 
 	/*m_Format = format;
@@ -36,29 +43,20 @@ void FVulkanTexture::CreateTexture(VkImageType imagetype, VkFormat format, VkExt
 	imageInfo.usage = usage;
 	imageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
 	imageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
-	imageInfo.flags = 0;
+	imageInfo.flags = flags;
 
 	if (vkCreateImage(m_Device->GetLogicalDevice(), &imageInfo, nullptr, &image) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create image!");
 	}
 
-	VkMemoryRequirements memRequirements;
-	vkGetImageMemoryRequirements(m_Device->GetLogicalDevice(), image, &memRequirements);
-
-	VkMemoryAllocateInfo allocInfo = {};
-	allocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-	allocInfo.allocationSize = memRequirements.size;
-	allocInfo.memoryTypeIndex = FVulkanUtil::FindMemoryType(m_Device->GetPhysicalDevice(), memRequirements.memoryTypeBits, properties);
-
-	if (vkAllocateMemory(m_Device->GetLogicalDevice(), &allocInfo, nullptr, &memory) != VK_SUCCESS) {
-		throw std::runtime_error("failed to allocate image memory!");
-	}
-
-	vkBindImageMemory(m_Device->GetLogicalDevice(), image, memory, 0);
+	m_Device->GetMemoryManager()->AllocateImageMemory(image, tiling, properties, allocation, dedicated);
 }
 
-void FVulkanTexture::CreateImageView(VkImage image, VkImageViewType viewtype, VkFormat format, uint32_t levels, uint32_t layers, VkImageView& view)
+void FVulkanTexture::CreateImageView(VkImage image, VkImageViewType viewtype, VkFormat format, uint32_t levels, uint32_t layers, VkImageView& view, VkImageUsageFlags usage)
 {
+	VkImageViewUsageCreateInfo usageInfo = {};
+	usageInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_USAGE_CREATE_INFO;
+	usageInfo.usage = usage;
 
 	VkImageViewCreateInfo viewInfo = {};
 	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
@@ -70,48 +68,124 @@ void FVulkanTexture::CreateImageView(VkImage image, VkImageViewType viewtype, Vk
 	viewInfo.subresourceRange.levelCount = levels;
 	viewInfo.subresourceRange.baseArrayLayer = 0;
 	viewInfo.subresourceRange.layerCount = layers;
+	viewInfo.pNext = usage ? &usageInfo : nullptr;
 
 	if (vkCreateImageView(m_Device->GetLogicalDevice(), &viewInfo, nullptr, &view) != VK_SUCCESS) {
 		throw std::runtime_error("failed to create texture image view!");
 	}
 }
 
-void FVulkanTexture::CreateTextureSampler(VkSampler& sampler)
+void FVulkanTexture::CreateTextureSampler(VkSampler& sampler, float maxLod, EVulkanSamplerQuality quality)
 {
-	VkSamplerCreateInfo samplerInfo = {};
-	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
-	samplerInfo.magFilter = VK_FILTER_LINEAR;
-	samplerInfo.minFilter = VK_FILTER_LINEAR;
-	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
-	samplerInfo.anisotropyEnable = VK_TRUE;
-	samplerInfo.maxAnisotropy = 16;
-	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
-	samplerInfo.unnormalizedCoordinates = VK_FALSE;
-	samplerInfo.compareEnable = VK_FALSE;
-	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
-	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
-	samplerInfo.mipLodBias = 0.0f;
-	samplerInfo.minLod = 0.0f;
-	samplerInfo.maxLod = 0.0f;
+	sampler = m_Device->GetSamplerCache()->Acquire(quality, maxLod);
+	m_bCachedSampler = true;
+	m_SamplerQuality = quality;
+	m_SamplerMaxLod = maxLod;
+}
 
-	if (vkCreateSampler(m_Device->GetLogicalDevice(), &samplerInfo, nullptr, &sampler) != VK_SUCCESS) {
-		throw std::runtime_error("failed to create texture sampler!");
-	}
+void FVulkanTexture::SetSamplerQuality(EVulkanSamplerQuality InQuality)
+{
+	if (!m_bCachedSampler || InQuality == m_SamplerQuality) return;
+
+	VkSampler sampler = m_Device->GetSamplerCache()->Acquire(InQuality, m_SamplerMaxLod);
+	m_Device->GetSamplerCache()->Release(m_TextureSampler);
+	m_TextureSampler = sampler;
+	m_SamplerQuality = InQuality;
+}
+
+void FVulkanTexture::TransitionImageLayout(FVulkanCommandBuffer * InCmdBuffer, VkImage image, uint32_t levels, uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseLayer)
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	// Only queued, the barrier is recorded with the others right before the image is used
+	const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, levels, baseLayer, layers };
+	InCmdBuffer->GetImageStates().Transition(image, range, oldLayout, FVulkanImageStateTracker::GetLayoutState(newLayout));
 }
 
-void FVulkanTexture::TransitionImageLayout(FVulkanCommandBuffer * InCmdBuffer, VkImage image, uint32_t levels, uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout)
+void FVulkanTexture::CopyBufferToImage(FVulkanCommandBuffer * InCmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkImage image, VkExtent3D extent, uint32_t layers)
 {
 	/*InCmdBuffer->Begin();*/
 	if (!InCmdBuffer->HasBegun()) return;
 
+	VkBufferImageCopy region = {};
+	region.bufferOffset = offset;
+	region.bufferRowLength = 0;
+	region.bufferImageHeight = 0;
+
+	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	region.imageSubresource.mipLevel = 0;
+	region.imageSubresource.baseArrayLayer = 0;
+	region.imageSubresource.layerCount = layers;
+
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = extent;
+
+	InCmdBuffer->GetImageStates().Flush();
+	vkCmdCopyBufferToImage(
+		InCmdBuffer->GetHandle(),
+		buffer,
+		image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		1,
+		&region
+	);
+
+	/*InCmdBuffer->End();
+	InCmdBuffer->GetOwner()->GetQueue()->Submit(InCmdBuffer);*/
+}
+
+void FVulkanTexture::CopyBufferToImageLevels(FVulkanCommandBuffer * InCmdBuffer, VkBuffer buffer, const VkDeviceSize * levelOffsets, VkImage image, VkFormat format, VkExtent3D extent, uint32_t levels, uint32_t layers)
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	const FVulkanFormatInfo info = GetVulkanFormatInfo(format);
+
+	std::vector<VkBufferImageCopy> regions(levels);
+	for (uint32_t level = 0; level < levels; level++)
+	{
+		const uint32_t width = std::max(extent.width >> level, 1u);
+		const uint32_t height = std::max(extent.height >> level, 1u);
+
+		VkBufferImageCopy& region = regions[level];
+		region.bufferOffset = levelOffsets[level];
+		// In texels, rounded up to whole blocks. The image extent itself may end in a partial block
+		// since it reaches the edge of the level.
+		region.bufferRowLength = (width + info.BlockWidth - 1) / info.BlockWidth * info.BlockWidth;
+		region.bufferImageHeight = (height + info.BlockHeight - 1) / info.BlockHeight * info.BlockHeight;
+
+		region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+		region.imageSubresource.mipLevel = level;
+		region.imageSubresource.baseArrayLayer = 0;
+		region.imageSubresource.layerCount = layers;
+
+		region.imageOffset = { 0, 0, 0 };
+		region.imageExtent = { width, height, 1 };
+	}
+
+	InCmdBuffer->GetImageStates().Flush();
+	vkCmdCopyBufferToImage(
+		InCmdBuffer->GetHandle(),
+		buffer,
+		image,
+		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+		levels,
+		regions.data()
+	);
+}
+
+void FVulkanTexture::TransferImageOwnership(FVulkanCommandBuffer * InCmdBuffer, VkImage image, uint32_t levels, uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout,
+	uint32_t srcFamily, uint32_t dstFamily, bool bRelease, VkPipelineStageFlags acquireStage, VkAccessFlags acquireAccess)
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	InCmdBuffer->GetImageStates().Flush();
+
 	VkImageMemoryBarrier barrier = {};
 	barrier.sType = VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER;
 	barrier.oldLayout = oldLayout;
 	barrier.newLayout = newLayout;
-	barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
-	barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+	barrier.srcQueueFamilyIndex = srcFamily;
+	barrier.dstQueueFamilyIndex = dstFamily;
 	barrier.image = image;
 	barrier.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
 	barrier.subresourceRange.baseMipLevel = 0;
@@ -122,32 +196,23 @@ void FVulkanTexture::TransitionImageLayout(FVulkanCommandBuffer * InCmdBuffer, V
 	VkPipelineStageFlags sourceStage;
 	VkPipelineStageFlags destinationStage;
 
-	if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL) {
-		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+	// The release only makes the writes available, the acquire only makes them visible.
+	// Both are ordered by the semaphore between the two submissions.
+	if (bRelease) {
 		barrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = 0;
 
 		sourceStage = VK_PIPELINE_STAGE_TRANSFER_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+		destinationStage = VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT;
 	}
-	else if (oldLayout == VK_IMAGE_LAYOUT_UNDEFINED && newLayout == VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL) {
+	else {
 		barrier.srcAccessMask = 0;
-		barrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT;
+		barrier.dstAccessMask = acquireAccess;
 
-		sourceStage = VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
-		destinationStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
-	}
-	else {
-		throw std::invalid_argument("unsupported layout transition!");
+		sourceStage = acquireStage;
+		destinationStage = acquireStage;
 	}
 
-
 	vkCmdPipelineBarrier(
 		InCmdBuffer->GetHandle(),
 		sourceStage, destinationStage,
@@ -157,691 +222,926 @@ void FVulkanTexture::TransitionImageLayout(FVulkanCommandBuffer * InCmdBuffer, V
 		1, &barrier
 	);
 
-	/*InCmdBuffer->End();
-	InCmdBuffer->GetOwner()->GetQueue()->Submit(InCmdBuffer);*/
+	const FVulkanImageStateTracker::FState state = { newLayout, destinationStage, barrier.dstAccessMask };
+	InCmdBuffer->GetImageStates().SetState(image, barrier.subresourceRange, state);
 }
 
-void FVulkanTexture::CopyBufferToImage(FVulkanCommandBuffer * InCmdBuffer, VkBuffer buffer, VkImage image, VkExtent3D extent, uint32_t layers)
+void FVulkanTexture::StageUploadData(FVulkanCommandBuffer * InCmdBuffer, const void * InSrcData, VkDeviceSize InSize, uint32_t InTexelSize, VkBuffer & OutBuffer, VkDeviceSize & OutOffset)
 {
-	/*InCmdBuffer->Begin();*/
-	if (!InCmdBuffer->HasBegun()) return;
-
-	VkBufferImageCopy region = {};
-	region.bufferOffset = 0;
-	region.bufferRowLength = 0;
-	region.bufferImageHeight = 0;
+	void* mappedData = AllocateUploadData(InCmdBuffer, InSize, InTexelSize, OutBuffer, OutOffset);
+	memcpy(mappedData, InSrcData, (size_t)InSize);
+}
 
-	region.imageSubresource.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
-	region.imageSubresource.mipLevel = 0;
-	region.imageSubresource.baseArrayLayer = 0;
-	region.imageSubresource.layerCount = layers;
+void* FVulkanTexture::AllocateUploadData(FVulkanCommandBuffer * InCmdBuffer, VkDeviceSize InSize, uint32_t InTexelSize, VkBuffer & OutBuffer, VkDeviceSize & OutOffset)
+{
+	// Buffer offsets of image copies have to be a multiple of both 4 and the texel size
+	VkDeviceSize alignment = InTexelSize > 0 ? InTexelSize : 4;
+	while (alignment % 4) alignment += InTexelSize;
 
-	region.imageOffset = { 0, 0, 0 };
-	region.imageExtent = extent;
+	FVulkanStagingRingBuffer::FAllocation staging;
+	if (m_Device->GetStagingRing()->Allocate(InSize, alignment, InCmdBuffer, staging)) {
+		OutBuffer = staging.Buffer;
+		OutOffset = staging.Offset;
+		return staging.MappedData;
+	}
 
-	vkCmdCopyBufferToImage(
-		InCmdBuffer->GetHandle(),
-		buffer,
-		image,
-		VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
-		1,
-		&region
-	);
+	// Doesn't fit in the staging ring (e.g. anything over its 64MB), fall back to a buffer of its own.
+	// This is the one upload path that still allocates per upload, large images should be rare enough for it.
+	// It stays mapped until InCmdBuffer has completed, so it can still be written before the submit.
+	FVulkanStagingBuffer stagingBuffer(m_Device, InSize);
+	void* mappedData = stagingBuffer.GetMappedData();
 
-	/*InCmdBuffer->End();
-	InCmdBuffer->GetOwner()->GetQueue()->Submit(InCmdBuffer);*/
+	OutBuffer = stagingBuffer.ReleaseAfter(InCmdBuffer);
+	OutOffset = 0;
+	return mappedData;
 }
 
 uint32_t FVulkanTexture::GetBppFromFormat(VkFormat InFormat)
 {
-
-	switch (InFormat)
-	{
-	case VK_FORMAT_UNDEFINED:
-		return 0;
-		break;
-	/*case VK_FORMAT_R4G4_UNORM_PACK8:
-		break;
-	case VK_FORMAT_R4G4B4A4_UNORM_PACK16:
-		break;
-	case VK_FORMAT_B4G4R4A4_UNORM_PACK16:
-		break;
-	case VK_FORMAT_R5G6B5_UNORM_PACK16:
-		break;
-	case VK_FORMAT_B5G6R5_UNORM_PACK16:
-		break;
-	case VK_FORMAT_R5G5B5A1_UNORM_PACK16:
-		break;
-	case VK_FORMAT_B5G5R5A1_UNORM_PACK16:
-		break;
-	case VK_FORMAT_A1R5G5B5_UNORM_PACK16:
-		break;*/
-	case VK_FORMAT_R8_UNORM:
-		return 1;
-		break;
-	case VK_FORMAT_R8_SNORM:
-		return 1;
-		break;
-	/*case VK_FORMAT_R8_USCALED:
-		break;
-	case VK_FORMAT_R8_SSCALED:
-		break;
-	case VK_FORMAT_R8_UINT:
-		break;
-	case VK_FORMAT_R8_SINT:
-		break;
-	case VK_FORMAT_R8_SRGB:
-		break;
-	case VK_FORMAT_R8G8_UNORM:
-		break;
-	case VK_FORMAT_R8G8_SNORM:
-		break;
-	case VK_FORMAT_R8G8_USCALED:
-		break;
-	case VK_FORMAT_R8G8_SSCALED:
-		break;
-	case VK_FORMAT_R8G8_UINT:
-		break;
-	case VK_FORMAT_R8G8_SINT:
-		break;
-	case VK_FORMAT_R8G8_SRGB:
-		break;
-	case VK_FORMAT_R8G8B8_UNORM:
-		break;
-	case VK_FORMAT_R8G8B8_SNORM:
-		break;
-	case VK_FORMAT_R8G8B8_USCALED:
-		break;
-	case VK_FORMAT_R8G8B8_SSCALED:
-		break;
-	case VK_FORMAT_R8G8B8_UINT:
-		break;
-	case VK_FORMAT_R8G8B8_SINT:
-		break;
-	case VK_FORMAT_R8G8B8_SRGB:
-		break;
-	case VK_FORMAT_B8G8R8_UNORM:
-		break;
-	case VK_FORMAT_B8G8R8_SNORM:
-		break;
-	case VK_FORMAT_B8G8R8_USCALED:
-		break;
-	case VK_FORMAT_B8G8R8_SSCALED:
-		break;
-	case VK_FORMAT_B8G8R8_UINT:
-		break;
-	case VK_FORMAT_B8G8R8_SINT:
-		break;
-	case VK_FORMAT_B8G8R8_SRGB:
-		break;*/
-	case VK_FORMAT_R8G8B8A8_UNORM:
-		return 4;
-		break;
-	case VK_FORMAT_R8G8B8A8_SNORM:
-		return 4;
-		break;
-	case VK_FORMAT_R8G8B8A8_USCALED:
-		return 4;
-		break;
-	case VK_FORMAT_R8G8B8A8_SSCALED:
-		return 4;
-		break;
-	case VK_FORMAT_R8G8B8A8_UINT:
-		return 4;
-		break;
-	case VK_FORMAT_R8G8B8A8_SINT:
-		return 4;
-		break;
-	case VK_FORMAT_R8G8B8A8_SRGB:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_UNORM:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_SNORM:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_USCALED:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_SSCALED:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_UINT:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_SINT:
-		return 4;
-		break;
-	case VK_FORMAT_B8G8R8A8_SRGB:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_UNORM_PACK32:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_SNORM_PACK32:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_USCALED_PACK32:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_SSCALED_PACK32:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_UINT_PACK32:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_SINT_PACK32:
-		return 4;
-		break;
-	case VK_FORMAT_A8B8G8R8_SRGB_PACK32:
-		return 4;
-		break;
-	/*case VK_FORMAT_A2R10G10B10_UNORM_PACK32:
-		break;
-	case VK_FORMAT_A2R10G10B10_SNORM_PACK32:
-		break;
-	case VK_FORMAT_A2R10G10B10_USCALED_PACK32:
-		break;
-	case VK_FORMAT_A2R10G10B10_SSCALED_PACK32:
-		break;
-	case VK_FORMAT_A2R10G10B10_UINT_PACK32:
-		break;
-	case VK_FORMAT_A2R10G10B10_SINT_PACK32:
-		break;
-	case VK_FORMAT_A2B10G10R10_UNORM_PACK32:
-		break;
-	case VK_FORMAT_A2B10G10R10_SNORM_PACK32:
-		break;
-	case VK_FORMAT_A2B10G10R10_USCALED_PACK32:
-		break;
-	case VK_FORMAT_A2B10G10R10_SSCALED_PACK32:
-		break;
-	case VK_FORMAT_A2B10G10R10_UINT_PACK32:
-		break;
-	case VK_FORMAT_A2B10G10R10_SINT_PACK32:
-		break;*/
-	/*case VK_FORMAT_R16_UNORM:
-		break;
-	case VK_FORMAT_R16_SNORM:
-		break;
-	case VK_FORMAT_R16_USCALED:
-		break;
-	case VK_FORMAT_R16_SSCALED:
-		break;
-	case VK_FORMAT_R16_UINT:
-		break;
-	case VK_FORMAT_R16_SINT:
-		break;
-	case VK_FORMAT_R16_SFLOAT:
-		break;
-	case VK_FORMAT_R16G16_UNORM:
-		break;
-	case VK_FORMAT_R16G16_SNORM:
-		break;
-	case VK_FORMAT_R16G16_USCALED:
-		break;
-	case VK_FORMAT_R16G16_SSCALED:
-		break;
-	case VK_FORMAT_R16G16_UINT:
-		break;
-	case VK_FORMAT_R16G16_SINT:
-		break;
-	case VK_FORMAT_R16G16_SFLOAT:
-		break;
-	case VK_FORMAT_R16G16B16_UNORM:
-		break;
-	case VK_FORMAT_R16G16B16_SNORM:
-		break;
-	case VK_FORMAT_R16G16B16_USCALED:
-		break;
-	case VK_FORMAT_R16G16B16_SSCALED:
-		break;
-	case VK_FORMAT_R16G16B16_UINT:
-		break;
-	case VK_FORMAT_R16G16B16_SINT:
-		break;
-	case VK_FORMAT_R16G16B16_SFLOAT:
-		break;
-	case VK_FORMAT_R16G16B16A16_UNORM:
-		break;
-	case VK_FORMAT_R16G16B16A16_SNORM:
-		break;
-	case VK_FORMAT_R16G16B16A16_USCALED:
-		break;
-	case VK_FORMAT_R16G16B16A16_SSCALED:
-		break;
-	case VK_FORMAT_R16G16B16A16_UINT:
-		break;
-	case VK_FORMAT_R16G16B16A16_SINT:
-		break;
-	case VK_FORMAT_R16G16B16A16_SFLOAT:
-		break;*/
-	/*case VK_FORMAT_R32_UINT:
-		break;
-	case VK_FORMAT_R32_SINT:
-		break;
-	case VK_FORMAT_R32_SFLOAT:
-		break;
-	case VK_FORMAT_R32G32_UINT:
-		break;
-	case VK_FORMAT_R32G32_SINT:
-		break;
-	case VK_FORMAT_R32G32_SFLOAT:
-		break;
-	case VK_FORMAT_R32G32B32_UINT:
-		break;
-	case VK_FORMAT_R32G32B32_SINT:
-		break;
-	case VK_FORMAT_R32G32B32_SFLOAT:
-		break;
-	case VK_FORMAT_R32G32B32A32_UINT:
-		break;
-	case VK_FORMAT_R32G32B32A32_SINT:
-		break;
-	case VK_FORMAT_R32G32B32A32_SFLOAT:
-		break;*/
-	/*case VK_FORMAT_R64_UINT:
-		break;
-	case VK_FORMAT_R64_SINT:
-		break;
-	case VK_FORMAT_R64_SFLOAT:
-		break;
-	case VK_FORMAT_R64G64_UINT:
-		break;
-	case VK_FORMAT_R64G64_SINT:
-		break;
-	case VK_FORMAT_R64G64_SFLOAT:
-		break;
-	case VK_FORMAT_R64G64B64_UINT:
-		break;
-	case VK_FORMAT_R64G64B64_SINT:
-		break;
-	case VK_FORMAT_R64G64B64_SFLOAT:
-		break;
-	case VK_FORMAT_R64G64B64A64_UINT:
-		break;
-	case VK_FORMAT_R64G64B64A64_SINT:
-		break;
-	case VK_FORMAT_R64G64B64A64_SFLOAT:
-		break;*/
-	//case VK_FORMAT_B10G11R11_UFLOAT_PACK32:
-	//	break;
-	//case VK_FORMAT_E5B9G9R9_UFLOAT_PACK32:
-	//	break;
-	//case VK_FORMAT_D16_UNORM:
-	//	break;
-	//case VK_FORMAT_X8_D24_UNORM_PACK32:
-	//	break;
-	//case VK_FORMAT_D32_SFLOAT:
-	//	break;
-	//case VK_FORMAT_S8_UINT:
-	//	break;
-	//case VK_FORMAT_D16_UNORM_S8_UINT:
-	//	break;
-	//case VK_FORMAT_D24_UNORM_S8_UINT:
-	//	break;
-	//case VK_FORMAT_D32_SFLOAT_S8_UINT:
-	//	break;
-	//case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC2_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC2_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC3_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC3_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC4_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC4_SNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC5_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC5_SNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC6H_UFLOAT_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC6H_SFLOAT_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC7_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_BC7_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ETC2_R8G8B8_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ETC2_R8G8B8_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ETC2_R8G8B8A1_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ETC2_R8G8B8A1_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ETC2_R8G8B8A8_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ETC2_R8G8B8A8_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_EAC_R11_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_EAC_R11_SNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_EAC_R11G11_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_EAC_R11G11_SNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_4x4_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_4x4_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_5x4_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_5x4_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_5x5_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_5x5_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_6x5_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_6x5_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_6x6_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_6x6_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_8x5_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_8x5_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_8x6_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_8x6_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_8x8_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_8x8_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x5_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x5_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x6_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x6_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x8_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x8_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x10_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_10x10_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_12x10_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_12x10_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_12x12_UNORM_BLOCK:
-	//	break;
-	//case VK_FORMAT_ASTC_12x12_SRGB_BLOCK:
-	//	break;
-	//case VK_FORMAT_G8B8G8R8_422_UNORM:
-	//	break;
-	//case VK_FORMAT_B8G8R8G8_422_UNORM:
-	//	break;
-	//case VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM:
-	//	break;
-	//case VK_FORMAT_G8_B8R8_2PLANE_420_UNORM:
-	//	break;
-	//case VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM:
-	//	break;
-	//case VK_FORMAT_G8_B8R8_2PLANE_422_UNORM:
-	//	break;
-	//case VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM:
-	//	break;
-	//case VK_FORMAT_R10X6_UNORM_PACK16:
-	//	break;
-	//case VK_FORMAT_R10X6G10X6_UNORM_2PACK16:
-	//	break;
-	//case VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16:
-	//	break;
-	//case VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16:
-	//	break;
-	//case VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_R12X4_UNORM_PACK16:
-	//	break;
-	//case VK_FORMAT_R12X4G12X4_UNORM_2PACK16:
-	//	break;
-	//case VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16:
-	//	break;
-	//case VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16:
-	//	break;
-	//case VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16:
-	//	break;
-	//case VK_FORMAT_G16B16G16R16_422_UNORM:
-	//	break;
-	//case VK_FORMAT_B16G16R16G16_422_UNORM:
-	//	break;
-	//case VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM:
-	//	break;
-	//case VK_FORMAT_G16_B16R16_2PLANE_420_UNORM:
-	//	break;
-	//case VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM:
-	//	break;
-	//case VK_FORMAT_G16_B16R16_2PLANE_422_UNORM:
-	//	break;
-	//case VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM:
-	//	break;
-	//case VK_FORMAT_PVRTC1_2BPP_UNORM_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC1_4BPP_UNORM_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC2_2BPP_UNORM_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC2_4BPP_UNORM_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC1_2BPP_SRGB_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC1_4BPP_SRGB_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC2_2BPP_SRGB_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_PVRTC2_4BPP_SRGB_BLOCK_IMG:
-	//	break;
-	//case VK_FORMAT_ASTC_4x4_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_5x4_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_5x5_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_6x5_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_6x6_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_8x5_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_8x6_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_8x8_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_10x5_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_10x6_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_10x8_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_10x10_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_12x10_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_ASTC_12x12_SFLOAT_BLOCK_EXT:
-	//	break;
-	//case VK_FORMAT_G8B8G8R8_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_B8G8R8G8_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G8_B8R8_2PLANE_420_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G8_B8_R8_3PLANE_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G8_B8R8_2PLANE_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G8_B8_R8_3PLANE_444_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_R10X6_UNORM_PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_R10X6G10X6_UNORM_2PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_R10X6G10X6B10X6A10X6_UNORM_4PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G10X6B10X6G10X6R10X6_422_UNORM_4PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_B10X6G10X6R10X6G10X6_422_UNORM_4PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_420_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_422_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6R10X6_2PLANE_422_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G10X6_B10X6_R10X6_3PLANE_444_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_R12X4_UNORM_PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_R12X4G12X4_UNORM_2PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_R12X4G12X4B12X4A12X4_UNORM_4PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G12X4B12X4G12X4R12X4_422_UNORM_4PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_B12X4G12X4R12X4G12X4_422_UNORM_4PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_420_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_420_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_422_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4R12X4_2PLANE_422_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G12X4_B12X4_R12X4_3PLANE_444_UNORM_3PACK16_KHR:
-	//	break;
-	//case VK_FORMAT_G16B16G16R16_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_B16G16R16G16_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G16_B16_R16_3PLANE_420_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G16_B16R16_2PLANE_420_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G16_B16_R16_3PLANE_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G16_B16R16_2PLANE_422_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_G16_B16_R16_3PLANE_444_UNORM_KHR:
-	//	break;
-	//case VK_FORMAT_BEGIN_RANGE:
-	//	break;
-	//case VK_FORMAT_END_RANGE:
-	//	break;
-	/*case VK_FORMAT_RANGE_SIZE:
-		break;
-	case VK_FORMAT_MAX_ENUM:
-		break;*/
-	default:
-		break;
-	}
-
-	return 0;
+	// Block-compressed formats have no bytes per texel, see GetVulkanFormatInfo
+	const FVulkanFormatInfo info = GetVulkanFormatInfo(InFormat);
+	return IsVulkanFormatCompressed(InFormat) ? 0 : info.BytesPerBlock;
 }
 
 void FVulkanTexture::DestoryTexture()
 {
-	vkDestroySampler(m_Device->GetLogicalDevice(), m_TextureSampler, nullptr);
+	if (m_bCachedSampler) {
+		m_Device->GetSamplerCache()->Release(m_TextureSampler);
+	}
+	else {
+		vkDestroySampler(m_Device->GetLogicalDevice(), m_TextureSampler, nullptr);
+	}
 	vkDestroyImageView(m_Device->GetLogicalDevice(), m_TextureImageView, nullptr);
 
 	vkDestroyImage(m_Device->GetLogicalDevice(), m_TextureImage, nullptr);
-	vkFreeMemory(m_Device->GetLogicalDevice(), m_TextureImageMemory, nullptr);
+	m_Device->GetMemoryManager()->Free(m_TextureAllocation);
 }
 
-FVulkanTexture2D::FVulkanTexture2D(const FVulkanDevice * InDevice, uint32_t InWidth, uint32_t InHeight, VkFormat InFormat)
-	:FVulkanTexture(InDevice),m_Width(InWidth),m_Height(InHeight),m_Format(InFormat), m_CurrentLayout(VK_IMAGE_LAYOUT_UNDEFINED)
+FVulkanTexture2D::FVulkanTexture2D(const FVulkanDevice * InDevice, uint32_t InWidth, uint32_t InHeight, VkFormat InFormat, bool bInGenerateMips)
+	:FVulkanTexture(InDevice),m_Width(InWidth),m_Height(InHeight),m_Format(InFormat), m_CurrentLayout(VK_IMAGE_LAYOUT_UNDEFINED), m_LastSampledSerial(0), m_MipLevels(1)
 {
+	FVulkanMipGenerator* mipGenerator = m_Device->GetMipGenerator();
+	FVulkanMipGenerator::EMethod mipMethod = FVulkanMipGenerator::EMethod::None;
+	if (bInGenerateMips) {
+		mipMethod = mipGenerator->GetMethod(m_Format);
+		if (mipMethod != FVulkanMipGenerator::EMethod::None) {
+			m_MipLevels = FVulkanMipGenerator::GetMipLevelCount(m_Width, m_Height);
+		}
+	}
+
 	CreateTexture(VK_IMAGE_TYPE_2D, m_Format, VkExtent3D{ m_Width,m_Height,1 },
-		0, 0, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
-		m_TextureImage, m_TextureImageMemory);
-	CreateImageView(m_TextureImage, VK_IMAGE_VIEW_TYPE_2D, m_Format, 0, 0, m_TextureImageView);
-	CreateTextureSampler(m_TextureSampler);
+		m_MipLevels, 1, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT | mipGenerator->GetImageUsage(mipMethod), VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_TextureImage, m_TextureAllocation, false, mipGenerator->GetImageFlags(mipMethod, m_Format));
+	// sRGB images only support storage through the compute path's UNORM views
+	CreateImageView(m_TextureImage, VK_IMAGE_VIEW_TYPE_2D, m_Format, m_MipLevels, 1, m_TextureImageView,
+		mipMethod == FVulkanMipGenerator::EMethod::Compute ? VK_IMAGE_USAGE_SAMPLED_BIT : 0);
+	// Anisotropy only pays off with mips to pick from
+	CreateTextureSampler(m_TextureSampler, static_cast<float>(m_MipLevels - 1), m_MipLevels > 1 ? EVulkanSamplerQuality::Anisotropic : EVulkanSamplerQuality::Linear);
+
+	mipGenerator->CreateTarget(mipMethod, m_TextureImage, m_Format, m_Width, m_Height, m_MipLevels, 1, m_MipChain);
 }
 
 FVulkanTexture2D::~FVulkanTexture2D()
 {
+	m_Device->GetMipGenerator()->DestroyTarget(m_MipChain);
 	DestoryTexture();
 }
 
-void FVulkanTexture2D::UpdateFromData(const void * InSrcData, uint32_t InWidth, uint32_t InHeight, FVulkanCommandBufferManager* InCmdBufferManager)
+void FVulkanTexture2D::UpdateFromData(const void * InSrcData, uint32_t InWidth, uint32_t InHeight, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch)
 {
 	if (InWidth > m_Width || InHeight > m_Height) return;
 
-	FVulkanStagingBuffer* stagingBuffer = new FVulkanStagingBuffer(m_Device, InWidth * InHeight * GetBppFromFormat(m_Format));
-	stagingBuffer->UpdateFromData(InSrcData, InWidth * InHeight * GetBppFromFormat(m_Format));
+	const uint32_t bpp = GetBppFromFormat(m_Format);
+	const VkDeviceSize dataSize = (VkDeviceSize)InWidth * InHeight * bpp;
 
 	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
 
-	class DestoryTask : public FVulkanCommandBuffer::DelayedTask
-	{
-	public:
-		DestoryTask(FVulkanStagingBuffer* buffer) : m_buffer(buffer) {};
-		~DestoryTask() {};
-
-		void DoTask()
-		{
-			delete m_buffer;
-		};
-	private:
-		FVulkanStagingBuffer* m_buffer;
-	};
-	cmdBuffer->AddDelayedTask(FVulkanCommandBuffer::DelayedTaskPtr(new DestoryTask(stagingBuffer)));
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	StageUploadData(cmdBuffer, InSrcData, dataSize, bpp, stagingHandle, stagingOffset);
 
 	cmdBuffer->Begin();
-
-	TransitionImageLayout(cmdBuffer, m_TextureImage, 0, 0, m_CurrentLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
-	m_CurrentLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
-	CopyBufferToImage(cmdBuffer, stagingBuffer->GetBuffer(), m_TextureImage, VkExtent3D{ InWidth , InHeight ,1 }, 0);
-	TransitionImageLayout(cmdBuffer, m_TextureImage, 0, 0, m_CurrentLayout, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
-	m_CurrentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
-
+	RecordUpload(cmdBuffer, stagingHandle, stagingOffset, InWidth, InHeight);
 	cmdBuffer->End();
-	InCmdBufferManager->GetQueue()->Submit(cmdBuffer); 
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
 }
+
+void FVulkanTexture2D::UpdateFromRGB24(const void * InSrcData, uint32_t InSrcPitch, bool bInBGR, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	bool bDstBGRA;
+	switch (m_Format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		bDstBGRA = false;
+		break;
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		bDstBGRA = true;
+		break;
+	default:
+		throw std::runtime_error("failed to update texture from RGB24, format is not 8 bit RGBA!");
+	}
+
+	const uint32_t dstPitch = m_Width * 4;
+	const VkDeviceSize dataSize = (VkDeviceSize)dstPitch * m_Height;
+
+	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
+
+	// Converted straight into staging memory, no intermediate RGBA copy
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	void* mappedData = AllocateUploadData(cmdBuffer, dataSize, 4, stagingHandle, stagingOffset);
+	if (bInBGR == bDstBGRA) {
+		FVulkanPixelConvert::RGBToRGBA(InSrcData, InSrcPitch, mappedData, dstPitch, m_Width, m_Height);
+	}
+	else {
+		FVulkanPixelConvert::BGRToRGBA(InSrcData, InSrcPitch, mappedData, dstPitch, m_Width, m_Height);
+	}
+
+	cmdBuffer->Begin();
+	RecordUpload(cmdBuffer, stagingHandle, stagingOffset, m_Width, m_Height);
+	cmdBuffer->End();
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
+}
+
+void FVulkanTexture2D::UpdateFromPnm(const FVulkanPnmImage & InImage, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	if (InImage.Width != m_Width || InImage.Height != m_Height) {
+		throw std::runtime_error("failed to update texture from PNM, image size doesn't match!");
+	}
+
+	if (InImage.Channels == 3) {
+		UpdateFromRGB24(InImage.Pixels, InImage.Pitch, false, InCmdBufferManager, InBatch);
+		return;
+	}
+
+	bool bSwizzle;
+	switch (m_Format)
+	{
+	case VK_FORMAT_R8G8B8A8_UNORM:
+	case VK_FORMAT_R8G8B8A8_SRGB:
+		bSwizzle = false;
+		break;
+	case VK_FORMAT_B8G8R8A8_UNORM:
+	case VK_FORMAT_B8G8R8A8_SRGB:
+		bSwizzle = true;
+		break;
+	default:
+		throw std::runtime_error("failed to update texture from PNM, format is not 8 bit RGBA!");
+	}
+
+	const uint32_t dstPitch = m_Width * 4;
+	const VkDeviceSize dataSize = (VkDeviceSize)dstPitch * m_Height;
+
+	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
+
+	// PAM rows are tightly packed, the file's pages are read exactly once on their way into staging memory
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	if (bSwizzle) {
+		void* mappedData = AllocateUploadData(cmdBuffer, dataSize, 4, stagingHandle, stagingOffset);
+		FVulkanPixelConvert::SwizzleRB(InImage.Pixels, InImage.Pitch, mappedData, dstPitch, m_Width, m_Height);
+	}
+	else {
+		StageUploadData(cmdBuffer, InImage.Pixels, dataSize, 4, stagingHandle, stagingOffset);
+	}
+
+	cmdBuffer->Begin();
+	RecordUpload(cmdBuffer, stagingHandle, stagingOffset, m_Width, m_Height);
+	cmdBuffer->End();
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
+}
+
+void FVulkanTexture2D::UpdateFromDataAsync(const void * InSrcData, FVulkanCommandBufferManager * InTransferCmdBufferManager, FVulkanCommandBuffer * InGraphicsCmdBuffer, const FVulkanSemaphore * InUploadDone)
+{
+	if (!InGraphicsCmdBuffer->HasBegun()) return;
+
+	const uint32_t bpp = GetBppFromFormat(m_Format);
+	const VkDeviceSize dataSize = (VkDeviceSize)m_Width * m_Height * bpp;
+
+	FVulkanQueue* transferQueue = InTransferCmdBufferManager->GetQueue();
+	FVulkanQueue* graphicsQueue = InGraphicsCmdBuffer->GetOwner()->GetQueue();
+	uint32_t srcFamily = transferQueue->GetFamilyIndex();
+	uint32_t dstFamily = graphicsQueue->GetFamilyIndex();
+	const bool bOwnershipTransfer = srcFamily != dstFamily;
+	if (!bOwnershipTransfer) {
+		srcFamily = VK_QUEUE_FAMILY_IGNORED;
+		dstFamily = VK_QUEUE_FAMILY_IGNORED;
+	}
+
+	// Nothing orders the copy after earlier draws on the other queue, so wait until the last one sampling the old contents is done
+	if (!graphicsQueue->IsSerialCompleted(m_LastSampledSerial)) {
+		graphicsQueue->WaitForSerial(m_LastSampledSerial);
+	}
+
+	FVulkanCommandBuffer* cmdBuffer = InTransferCmdBufferManager->GetNewCommandBuffer();
+
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	StageUploadData(cmdBuffer, InSrcData, dataSize, bpp, stagingHandle, stagingOffset);
+
+	cmdBuffer->Begin();
+
+	// With mips the image stays a transfer destination, the graphics queue fills the chain after the acquire
+	const bool bGenerateMips = m_MipLevels > 1;
+	const VkImageLayout handoverLayout = bGenerateMips ? VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL : VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	// Generate() starts with a barrier on the transfer stage, the acquire has to happen before it
+	const VkPipelineStageFlags acquireStage = bGenerateMips ? VK_PIPELINE_STAGE_TRANSFER_BIT : VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT;
+	const VkAccessFlags acquireAccess = bGenerateMips ? VK_ACCESS_TRANSFER_READ_BIT | VK_ACCESS_TRANSFER_WRITE_BIT : VK_ACCESS_SHADER_READ_BIT;
+
+	// Everything is overwritten, so the old contents are discarded instead of being handed back from graphics
+	TransitionImageLayout(cmdBuffer, m_TextureImage, m_MipLevels, 1, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	CopyBufferToImage(cmdBuffer, stagingHandle, stagingOffset, m_TextureImage, VkExtent3D{ m_Width , m_Height ,1 }, 1);
+	TransferImageOwnership(cmdBuffer, m_TextureImage, m_MipLevels, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, handoverLayout, srcFamily, dstFamily, true);
+
+	cmdBuffer->End();
+	cmdBuffer->AddSignalSemaphore(InUploadDone);
+	transferQueue->Submit(cmdBuffer);
+
+	// Vertex work of the graphics submission can still overlap with the copy, unless mips are generated first
+	InGraphicsCmdBuffer->AddWaitSemaphore(acquireStage, InUploadDone);
+	if (bOwnershipTransfer) {
+		TransferImageOwnership(InGraphicsCmdBuffer, m_TextureImage, m_MipLevels, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, handoverLayout, srcFamily, dstFamily, false, acquireStage, acquireAccess);
+	}
+	else {
+		// Within one family the release barrier was the layout transition, the semaphore wait makes the copy visible
+		const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, m_MipLevels, 0, 1 };
+		const FVulkanImageStateTracker::FState state = { handoverLayout, acquireStage, acquireAccess };
+		InGraphicsCmdBuffer->GetImageStates().SetState(m_TextureImage, range, state);
+	}
+	if (bGenerateMips) {
+		m_Device->GetMipGenerator()->Generate(InGraphicsCmdBuffer, m_MipChain);
+	}
+	m_CurrentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+void FVulkanTexture2D::UpdateRegions(const void * InSrcData, uint32_t InSrcPitch, const VkRect2D * InRects, uint32_t InNumRects, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	const uint32_t bpp = GetBppFromFormat(m_Format);
+	if (bpp == 0) return;
+
+	// Offsets of image copies have to be a multiple of both 4 and the texel size
+	VkDeviceSize alignment = bpp;
+	while (alignment % 4) alignment += bpp;
+
+	// Clipped to the texture
+	struct FClippedRect
+	{
+		int64_t X0, Y0, X1, Y1;
+	};
+	std::vector<FClippedRect> rects;
+	rects.reserve(InNumRects);
+	for (uint32_t i = 0; i < InNumRects; i++)
+	{
+		FClippedRect rect;
+		rect.X0 = std::max(InRects[i].offset.x, 0);
+		rect.Y0 = std::max(InRects[i].offset.y, 0);
+		rect.X1 = std::min<int64_t>((int64_t)InRects[i].offset.x + InRects[i].extent.width, m_Width);
+		rect.Y1 = std::min<int64_t>((int64_t)InRects[i].offset.y + InRects[i].extent.height, m_Height);
+		if (rect.X1 > rect.X0 && rect.Y1 > rect.Y0) {
+			rects.push_back(rect);
+		}
+	}
+
+	// The regions of one copy must not overlap. Overlapping rectangles are merged into their bounding
+	// rectangle, which can overlap others again, until none are left. All of them read the same frame.
+	for (bool bMerged = true; bMerged;)
+	{
+		bMerged = false;
+		for (size_t i = 0; i < rects.size(); i++)
+		{
+			for (size_t j = i + 1; j < rects.size();)
+			{
+				if (rects[i].X0 < rects[j].X1 && rects[j].X0 < rects[i].X1 && rects[i].Y0 < rects[j].Y1 && rects[j].Y0 < rects[i].Y1) {
+					rects[i].X0 = std::min(rects[i].X0, rects[j].X0);
+					rects[i].Y0 = std::min(rects[i].Y0, rects[j].Y0);
+					rects[i].X1 = std::max(rects[i].X1, rects[j].X1);
+					rects[i].Y1 = std::max(rects[i].Y1, rects[j].Y1);
+					rects[j] = rects.back();
+					rects.pop_back();
+					bMerged = true;
+				}
+				else {
+					j++;
+				}
+			}
+		}
+	}
+
+	// Each region packed tightly behind the previous one
+	std::vector<VkBufferImageCopy> regions;
+	regions.reserve(rects.size());
+	VkDeviceSize stagingSize = 0;
+	for (const auto& rect : rects)
+	{
+		VkBufferImageCopy region = {};
+		region.bufferOffset = stagingSize;
+		region.bufferRowLength = static_cast<uint32_t>(rect.X1 - rect.X0);
+		region.bufferImageHeight = static_cast<uint32_t>(rect.Y1 - rect.Y0);
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+		region.imageOffset = { static_cast<int32_t>(rect.X0), static_cast<int32_t>(rect.Y0), 0 };
+		region.imageExtent = { region.bufferRowLength, region.bufferImageHeight, 1 };
+		regions.push_back(region);
+
+		const VkDeviceSize regionSize = (VkDeviceSize)region.bufferRowLength * region.bufferImageHeight * bpp;
+		stagingSize += (regionSize + alignment - 1) / alignment * alignment;
+	}
+	if (regions.empty()) return;
+
+	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
+
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	uint8_t* mappedData = static_cast<uint8_t*>(AllocateUploadData(cmdBuffer, stagingSize, bpp, stagingHandle, stagingOffset));
+
+	// Only the rows of the changed regions are copied out of the source frame
+	const uint8_t* srcData = static_cast<const uint8_t*>(InSrcData);
+	for (auto& region : regions)
+	{
+		const size_t rowSize = (size_t)region.bufferRowLength * bpp;
+		for (uint32_t row = 0; row < region.bufferImageHeight; row++)
+		{
+			const size_t srcOffset = (size_t)(region.imageOffset.y + row) * InSrcPitch + (size_t)region.imageOffset.x * bpp;
+			memcpy(mappedData + region.bufferOffset + row * rowSize, srcData + srcOffset, rowSize);
+		}
+		region.bufferOffset += stagingOffset;
+	}
+
+	cmdBuffer->Begin();
+	RecordUpload(cmdBuffer, stagingHandle, regions.data(), static_cast<uint32_t>(regions.size()));
+	cmdBuffer->End();
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
+}
+
+bool FVulkanTexture2D::UpdateChangedTiles(const void * InSrcData, uint32_t InSrcPitch, FVulkanTileDiff & InTileDiff, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	if (!InTileDiff.Diff(InSrcData, InSrcPitch, m_ChangedTiles)) return false;
+
+	UpdateRegions(InSrcData, InSrcPitch, m_ChangedTiles.data(), static_cast<uint32_t>(m_ChangedTiles.size()), InCmdBufferManager, InBatch);
+	return true;
+}
+
+void FVulkanTexture2D::RecordUpload(FVulkanCommandBuffer * InCmdBuffer, VkBuffer InStagingBuffer, VkDeviceSize InStagingOffset, uint32_t InWidth, uint32_t InHeight)
+{
+	VkBufferImageCopy region = {};
+	region.bufferOffset = InStagingOffset;
+	region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+	region.imageOffset = { 0, 0, 0 };
+	region.imageExtent = { InWidth, InHeight, 1 };
+
+	RecordUpload(InCmdBuffer, InStagingBuffer, &region, 1);
+}
+
+void FVulkanTexture2D::RecordUpload(FVulkanCommandBuffer * InCmdBuffer, VkBuffer InStagingBuffer, const VkBufferImageCopy * InRegions, uint32_t InNumRegions)
+{
+	// Layouts are per subresource, so level 0 is transitioned as a whole. Its other texels keep their contents.
+	TransitionImageLayout(InCmdBuffer, m_TextureImage, m_MipLevels, 1, m_CurrentLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	InCmdBuffer->GetImageStates().Flush();
+	vkCmdCopyBufferToImage(InCmdBuffer->GetHandle(), InStagingBuffer, m_TextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, InNumRegions, InRegions);
+
+	// Generate() ends with every level in SHADER_READ_ONLY_OPTIMAL
+	if (m_MipLevels > 1) {
+		m_Device->GetMipGenerator()->Generate(InCmdBuffer, m_MipChain);
+	}
+	else {
+		TransitionImageLayout(InCmdBuffer, m_TextureImage, 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	}
+	m_CurrentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+}
+
+FVulkanTexture2DArray::FVulkanTexture2DArray(const FVulkanDevice * InDevice, uint32_t InWidth, uint32_t InHeight, uint32_t InLayers, VkFormat InFormat)
+	:FVulkanTexture(InDevice), m_Width(InWidth), m_Height(InHeight), m_Layers(InLayers), m_Format(InFormat), m_CurrentLayout(VK_IMAGE_LAYOUT_UNDEFINED)
+{
+	if (GetBppFromFormat(m_Format) == 0) {
+		throw std::runtime_error("failed to create texture array, format has no texel size!");
+	}
+
+	VkPhysicalDeviceProperties properties;
+	vkGetPhysicalDeviceProperties(m_Device->GetPhysicalDevice(), &properties);
+	if (m_Layers == 0 || m_Layers > properties.limits.maxImageArrayLayers) {
+		throw std::runtime_error("failed to create texture array, unsupported layer count!");
+	}
+
+	CreateTexture(VK_IMAGE_TYPE_2D, m_Format, VkExtent3D{ m_Width,m_Height,1 },
+		1, m_Layers, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_TextureImage, m_TextureAllocation);
+	CreateImageView(m_TextureImage, VK_IMAGE_VIEW_TYPE_2D_ARRAY, m_Format, 1, m_Layers, m_TextureImageView);
+	CreateTextureSampler(m_TextureSampler);
+}
+
+FVulkanTexture2DArray::~FVulkanTexture2DArray()
+{
+	DestoryTexture();
+}
+
+void FVulkanTexture2DArray::UpdateLayer(uint32_t InLayer, const void * InSrcData, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	FVulkanTextureArrayUpload upload;
+	upload.Layer = InLayer;
+	upload.Rect = { { 0, 0 }, { m_Width, m_Height } };
+	upload.SrcData = InSrcData;
+	upload.SrcPitch = m_Width * GetBppFromFormat(m_Format);
+	UpdateRegions(&upload, 1, InCmdBufferManager, InBatch);
+}
+
+void FVulkanTexture2DArray::UpdateRegions(const FVulkanTextureArrayUpload * InUploads, uint32_t InNumUploads, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	const uint32_t bpp = GetBppFromFormat(m_Format);
+
+	VkDeviceSize alignment = bpp;
+	while (alignment % 4) alignment += bpp;
+
+	// Packed like FVulkanTexture2D::UpdateRegions, each source is read from its clipped origin
+	std::vector<VkBufferImageCopy> regions;
+	std::vector<std::pair<const uint8_t*, uint32_t>> sources;
+	// Regions of one copy must not overlap, a region overlapping one of the current copy starts the next
+	std::vector<size_t> copyStarts(1, 0);
+	regions.reserve(InNumUploads);
+	sources.reserve(InNumUploads);
+	VkDeviceSize stagingSize = 0;
+	uint32_t minLayer = m_Layers;
+	uint32_t maxLayer = 0;
+	for (uint32_t i = 0; i < InNumUploads; i++)
+	{
+		const FVulkanTextureArrayUpload& upload = InUploads[i];
+		if (upload.Layer >= m_Layers) continue;
+
+		const int32_t x0 = std::max(upload.Rect.offset.x, 0);
+		const int32_t y0 = std::max(upload.Rect.offset.y, 0);
+		const int64_t x1 = std::min<int64_t>((int64_t)upload.Rect.offset.x + upload.Rect.extent.width, m_Width);
+		const int64_t y1 = std::min<int64_t>((int64_t)upload.Rect.offset.y + upload.Rect.extent.height, m_Height);
+		if (x1 <= x0 || y1 <= y0) continue;
+
+		VkBufferImageCopy region = {};
+		region.bufferOffset = stagingSize;
+		region.bufferRowLength = static_cast<uint32_t>(x1 - x0);
+		region.bufferImageHeight = static_cast<uint32_t>(y1 - y0);
+		region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, upload.Layer, 1 };
+		region.imageOffset = { x0, y0, 0 };
+		region.imageExtent = { region.bufferRowLength, region.bufferImageHeight, 1 };
+		for (size_t j = copyStarts.back(); j < regions.size(); j++)
+		{
+			const VkBufferImageCopy& other = regions[j];
+			if (other.imageSubresource.baseArrayLayer == upload.Layer &&
+				other.imageOffset.x < x1 && x0 < (int64_t)other.imageOffset.x + other.imageExtent.width &&
+				other.imageOffset.y < y1 && y0 < (int64_t)other.imageOffset.y + other.imageExtent.height) {
+				copyStarts.push_back(regions.size());
+				break;
+			}
+		}
+		regions.push_back(region);
+
+		const uint8_t* srcOrigin = static_cast<const uint8_t*>(upload.SrcData) + (size_t)(y0 - upload.Rect.offset.y) * upload.SrcPitch + (size_t)(x0 - upload.Rect.offset.x) * bpp;
+		sources.push_back(std::make_pair(srcOrigin, upload.SrcPitch));
+		minLayer = std::min(minLayer, upload.Layer);
+		maxLayer = std::max(maxLayer, upload.Layer);
+
+		const VkDeviceSize regionSize = (VkDeviceSize)region.bufferRowLength * region.bufferImageHeight * bpp;
+		stagingSize += (regionSize + alignment - 1) / alignment * alignment;
+	}
+	if (regions.empty()) return;
+
+	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
+
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	uint8_t* mappedData = static_cast<uint8_t*>(AllocateUploadData(cmdBuffer, stagingSize, bpp, stagingHandle, stagingOffset));
+
+	for (size_t i = 0; i < regions.size(); i++)
+	{
+		VkBufferImageCopy& region = regions[i];
+		const size_t rowSize = (size_t)region.bufferRowLength * bpp;
+		for (uint32_t row = 0; row < region.bufferImageHeight; row++)
+		{
+			memcpy(mappedData + region.bufferOffset + row * rowSize, sources[i].first + (size_t)row * sources[i].second, rowSize);
+		}
+		region.bufferOffset += stagingOffset;
+	}
+
+	cmdBuffer->Begin();
+
+	// The first upload clears every layer, so whatever is never uploaded (atlas padding included) samples as 0.
+	// Later ones only transition the layers they touch and those between, the rest can be sampled meanwhile.
+	uint32_t baseLayer = minLayer;
+	uint32_t numLayers = maxLayer - minLayer + 1;
+	if (m_CurrentLayout == VK_IMAGE_LAYOUT_UNDEFINED) {
+		baseLayer = 0;
+		numLayers = m_Layers;
+		TransitionImageLayout(cmdBuffer, m_TextureImage, 1, m_Layers, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+		cmdBuffer->GetImageStates().Flush();
+
+		const VkClearColorValue clearColor = {};
+		const VkImageSubresourceRange range = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 1, 0, m_Layers };
+		vkCmdClearColorImage(cmdBuffer->GetHandle(), m_TextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, &clearColor, 1, &range);
+
+		// The copy overwrites parts of the clear, write after write in the same layout
+		TransitionImageLayout(cmdBuffer, m_TextureImage, 1, numLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	}
+	else {
+		TransitionImageLayout(cmdBuffer, m_TextureImage, 1, numLayers, m_CurrentLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, baseLayer);
+	}
+
+	copyStarts.push_back(regions.size());
+	for (size_t i = 0; i + 1 < copyStarts.size(); i++)
+	{
+		if (i > 0) {
+			// The later copy overwrites parts of the earlier one
+			TransitionImageLayout(cmdBuffer, m_TextureImage, 1, numLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, baseLayer);
+		}
+		cmdBuffer->GetImageStates().Flush();
+		vkCmdCopyBufferToImage(cmdBuffer->GetHandle(), stagingHandle, m_TextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL,
+			static_cast<uint32_t>(copyStarts[i + 1] - copyStarts[i]), regions.data() + copyStarts[i]);
+	}
+	TransitionImageLayout(cmdBuffer, m_TextureImage, 1, numLayers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, baseLayer);
+	m_CurrentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	cmdBuffer->End();
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
+}
+
+
+FVulkanCompressedTexture2D::FVulkanCompressedTexture2D(const FVulkanDevice * InDevice, const FVulkanTextureData & InData, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+	:FVulkanTexture(InDevice), m_Width(InData.Width), m_Height(InData.Height), m_Layers(InData.Layers),
+	m_MipLevels(static_cast<uint32_t>(InData.Levels.size())), m_Format(InData.Format)
+{
+	if (m_MipLevels == 0) {
+		throw std::runtime_error("failed to create compressed texture, no levels!");
+	}
+	if (!IsFormatSupported(m_Device, m_Format)) {
+		throw std::runtime_error("failed to create compressed texture, format not supported by the device!");
+	}
+
+	CreateTexture(VK_IMAGE_TYPE_2D, m_Format, VkExtent3D{ m_Width,m_Height,1 },
+		m_MipLevels, m_Layers, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_TextureImage, m_TextureAllocation);
+	CreateImageView(m_TextureImage, m_Layers > 1 ? VK_IMAGE_VIEW_TYPE_2D_ARRAY : VK_IMAGE_VIEW_TYPE_2D, m_Format, m_MipLevels, m_Layers, m_TextureImageView);
+	CreateTextureSampler(m_TextureSampler, static_cast<float>(m_MipLevels - 1), m_MipLevels > 1 ? EVulkanSamplerQuality::Anisotropic : EVulkanSamplerQuality::Linear);
+
+	// Every level goes into one staging allocation, each starting on a whole block
+	const uint32_t bytesPerBlock = GetVulkanFormatInfo(m_Format).BytesPerBlock;
+	VkDeviceSize alignment = bytesPerBlock;
+	while (alignment % 4) alignment += bytesPerBlock;
+
+	std::vector<VkDeviceSize> levelOffsets(m_MipLevels);
+	VkDeviceSize stagingSize = 0;
+	for (uint32_t level = 0; level < m_MipLevels; level++)
+	{
+		levelOffsets[level] = stagingSize;
+		stagingSize += (InData.Levels[level].Size + alignment - 1) / alignment * alignment;
+	}
+
+	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
+
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	uint8_t* mappedData = static_cast<uint8_t*>(AllocateUploadData(cmdBuffer, stagingSize, bytesPerBlock, stagingHandle, stagingOffset));
+	for (uint32_t level = 0; level < m_MipLevels; level++)
+	{
+		memcpy(mappedData + levelOffsets[level], InData.Data.data() + InData.Levels[level].Offset, (size_t)InData.Levels[level].Size);
+		levelOffsets[level] += stagingOffset;
+	}
+
+	cmdBuffer->Begin();
+
+	TransitionImageLayout(cmdBuffer, m_TextureImage, m_MipLevels, m_Layers, VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	CopyBufferToImageLevels(cmdBuffer, stagingHandle, levelOffsets.data(), m_TextureImage, m_Format, VkExtent3D{ m_Width, m_Height, 1 }, m_MipLevels, m_Layers);
+	TransitionImageLayout(cmdBuffer, m_TextureImage, m_MipLevels, m_Layers, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+
+	cmdBuffer->End();
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
+}
+
+FVulkanCompressedTexture2D::~FVulkanCompressedTexture2D()
+{
+	DestoryTexture();
+}
+
+bool FVulkanCompressedTexture2D::IsFormatSupported(const FVulkanDevice * InDevice, VkFormat InFormat)
+{
+	if (GetVulkanFormatInfo(InFormat).BytesPerBlock == 0) return false;
+
+	VkFormatProperties props;
+	vkGetPhysicalDeviceFormatProperties(InDevice->GetPhysicalDevice(), InFormat, &props);
+
+	const VkFormatFeatureFlags required = VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT | VK_FORMAT_FEATURE_SAMPLED_IMAGE_FILTER_LINEAR_BIT;
+	return (props.optimalTilingFeatures & required) == required;
+}
+
+
+FVulkanStreamingTexture2D::FVulkanStreamingTexture2D(const FVulkanDevice * InDevice, uint32_t InWidth, uint32_t InHeight, VkFormat InFormat, uint32_t InNumBuffers)
+	:FVulkanTexture(InDevice), m_Width(InWidth), m_Height(InHeight), m_Format(InFormat), m_CurrentIndex(0), m_bHasData(false)
+{
+	m_Buffers.resize(InNumBuffers > 1 ? InNumBuffers : 2);
+	for (size_t i = 0; i < m_Buffers.size(); i++) {
+		FBuffer& buffer = m_Buffers[i];
+		CreateTexture(VK_IMAGE_TYPE_2D, m_Format, VkExtent3D{ m_Width,m_Height,1 },
+			1, 1, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+			buffer.Image, buffer.Allocation);
+		CreateImageView(buffer.Image, VK_IMAGE_VIEW_TYPE_2D, m_Format, 1, 1, buffer.View);
+		buffer.Layout = VK_IMAGE_LAYOUT_UNDEFINED;
+		buffer.ReplacedBy = nullptr;
+		buffer.ReplacedPrevSerial = 0;
+	}
+	CreateTextureSampler(m_TextureSampler);
+
+	m_TextureImage = m_Buffers[0].Image;
+	m_TextureImageView = m_Buffers[0].View;
+	m_TextureAllocation = m_Buffers[0].Allocation;
+}
+
+FVulkanStreamingTexture2D::~FVulkanStreamingTexture2D()
+{
+	m_Device->GetSamplerCache()->Release(m_TextureSampler);
+	for (size_t i = 0; i < m_Buffers.size(); i++) {
+		vkDestroyImageView(m_Device->GetLogicalDevice(), m_Buffers[i].View, nullptr);
+		vkDestroyImage(m_Device->GetLogicalDevice(), m_Buffers[i].Image, nullptr);
+		m_Device->GetMemoryManager()->Free(m_Buffers[i].Allocation);
+	}
+}
+
+void FVulkanStreamingTexture2D::UpdateFromData(const void * InSrcData, FVulkanCommandBuffer * InCmdBuffer)
+{
+	if (!InCmdBuffer->HasBegun()) return;
+
+	const uint32_t bpp = GetBppFromFormat(m_Format);
+	const VkDeviceSize dataSize = (VkDeviceSize)m_Width * m_Height * bpp;
+
+	const uint32_t nextIndex = m_bHasData ? (m_CurrentIndex + 1) % GetNumBuffers() : m_CurrentIndex;
+	FBuffer& buffer = m_Buffers[nextIndex];
+
+	VkBuffer stagingHandle;
+	VkDeviceSize stagingOffset;
+	StageUploadData(InCmdBuffer, InSrcData, dataSize, bpp, stagingHandle, stagingOffset);
+
+	// Once every draw sampling this image has completed the old contents are simply discarded,
+	// nothing orders the copy after rendering. Otherwise the barrier waits for those reads.
+	const VkImageLayout oldLayout = IsNoLongerSampled(buffer) ? VK_IMAGE_LAYOUT_UNDEFINED : buffer.Layout;
+	TransitionImageLayout(InCmdBuffer, buffer.Image, 1, 1, oldLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	CopyBufferToImage(InCmdBuffer, stagingHandle, stagingOffset, buffer.Image, VkExtent3D{ m_Width , m_Height ,1 }, 1);
+	TransitionImageLayout(InCmdBuffer, buffer.Image, 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	buffer.Layout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	if (nextIndex != m_CurrentIndex) {
+		FBuffer& previous = m_Buffers[m_CurrentIndex];
+		previous.ReplacedBy = InCmdBuffer;
+		previous.ReplacedPrevSerial = InCmdBuffer->GetSubmittedSerial();
+	}
+
+	m_CurrentIndex = nextIndex;
+	m_bHasData = true;
+	m_TextureImage = buffer.Image;
+	m_TextureImageView = buffer.View;
+	m_TextureAllocation = buffer.Allocation;
+}
+
+VkDescriptorImageInfo FVulkanStreamingTexture2D::GetDescriptorImageInfo(uint32_t InIndex) const
+{
+	VkDescriptorImageInfo imageInfo = {};
+	imageInfo.sampler = m_TextureSampler;
+	imageInfo.imageView = m_Buffers[InIndex].View;
+	imageInfo.imageLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+	return imageInfo;
+}
+
+bool FVulkanStreamingTexture2D::IsNoLongerSampled(const FBuffer & InBuffer) const
+{
+	if (InBuffer.Layout == VK_IMAGE_LAYOUT_UNDEFINED) return true;
+	if (InBuffer.ReplacedBy == nullptr) return false;
+
+	// Same rule as the staging ring: the replacing command buffer has been submitted again and that completed
+	const uint64_t serial = InBuffer.ReplacedBy->GetSubmittedSerial();
+	if (serial == InBuffer.ReplacedPrevSerial) return false;
+
+	FVulkanQueue* queue = InBuffer.ReplacedBy->GetOwner()->GetQueue();
+	if (!queue->IsSerialCompleted(serial)) {
+		queue->RefreshFenceStatus();
+	}
+	return queue->IsSerialCompleted(serial);
+}
+
+
+FVulkanYcbcrTexture2D::FVulkanYcbcrTexture2D(const FVulkanDevice * InDevice, uint32_t InWidth, uint32_t InHeight, EVulkanYcbcrFormat InFormat,
+	VkSamplerYcbcrModelConversion InModel, VkSamplerYcbcrRange InRange)
+	:FVulkanTexture(InDevice), m_Width(InWidth), m_Height(InHeight), m_Format(GetVkFormat(InFormat)), m_Conversion(VK_NULL_HANDLE), m_DescriptorCost(1), m_CurrentLayout(VK_IMAGE_LAYOUT_UNDEFINED)
+{
+	if (!m_Device->IsYcbcrConversionSupported()) {
+		throw std::runtime_error("failed to create ycbcr texture, sampler ycbcr conversion is not supported!");
+	}
+	// 4:2:0 formats need even extents
+	if ((m_Width & 1) || (m_Height & 1)) {
+		throw std::invalid_argument("ycbcr texture extent has to be even!");
+	}
+
+	const uint32_t chromaWidth = m_Width / 2;
+	const uint32_t chromaHeight = m_Height / 2;
+	switch (InFormat)
+	{
+	case EVulkanYcbcrFormat::NV12:
+		m_NumPlanes = 2;
+		m_Planes[0] = { m_Width, m_Height, 1 };
+		m_Planes[1] = { chromaWidth, chromaHeight, 2 };
+		break;
+	case EVulkanYcbcrFormat::I420:
+		m_NumPlanes = 3;
+		m_Planes[0] = { m_Width, m_Height, 1 };
+		m_Planes[1] = { chromaWidth, chromaHeight, 1 };
+		m_Planes[2] = { chromaWidth, chromaHeight, 1 };
+		break;
+	case EVulkanYcbcrFormat::P010:
+		m_NumPlanes = 2;
+		m_Planes[0] = { m_Width, m_Height, 2 };
+		m_Planes[1] = { chromaWidth, chromaHeight, 4 };
+		break;
+	default:
+		throw std::invalid_argument("unsupported ycbcr format!");
+	}
+
+	VkFormatProperties formatProperties;
+	vkGetPhysicalDeviceFormatProperties(m_Device->GetPhysicalDevice(), m_Format, &formatProperties);
+	const VkFormatFeatureFlags features = formatProperties.optimalTilingFeatures;
+	if (!(features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) ||
+		!(features & (VK_FORMAT_FEATURE_COSITED_CHROMA_SAMPLES_BIT | VK_FORMAT_FEATURE_MIDPOINT_CHROMA_SAMPLES_BIT))) {
+		throw std::runtime_error("failed to create ycbcr texture, format is not supported!");
+	}
+
+	// Video chroma is co-sited horizontally with the luma, midpoint is what every implementation may offer instead
+	VkChromaLocation chromaLocation = (features & VK_FORMAT_FEATURE_COSITED_CHROMA_SAMPLES_BIT) ? VK_CHROMA_LOCATION_COSITED_EVEN : VK_CHROMA_LOCATION_MIDPOINT;
+	VkFilter filter = (features & VK_FORMAT_FEATURE_SAMPLED_IMAGE_YCBCR_CONVERSION_LINEAR_FILTER_BIT) ? VK_FILTER_LINEAR : VK_FILTER_NEAREST;
+
+	VkSamplerYcbcrConversionCreateInfo conversionInfo = {};
+	conversionInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_CREATE_INFO;
+	conversionInfo.format = m_Format;
+	conversionInfo.ycbcrModel = InModel;
+	conversionInfo.ycbcrRange = InRange;
+	conversionInfo.components = { VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY, VK_COMPONENT_SWIZZLE_IDENTITY };
+	conversionInfo.xChromaOffset = chromaLocation;
+	conversionInfo.yChromaOffset = VK_CHROMA_LOCATION_MIDPOINT;
+	if (!(features & VK_FORMAT_FEATURE_MIDPOINT_CHROMA_SAMPLES_BIT)) {
+		conversionInfo.yChromaOffset = VK_CHROMA_LOCATION_COSITED_EVEN;
+	}
+	conversionInfo.chromaFilter = filter;
+	conversionInfo.forceExplicitReconstruction = VK_FALSE;
+
+	if (vkCreateSamplerYcbcrConversion(m_Device->GetLogicalDevice(), &conversionInfo, nullptr, &m_Conversion) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create sampler ycbcr conversion!");
+	}
+
+	VkSamplerYcbcrConversionInfo conversionBinding = {};
+	conversionBinding.sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_INFO;
+	conversionBinding.conversion = m_Conversion;
+
+	CreateTexture(VK_IMAGE_TYPE_2D, m_Format, VkExtent3D{ m_Width,m_Height,1 },
+		1, 1, VK_IMAGE_TILING_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT, VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT,
+		m_TextureImage, m_TextureAllocation);
+
+	// View and sampler both have to name the conversion
+	VkImageViewCreateInfo viewInfo = {};
+	viewInfo.sType = VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO;
+	viewInfo.pNext = &conversionBinding;
+	viewInfo.image = m_TextureImage;
+	viewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+	viewInfo.format = m_Format;
+	viewInfo.subresourceRange.aspectMask = VK_IMAGE_ASPECT_COLOR_BIT;
+	viewInfo.subresourceRange.levelCount = 1;
+	viewInfo.subresourceRange.layerCount = 1;
+
+	if (vkCreateImageView(m_Device->GetLogicalDevice(), &viewInfo, nullptr, &m_TextureImageView) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create texture image view!");
+	}
+
+	// Without separate reconstruction filters min and mag filter must match the chroma filter
+	VkSamplerCreateInfo samplerInfo = {};
+	samplerInfo.sType = VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO;
+	samplerInfo.pNext = &conversionBinding;
+	samplerInfo.magFilter = filter;
+	samplerInfo.minFilter = filter;
+	samplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_NEAREST;
+	samplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_CLAMP_TO_EDGE;
+	samplerInfo.anisotropyEnable = VK_FALSE;
+	samplerInfo.maxAnisotropy = 1.0f;
+	samplerInfo.borderColor = VK_BORDER_COLOR_INT_OPAQUE_BLACK;
+	samplerInfo.unnormalizedCoordinates = VK_FALSE;
+	samplerInfo.compareEnable = VK_FALSE;
+	samplerInfo.compareOp = VK_COMPARE_OP_ALWAYS;
+
+	if (vkCreateSampler(m_Device->GetLogicalDevice(), &samplerInfo, nullptr, &m_TextureSampler) != VK_SUCCESS) {
+		throw std::runtime_error("failed to create texture sampler!");
+	}
+
+	VkSamplerYcbcrConversionImageFormatProperties conversionProperties = {};
+	conversionProperties.sType = VK_STRUCTURE_TYPE_SAMPLER_YCBCR_CONVERSION_IMAGE_FORMAT_PROPERTIES;
+	VkImageFormatProperties2 imageFormatProperties = {};
+	imageFormatProperties.sType = VK_STRUCTURE_TYPE_IMAGE_FORMAT_PROPERTIES_2;
+	imageFormatProperties.pNext = &conversionProperties;
+
+	VkPhysicalDeviceImageFormatInfo2 imageFormatInfo = {};
+	imageFormatInfo.sType = VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_IMAGE_FORMAT_INFO_2;
+	imageFormatInfo.format = m_Format;
+	imageFormatInfo.type = VK_IMAGE_TYPE_2D;
+	imageFormatInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+	imageFormatInfo.usage = VK_IMAGE_USAGE_TRANSFER_DST_BIT | VK_IMAGE_USAGE_SAMPLED_BIT;
+
+	if (vkGetPhysicalDeviceImageFormatProperties2(m_Device->GetPhysicalDevice(), &imageFormatInfo, &imageFormatProperties) == VK_SUCCESS &&
+		conversionProperties.combinedImageSamplerDescriptorCount > 0) {
+		m_DescriptorCost = conversionProperties.combinedImageSamplerDescriptorCount;
+	}
+}
+
+FVulkanYcbcrTexture2D::~FVulkanYcbcrTexture2D()
+{
+	DestoryTexture();
+	vkDestroySamplerYcbcrConversion(m_Device->GetLogicalDevice(), m_Conversion, nullptr);
+}
+
+void FVulkanYcbcrTexture2D::UpdateFromPlanes(const void * const * InPlaneData, FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	static const VkImageAspectFlagBits planeAspects[MAX_PLANES] = { VK_IMAGE_ASPECT_PLANE_0_BIT, VK_IMAGE_ASPECT_PLANE_1_BIT, VK_IMAGE_ASPECT_PLANE_2_BIT };
+
+	FVulkanCommandBuffer* cmdBuffer = InCmdBufferManager->GetNewCommandBuffer();
+
+	// Each plane is staged on its own, the copy offsets have to be aligned to the plane's texel size
+	VkBufferImageCopy regions[MAX_PLANES] = {};
+	VkBuffer stagingHandles[MAX_PLANES];
+	for (uint32_t i = 0; i < m_NumPlanes; i++) {
+		StageUploadData(cmdBuffer, InPlaneData[i], GetPlaneSize(i), m_Planes[i].TexelSize, stagingHandles[i], regions[i].bufferOffset);
+
+		regions[i].imageSubresource.aspectMask = planeAspects[i];
+		regions[i].imageSubresource.mipLevel = 0;
+		regions[i].imageSubresource.baseArrayLayer = 0;
+		regions[i].imageSubresource.layerCount = 1;
+		regions[i].imageExtent = { m_Planes[i].Width, m_Planes[i].Height, 1 };
+	}
+
+	cmdBuffer->Begin();
+
+	TransitionImageLayout(cmdBuffer, m_TextureImage, 1, 1, m_CurrentLayout, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL);
+	cmdBuffer->GetImageStates().Flush();
+	for (uint32_t i = 0; i < m_NumPlanes; i++) {
+		vkCmdCopyBufferToImage(cmdBuffer->GetHandle(), stagingHandles[i], m_TextureImage, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &regions[i]);
+	}
+	TransitionImageLayout(cmdBuffer, m_TextureImage, 1, 1, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL);
+	m_CurrentLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+
+	cmdBuffer->End();
+	if (InBatch) {
+		InBatch->Add(cmdBuffer);
+	}
+	else {
+		InCmdBufferManager->GetQueue()->Submit(cmdBuffer);
+	}
+}
+
+VkDeviceSize FVulkanYcbcrTexture2D::GetPlaneSize(uint32_t InPlane) const
+{
+	const FPlane& plane = m_Planes[InPlane];
+	return (VkDeviceSize)plane.Width * plane.Height * plane.TexelSize;
+}
+
+VkFormat FVulkanYcbcrTexture2D::GetVkFormat(EVulkanYcbcrFormat InFormat)
+{
+	switch (InFormat)
+	{
+	case EVulkanYcbcrFormat::NV12:
+		return VK_FORMAT_G8_B8R8_2PLANE_420_UNORM;
+	case EVulkanYcbcrFormat::I420:
+		return VK_FORMAT_G8_B8_R8_3PLANE_420_UNORM;
+	case EVulkanYcbcrFormat::P010:
+		return VK_FORMAT_G10X6_B10X6R10X6_2PLANE_420_UNORM_3PACK16;
+	default:
+		return VK_FORMAT_UNDEFINED;
+	}
+}
+
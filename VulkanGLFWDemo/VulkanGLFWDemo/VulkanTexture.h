@@ -1,9 +1,19 @@
 #pragma once
+#include <algorithm>
+#include <vector>
 #include <vulkan/vulkan.h>
+#include "VulkanMemory.h"
+#include "VulkanMipGenerator.h"
+#include "VulkanSamplerCache.h"
 
 class FVulkanDevice;
 class FVulkanCommandBuffer;
 class FVulkanCommandBufferManager;
+class FVulkanSubmitBatch;
+class FVulkanSemaphore;
+struct FVulkanTextureData;
+struct FVulkanPnmImage;
+class FVulkanTileDiff;
 
 class FVulkanTexture
 {
@@ -21,22 +31,46 @@ public:
 	}
 	inline VkDeviceMemory GetDeviceMemory() const
 	{
-		return m_TextureImageMemory;
+		return m_TextureAllocation.Memory;
 	}
 	inline VkSampler GetSampler() const
 	{
 		return m_TextureSampler;
 	}
 
+	// Swaps the sampler for a shared one of InQuality, descriptors written with the old one have to be updated
+	void SetSamplerQuality(EVulkanSamplerQuality InQuality);
+	inline EVulkanSamplerQuality GetSamplerQuality() const
+	{
+		return m_SamplerQuality;
+	}
+
 protected:
 	void CreateTexture(VkImageType imagetype, VkFormat format, VkExtent3D extent, 
 		uint32_t miplevels, uint32_t arraylayers, VkImageTiling tiling, VkImageUsageFlags usage, VkMemoryPropertyFlags properties,
-		VkImage& image, VkDeviceMemory& memory);
-	void CreateImageView(VkImage image, VkImageViewType viewtype, VkFormat format, uint32_t levels, uint32_t layers, VkImageView& view);
-	void CreateTextureSampler(VkSampler& sampler);
+		VkImage& image, FVulkanAllocation& allocation, bool dedicated = false, VkImageCreateFlags flags = 0);
+	// A non zero usage restricts what the view is used for, needed when the image has usages its format alone doesn't support
+	void CreateImageView(VkImage image, VkImageViewType viewtype, VkFormat format, uint32_t levels, uint32_t layers, VkImageView& view, VkImageUsageFlags usage = 0);
+	// maxLod above 0 lets the sampler reach into the mip chain. The sampler comes from the device's FVulkanSamplerCache.
+	void CreateTextureSampler(VkSampler& sampler, float maxLod = 0.0f, EVulkanSamplerQuality quality = EVulkanSamplerQuality::Linear);
+
+	void TransitionImageLayout(FVulkanCommandBuffer* InCmdBuffer, VkImage image, uint32_t levels, uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout, uint32_t baseLayer = 0);
+	void CopyBufferToImage(FVulkanCommandBuffer* InCmdBuffer, VkBuffer buffer, VkDeviceSize offset, VkImage image, VkExtent3D extent, uint32_t layers);
+	// One region per mip level in a single copy, levelOffsets[i] has to be a multiple of the format's block size and 4.
+	// Levels are tightly packed in whole blocks, partial blocks at the edges included.
+	void CopyBufferToImageLevels(FVulkanCommandBuffer* InCmdBuffer, VkBuffer buffer, const VkDeviceSize* levelOffsets, VkImage image, VkFormat format, VkExtent3D extent, uint32_t levels, uint32_t layers);
 
-	void TransitionImageLayout(FVulkanCommandBuffer* InCmdBuffer, VkImage image, uint32_t levels, uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout);
-	void CopyBufferToImage(FVulkanCommandBuffer* InCmdBuffer, VkBuffer buffer, VkImage image, VkExtent3D extent, uint32_t layers);
+	// Release (bRelease) or acquire half of a queue family ownership transfer, both sides use the same layouts.
+	// The acquire makes the image visible to acquireStage/acquireAccess.
+	void TransferImageOwnership(FVulkanCommandBuffer* InCmdBuffer, VkImage image, uint32_t levels, uint32_t layers, VkImageLayout oldLayout, VkImageLayout newLayout,
+		uint32_t srcFamily, uint32_t dstFamily, bool bRelease,
+		VkPipelineStageFlags acquireStage = VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT, VkAccessFlags acquireAccess = VK_ACCESS_SHADER_READ_BIT);
+
+	// Copies upload data into staging memory read by InCmdBuffer
+	void StageUploadData(FVulkanCommandBuffer* InCmdBuffer, const void* InSrcData, VkDeviceSize InSize, uint32_t InTexelSize, VkBuffer& OutBuffer, VkDeviceSize& OutOffset);
+	// Same, but returns the mapped staging memory for the caller to fill before InCmdBuffer is submitted.
+	// Comes from the device's staging ring, only uploads that don't fit in it get a staging buffer of their own.
+	void* AllocateUploadData(FVulkanCommandBuffer* InCmdBuffer, VkDeviceSize InSize, uint32_t InTexelSize, VkBuffer& OutBuffer, VkDeviceSize& OutOffset);
 
 	uint32_t GetBppFromFormat(VkFormat InFormat);
 	
@@ -44,9 +78,13 @@ protected:
 
 
 	VkImage m_TextureImage;
-	VkDeviceMemory m_TextureImageMemory;
+	FVulkanAllocation m_TextureAllocation;
 	VkImageView m_TextureImageView;
 	VkSampler m_TextureSampler;
+	// Only samplers from CreateTextureSampler() are shared, others (e.g. with a Ycbcr conversion) are the texture's own
+	bool m_bCachedSampler;
+	EVulkanSamplerQuality m_SamplerQuality;
+	float m_SamplerMaxLod;
 
 	const FVulkanDevice* m_Device;
 private:
@@ -57,10 +95,57 @@ private:
 class FVulkanTexture2D : public FVulkanTexture
 {
 public:
-	FVulkanTexture2D(const FVulkanDevice* InDevice, uint32_t InWidth, uint32_t InHeight, VkFormat InFormat);
+	// With bInGenerateMips every upload fills a full mip chain on the GPU, so minified draws don't sample
+	// level 0. Falls back to a single level when the format can neither be blitted nor downsampled by compute.
+	FVulkanTexture2D(const FVulkanDevice* InDevice, uint32_t InWidth, uint32_t InHeight, VkFormat InFormat, bool bInGenerateMips = false);
 	~FVulkanTexture2D();
 
-	void UpdateFromData(const void* InSrcData, uint32_t InWidth, uint32_t InHeight, FVulkanCommandBufferManager* InCmdBufferManager);
+	inline uint32_t GetMipLevels() const
+	{
+		return m_MipLevels;
+	}
+
+	// With a batch the upload is queued on it instead of being submitted right away
+	void UpdateFromData(const void* InSrcData, uint32_t InWidth, uint32_t InHeight, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Updates only InRects of level 0. InSrcData is a full frame of the texture's size with rows InSrcPitch bytes apart,
+	// just the rows of each rectangle are packed into staging and copied, one region per rectangle.
+	// Rectangles are clipped to the texture and overlapping ones merged into their bounding rectangle.
+	// Needs an uncompressed format, mips are regenerated as a whole.
+	void UpdateRegions(const void* InSrcData, uint32_t InSrcPitch, const VkRect2D* InRects, uint32_t InNumRects, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Uploads only the tiles of a full frame that InTileDiff finds changed, InTileDiff has to match the texture's
+	// size and texel size. Returns false without recording anything when the frame is identical to the last one,
+	// the caller can then skip drawing and presenting it too.
+	bool UpdateChangedTiles(const void* InSrcData, uint32_t InSrcPitch, FVulkanTileDiff& InTileDiff, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Replaces the whole texture from 24 bit RGB (or BGR) rows InSrcPitch bytes apart. The texture has to be
+	// 8 bit RGBA or BGRA, the pixels are expanded with FVulkanPixelConvert right into staging memory.
+	void UpdateFromRGB24(const void* InSrcData, uint32_t InSrcPitch, bool bInBGR, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Replaces the whole texture from a PPM/PAM image of the same size, e.g. still in its FVulkanMappedFile.
+	// RGB is expanded right into staging memory, RGBA is a single copy. The file can be closed once this returns.
+	void UpdateFromPnm(const FVulkanPnmImage& InImage, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Replaces the whole texture from the queue of InTransferCmdBufferManager (normally the transfer queue)
+	// and hands it over to the queue of InGraphicsCmdBuffer, which must have begun and be outside a render pass.
+	// InUploadDone is signaled by the upload and waited on by InGraphicsCmdBuffer.
+	// Only the last graphics submission reported with MarkSampled() is waited for on the CPU before the copy
+	// is submitted, other work on the graphics queue keeps running while the upload is in flight.
+	// Mips are generated by InGraphicsCmdBuffer, the transfer queue can't blit.
+	void UpdateFromDataAsync(const void* InSrcData, FVulkanCommandBufferManager* InTransferCmdBufferManager, FVulkanCommandBuffer* InGraphicsCmdBuffer, const FVulkanSemaphore* InUploadDone);
+
+	// Serial of a graphics queue submission that samples the texture, as returned by FVulkanQueue::Submit.
+	// UpdateFromDataAsync() lets it finish reading the old contents before overwriting them.
+	inline void MarkSampled(uint64_t InGraphicsSerial)
+	{
+		m_LastSampledSerial = std::max(m_LastSampledSerial, InGraphicsSerial);
+	}
+
+private:
+	// Copies level 0 from staging and leaves every level ready for sampling
+	void RecordUpload(FVulkanCommandBuffer* InCmdBuffer, VkBuffer InStagingBuffer, VkDeviceSize InStagingOffset, uint32_t InWidth, uint32_t InHeight);
+	void RecordUpload(FVulkanCommandBuffer* InCmdBuffer, VkBuffer InStagingBuffer, const VkBufferImageCopy* InRegions, uint32_t InNumRegions);
 
 private:
 	uint32_t m_Width;
@@ -68,6 +153,226 @@ private:
 	VkFormat m_Format;
 
 	VkImageLayout m_CurrentLayout;
-	
+	uint64_t m_LastSampledSerial;
+
+	uint32_t m_MipLevels;
+	FVulkanMipGenerator::FTarget m_MipChain;
+
+	// Kept between UpdateChangedTiles calls so streaming doesn't allocate every frame
+	std::vector<VkRect2D> m_ChangedTiles;
+
+};
+
+
+// Region of one layer of a FVulkanTexture2DArray and the pixels to write into it, rows InSrcPitch bytes apart
+struct FVulkanTextureArrayUpload
+{
+	uint32_t Layer;
+	VkRect2D Rect;
+	const void* SrcData;
+	uint32_t SrcPitch;
+};
+
+// Array of equally sized 2D layers behind one 2D_ARRAY view and sampler, sampled as a sampler2DArray
+// with the layer as third coordinate. Lets many small images share one descriptor, see FVulkanTextureAtlas.
+// Single level, uncompressed formats only. Layers nothing was uploaded to read as transparent black.
+class FVulkanTexture2DArray : public FVulkanTexture
+{
+public:
+	FVulkanTexture2DArray(const FVulkanDevice* InDevice, uint32_t InWidth, uint32_t InHeight, uint32_t InLayers, VkFormat InFormat);
+	~FVulkanTexture2DArray();
+
+	inline uint32_t GetWidth() const
+	{
+		return m_Width;
+	}
+	inline uint32_t GetHeight() const
+	{
+		return m_Height;
+	}
+	inline uint32_t GetLayers() const
+	{
+		return m_Layers;
+	}
+	inline VkFormat GetFormat() const
+	{
+		return m_Format;
+	}
+
+	// Replaces a whole layer from tightly packed rows
+	void UpdateLayer(uint32_t InLayer, const void* InSrcData, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Any number of regions across any layers go into one staging allocation and one copy.
+	// Rectangles are clipped to the layer, the rest of every layer keeps its contents.
+	// Where rectangles of a layer overlap the later one wins, it goes into a copy of its own after the earlier.
+	void UpdateRegions(const FVulkanTextureArrayUpload* InUploads, uint32_t InNumUploads, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Layers;
+	VkFormat m_Format;
+
+	// All layers share it between uploads, UNDEFINED until the first one
+	VkImageLayout m_CurrentLayout;
+};
+
+
+// Texture uploaded once with every mip level it comes with, e.g. from FVulkanKtx2Loader.
+// Block-compressed formats (BC, ETC2/EAC, ASTC) stay compressed in GPU memory, uncompressed ones work too.
+class FVulkanCompressedTexture2D : public FVulkanTexture
+{
+public:
+	// Throws when the device can't sample InData's format
+	FVulkanCompressedTexture2D(const FVulkanDevice* InDevice, const FVulkanTextureData& InData, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+	~FVulkanCompressedTexture2D();
+
+	inline VkFormat GetFormat() const
+	{
+		return m_Format;
+	}
+	inline uint32_t GetMipLevels() const
+	{
+		return m_MipLevels;
+	}
+
+	static bool IsFormatSupported(const FVulkanDevice* InDevice, VkFormat InFormat);
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_Layers;
+	uint32_t m_MipLevels;
+	VkFormat m_Format;
+};
+
+
+// 2D texture for content replaced every frame, e.g. video. Each upload writes the next of
+// InNumBuffers images while the previous one can still be sampled, and then becomes the image
+// GetImageView() returns. Bind the view of GetCurrentIndex() per frame, or bind all of them as an
+// array and index it. With more buffers than frames in flight no upload ever waits for rendering.
+class FVulkanStreamingTexture2D : public FVulkanTexture
+{
+public:
+	FVulkanStreamingTexture2D(const FVulkanDevice* InDevice, uint32_t InWidth, uint32_t InHeight, VkFormat InFormat, uint32_t InNumBuffers = 3);
+	~FVulkanStreamingTexture2D();
+
+	// Records the upload into InCmdBuffer, which must have begun, be outside a render pass and
+	// belong to the queue that samples the texture. Draws recorded after it see the new image.
+	void UpdateFromData(const void* InSrcData, FVulkanCommandBuffer* InCmdBuffer);
+
+	inline uint32_t GetNumBuffers() const
+	{
+		return static_cast<uint32_t>(m_Buffers.size());
+	}
+
+	// Image written by the last upload, the one to sample
+	inline uint32_t GetCurrentIndex() const
+	{
+		return m_CurrentIndex;
+	}
+
+	using FVulkanTexture::GetImageView;
+	inline VkImageView GetImageView(uint32_t InIndex) const
+	{
+		return m_Buffers[InIndex].View;
+	}
+
+	VkDescriptorImageInfo GetDescriptorImageInfo(uint32_t InIndex) const;
+
+private:
+	struct FBuffer
+	{
+		VkImage Image;
+		FVulkanAllocation Allocation;
+		VkImageView View;
+		VkImageLayout Layout;
+
+		// Upload that replaced this image as the current one, the last command buffer that can sample it
+		FVulkanCommandBuffer* ReplacedBy;
+		uint64_t ReplacedPrevSerial;
+	};
+
+	bool IsNoLongerSampled(const FBuffer& InBuffer) const;
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	VkFormat m_Format;
+
+	std::vector<FBuffer> m_Buffers;
+	uint32_t m_CurrentIndex;
+	bool m_bHasData;
+};
+
+
+// Planar video formats, sampled as RGB through a sampler Ycbcr conversion
+enum class EVulkanYcbcrFormat : uint8_t
+{
+	// 8 bit Y plane, interleaved 8 bit CbCr plane at half resolution
+	NV12,
+	// 8 bit Y, Cb and Cr planes, chroma at half resolution
+	I420,
+	// NV12 layout with 10 bit samples in the high bits of 16 bit words
+	P010,
+};
+
+// Multi-planar 4:2:0 texture, every plane is uploaded as it is so no CPU conversion to RGBA is needed.
+// The sampler carries the conversion and has to be an immutable sampler of the descriptor set layout:
+// add it with FVulkanDescriptorSetLayout::AddImmutableSamplerDescriptor(binding, GetDescriptorCost()).
+class FVulkanYcbcrTexture2D : public FVulkanTexture
+{
+public:
+	FVulkanYcbcrTexture2D(const FVulkanDevice* InDevice, uint32_t InWidth, uint32_t InHeight, EVulkanYcbcrFormat InFormat,
+		VkSamplerYcbcrModelConversion InModel = VK_SAMPLER_YCBCR_MODEL_CONVERSION_YCBCR_709, VkSamplerYcbcrRange InRange = VK_SAMPLER_YCBCR_RANGE_ITU_NARROW);
+	~FVulkanYcbcrTexture2D();
+
+	// InPlaneData holds one tightly packed plane per entry, GetNumPlanes() of them
+	void UpdateFromPlanes(const void* const* InPlaneData, FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	inline uint32_t GetNumPlanes() const
+	{
+		return m_NumPlanes;
+	}
+
+	VkDeviceSize GetPlaneSize(uint32_t InPlane) const;
+
+	inline const VkSampler* GetImmutableSampler() const
+	{
+		return &m_TextureSampler;
+	}
+
+	// Pool descriptors one combined image sampler of this texture takes
+	inline uint32_t GetDescriptorCost() const
+	{
+		return m_DescriptorCost;
+	}
+
+	static VkFormat GetVkFormat(EVulkanYcbcrFormat InFormat);
+
+private:
+	struct FPlane
+	{
+		uint32_t Width;
+		uint32_t Height;
+		uint32_t TexelSize;
+	};
+
+	enum : uint32_t
+	{
+		MAX_PLANES = 3,
+	};
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	VkFormat m_Format;
+
+	uint32_t m_NumPlanes;
+	FPlane m_Planes[MAX_PLANES];
+
+	VkSamplerYcbcrConversion m_Conversion;
+	uint32_t m_DescriptorCost;
+	VkImageLayout m_CurrentLayout;
+};
 
-};
\ No newline at end of file
@@ -0,0 +1,220 @@
+#include "VulkanTextureAtlas.h"
+#include "VulkanFormat.h"
+#include <algorithm>
+
+FVulkanTextureAtlas::FVulkanTextureAtlas(const FVulkanDevice * InDevice, uint32_t InPageWidth, uint32_t InPageHeight, uint32_t InPages, VkFormat InFormat, uint32_t InPadding)
+	:m_PageWidth(InPageWidth), m_PageHeight(InPageHeight), m_Padding(InPadding), m_NumSlots(0), m_UsedArea(0)
+{
+	m_Texture.reset(new FVulkanTexture2DArray(InDevice, InPageWidth, InPageHeight, InPages, InFormat));
+	m_BytesPerPixel = GetVulkanFormatInfo(InFormat).BytesPerBlock;
+
+	m_Pages.resize(InPages);
+	for (FPage& page : m_Pages) {
+		page.NextY = 0;
+	}
+}
+
+FVulkanTextureAtlas::~FVulkanTextureAtlas()
+{
+}
+
+float FVulkanTextureAtlas::GetOccupancy() const
+{
+	return static_cast<float>((double)m_UsedArea / ((double)m_PageWidth * m_PageHeight * m_Pages.size()));
+}
+
+bool FVulkanTextureAtlas::Allocate(uint32_t InWidth, uint32_t InHeight, FSlot & OutSlot)
+{
+	const uint32_t width = InWidth + 2 * m_Padding;
+	const uint32_t height = InHeight + 2 * m_Padding;
+	if (InWidth == 0 || InHeight == 0 || width > m_PageWidth || height > m_PageHeight) return false;
+
+	// Best fit: the shelf wasting the least height that still has a wide enough span
+	uint32_t bestPage = 0;
+	uint32_t bestShelf = UINT32_MAX;
+	uint32_t bestWaste = UINT32_MAX;
+	for (uint32_t p = 0; p < m_Pages.size(); p++)
+	{
+		const FPage& page = m_Pages[p];
+		for (uint32_t s = 0; s < page.Shelves.size(); s++)
+		{
+			const FShelf& shelf = page.Shelves[s];
+			if (shelf.Height < height || shelf.Height - height >= bestWaste) continue;
+
+			for (const FSpan& span : shelf.FreeSpans) {
+				if (span.Width >= width) {
+					bestPage = p;
+					bestShelf = s;
+					bestWaste = shelf.Height - height;
+					break;
+				}
+			}
+		}
+	}
+
+	// A shelf more than half empty in height is only taken when no new one fits
+	if (bestShelf == UINT32_MAX || bestWaste > height / 2)
+	{
+		for (uint32_t p = 0; p < m_Pages.size(); p++)
+		{
+			FPage& page = m_Pages[p];
+			if (page.NextY + height > m_PageHeight) continue;
+
+			FShelf shelf;
+			shelf.Y = page.NextY;
+			shelf.Height = height;
+			shelf.NumSlots = 0;
+			shelf.FreeSpans.push_back({ 0, m_PageWidth });
+			page.Shelves.push_back(shelf);
+			page.NextY += height;
+
+			bestPage = p;
+			bestShelf = static_cast<uint32_t>(page.Shelves.size() - 1);
+			break;
+		}
+	}
+	if (bestShelf == UINT32_MAX) return false;
+
+	FShelf& shelf = m_Pages[bestPage].Shelves[bestShelf];
+	uint32_t x;
+	TakeSpan(shelf, width, x);
+	shelf.NumSlots++;
+
+	OutSlot.Layer = bestPage;
+	OutSlot.Shelf = bestShelf;
+	OutSlot.Rect.offset = { static_cast<int32_t>(x + m_Padding), static_cast<int32_t>(shelf.Y + m_Padding) };
+	OutSlot.Rect.extent = { InWidth, InHeight };
+
+	m_NumSlots++;
+	m_UsedArea += (uint64_t)width * height;
+	return true;
+}
+
+void FVulkanTextureAtlas::Free(const FSlot & InSlot)
+{
+	FPage& page = m_Pages[InSlot.Layer];
+	FShelf& shelf = page.Shelves[InSlot.Shelf];
+
+	const uint32_t width = InSlot.Rect.extent.width + 2 * m_Padding;
+	const uint32_t height = InSlot.Rect.extent.height + 2 * m_Padding;
+	ReturnSpan(shelf, InSlot.Rect.offset.x - m_Padding, width);
+	shelf.NumSlots--;
+
+	m_NumSlots--;
+	m_UsedArea -= (uint64_t)width * height;
+
+	// Uploads still queued for the slot and its padding would overlap those of the next slot handed this area
+	DropPendingUploads(InSlot);
+
+	// Empty shelves at the top give their height back, so the page can be cut differently.
+	// Slots only refer to shelves below, their indices stay valid.
+	while (!page.Shelves.empty() && page.Shelves.back().NumSlots == 0) {
+		page.NextY = page.Shelves.back().Y;
+		page.Shelves.pop_back();
+	}
+}
+
+void FVulkanTextureAtlas::Upload(const FSlot & InSlot, const void * InSrcData, uint32_t InSrcPitch)
+{
+	// Only the newest pixels of a slot are copied, an earlier upload not flushed yet would overlap them
+	DropPendingUploads(InSlot);
+
+	FVulkanTextureArrayUpload upload;
+	upload.Layer = InSlot.Layer;
+	upload.Rect = InSlot.Rect;
+	upload.SrcData = InSrcData;
+	upload.SrcPitch = InSrcPitch;
+	m_PendingUploads.push_back(upload);
+
+	if (m_Padding == 0) return;
+
+	// The texel ring around the slot repeats its edge texels: the first and last row (a pitch of 0
+	// repeats a row), the first and last column and the four corners, one texel further out each
+	const uint8_t* srcData = static_cast<const uint8_t*>(InSrcData);
+	const int32_t x0 = InSlot.Rect.offset.x;
+	const int32_t y0 = InSlot.Rect.offset.y;
+	const int32_t x1 = x0 + static_cast<int32_t>(InSlot.Rect.extent.width);
+	const int32_t y1 = y0 + static_cast<int32_t>(InSlot.Rect.extent.height);
+	const uint32_t width = InSlot.Rect.extent.width;
+	const uint32_t height = InSlot.Rect.extent.height;
+	const uint8_t* lastRow = srcData + (size_t)(height - 1) * InSrcPitch;
+	const size_t lastColumn = (size_t)(width - 1) * m_BytesPerPixel;
+
+	const FVulkanTextureArrayUpload edges[] = {
+		{ InSlot.Layer, { { x0, y0 - 1 }, { width, 1 } }, srcData, 0 },
+		{ InSlot.Layer, { { x0, y1 }, { width, 1 } }, lastRow, 0 },
+		{ InSlot.Layer, { { x0 - 1, y0 }, { 1, height } }, srcData, InSrcPitch },
+		{ InSlot.Layer, { { x1, y0 }, { 1, height } }, srcData + lastColumn, InSrcPitch },
+		{ InSlot.Layer, { { x0 - 1, y0 - 1 }, { 1, 1 } }, srcData, 0 },
+		{ InSlot.Layer, { { x1, y0 - 1 }, { 1, 1 } }, srcData + lastColumn, 0 },
+		{ InSlot.Layer, { { x0 - 1, y1 }, { 1, 1 } }, lastRow, 0 },
+		{ InSlot.Layer, { { x1, y1 }, { 1, 1 } }, lastRow + lastColumn, 0 },
+	};
+	m_PendingUploads.insert(m_PendingUploads.end(), edges, edges + sizeof(edges) / sizeof(edges[0]));
+}
+
+void FVulkanTextureAtlas::DropPendingUploads(const FSlot & InSlot)
+{
+	// Slots never overlap, so everything queued inside the padded slot belongs to it
+	const int64_t x0 = (int64_t)InSlot.Rect.offset.x - m_Padding;
+	const int64_t y0 = (int64_t)InSlot.Rect.offset.y - m_Padding;
+	const int64_t x1 = (int64_t)InSlot.Rect.offset.x + InSlot.Rect.extent.width + m_Padding;
+	const int64_t y1 = (int64_t)InSlot.Rect.offset.y + InSlot.Rect.extent.height + m_Padding;
+	m_PendingUploads.erase(std::remove_if(m_PendingUploads.begin(), m_PendingUploads.end(), [&](const FVulkanTextureArrayUpload& InUpload) {
+		return InUpload.Layer == InSlot.Layer &&
+			InUpload.Rect.offset.x >= x0 && (int64_t)InUpload.Rect.offset.x + InUpload.Rect.extent.width <= x1 &&
+			InUpload.Rect.offset.y >= y0 && (int64_t)InUpload.Rect.offset.y + InUpload.Rect.extent.height <= y1;
+	}), m_PendingUploads.end());
+}
+
+void FVulkanTextureAtlas::Flush(FVulkanCommandBufferManager * InCmdBufferManager, FVulkanSubmitBatch * InBatch)
+{
+	if (m_PendingUploads.empty()) return;
+
+	m_Texture->UpdateRegions(m_PendingUploads.data(), static_cast<uint32_t>(m_PendingUploads.size()), InCmdBufferManager, InBatch);
+	m_PendingUploads.clear();
+}
+
+void FVulkanTextureAtlas::GetUVScaleBias(const FSlot & InSlot, float OutScaleBias[4]) const
+{
+	OutScaleBias[0] = static_cast<float>(InSlot.Rect.extent.width) / m_PageWidth;
+	OutScaleBias[1] = static_cast<float>(InSlot.Rect.extent.height) / m_PageHeight;
+	OutScaleBias[2] = static_cast<float>(InSlot.Rect.offset.x) / m_PageWidth;
+	OutScaleBias[3] = static_cast<float>(InSlot.Rect.offset.y) / m_PageHeight;
+}
+
+bool FVulkanTextureAtlas::TakeSpan(FShelf & InOutShelf, uint32_t InWidth, uint32_t & OutX)
+{
+	for (size_t i = 0; i < InOutShelf.FreeSpans.size(); i++)
+	{
+		FSpan& span = InOutShelf.FreeSpans[i];
+		if (span.Width < InWidth) continue;
+
+		OutX = span.X;
+		span.X += InWidth;
+		span.Width -= InWidth;
+		if (span.Width == 0) {
+			InOutShelf.FreeSpans.erase(InOutShelf.FreeSpans.begin() + i);
+		}
+		return true;
+	}
+	return false;
+}
+
+void FVulkanTextureAtlas::ReturnSpan(FShelf & InOutShelf, uint32_t InX, uint32_t InWidth)
+{
+	std::vector<FSpan>& spans = InOutShelf.FreeSpans;
+	size_t i = 0;
+	while (i < spans.size() && spans[i].X < InX) i++;
+	spans.insert(spans.begin() + i, FSpan{ InX, InWidth });
+
+	// Merge with the following span, then with the previous one
+	if (i + 1 < spans.size() && spans[i].X + spans[i].Width == spans[i + 1].X) {
+		spans[i].Width += spans[i + 1].Width;
+		spans.erase(spans.begin() + i + 1);
+	}
+	if (i > 0 && spans[i - 1].X + spans[i - 1].Width == spans[i].X) {
+		spans[i - 1].Width += spans[i].Width;
+		spans.erase(spans.begin() + i);
+	}
+}
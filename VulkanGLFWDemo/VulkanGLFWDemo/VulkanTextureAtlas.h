@@ -0,0 +1,91 @@
+#pragma once
+#include <memory>
+#include <vector>
+#include <vulkan/vulkan.h>
+#include "VulkanTexture.h"
+
+// Packs many small images (thumbnails, tiles, glyphs) into the layers of one FVulkanTexture2DArray,
+// so they are all drawn through a single descriptor. Every layer is a page of shelves: rows as tall as
+// the first image placed in them, filled left to right. Freed slots go back to their shelf and
+// can be taken by any image of up to the shelf's height, a page shrinks again once its top shelves are empty.
+class FVulkanTextureAtlas
+{
+public:
+	// Where an image lives, Rect is its own area without the padding around it
+	struct FSlot
+	{
+		uint32_t Layer = 0;
+		uint32_t Shelf = 0;
+		VkRect2D Rect = {};
+	};
+
+	// Every slot keeps InPadding texels to its neighbours. With padding the texels right around a slot
+	// repeat its edge texels, so linear filtering at the border doesn't pick up the neighbour.
+	FVulkanTextureAtlas(const FVulkanDevice* InDevice, uint32_t InPageWidth, uint32_t InPageHeight, uint32_t InPages, VkFormat InFormat, uint32_t InPadding = 1);
+	~FVulkanTextureAtlas();
+
+	inline FVulkanTexture2DArray* GetTexture() const
+	{
+		return m_Texture.get();
+	}
+	inline uint32_t GetNumSlots() const
+	{
+		return m_NumSlots;
+	}
+	// Share of the pages covered by slots, padding included
+	float GetOccupancy() const;
+
+	// Returns false when no page has room left, free (evict) some slots and try again
+	bool Allocate(uint32_t InWidth, uint32_t InHeight, FSlot& OutSlot);
+	// The area can be handed out again right away, uploads into it are ordered after earlier draws.
+	// Uploads of the slot not flushed yet are dropped.
+	void Free(const FSlot& InSlot);
+
+	// Queues the pixels of a slot, rows InSrcPitch bytes apart. InSrcData has to stay valid until Flush().
+	// Replaces an upload of the same slot that hasn't been flushed yet.
+	void Upload(const FSlot& InSlot, const void* InSrcData, uint32_t InSrcPitch);
+	// Uploads everything queued in one copy
+	void Flush(FVulkanCommandBufferManager* InCmdBufferManager, FVulkanSubmitBatch* InBatch = nullptr);
+
+	// Scale (xy) and bias (zw) taking the 0..1 coordinates of an image to the page, the layer is FSlot::Layer
+	void GetUVScaleBias(const FSlot& InSlot, float OutScaleBias[4]) const;
+
+private:
+	struct FSpan
+	{
+		uint32_t X;
+		uint32_t Width;
+	};
+
+	struct FShelf
+	{
+		uint32_t Y;
+		uint32_t Height;
+		uint32_t NumSlots;
+		// Sorted by X, neighbours merged
+		std::vector<FSpan> FreeSpans;
+	};
+
+	struct FPage
+	{
+		std::vector<FShelf> Shelves;
+		uint32_t NextY;
+	};
+
+	static bool TakeSpan(FShelf& InOutShelf, uint32_t InWidth, uint32_t& OutX);
+	void DropPendingUploads(const FSlot& InSlot);
+	static void ReturnSpan(FShelf& InOutShelf, uint32_t InX, uint32_t InWidth);
+
+private:
+	std::unique_ptr<FVulkanTexture2DArray> m_Texture;
+	uint32_t m_PageWidth;
+	uint32_t m_PageHeight;
+	uint32_t m_Padding;
+	uint32_t m_BytesPerPixel;
+
+	std::vector<FPage> m_Pages;
+	uint32_t m_NumSlots;
+	uint64_t m_UsedArea;
+
+	std::vector<FVulkanTextureArrayUpload> m_PendingUploads;
+};
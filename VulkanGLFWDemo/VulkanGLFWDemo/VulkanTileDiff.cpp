@@ -0,0 +1,103 @@
+#include "VulkanTileDiff.h"
+#include <algorithm>
+#include <cstdio>
+#include <stdexcept>
+#include "VulkanPixelConvert.h"
+
+FVulkanTileDiff::FVulkanTileDiff(uint32_t InWidth, uint32_t InHeight, uint32_t InBytesPerPixel, uint32_t InTileSize)
+	:m_Width(InWidth)
+	,m_Height(InHeight)
+	,m_BytesPerPixel(InBytesPerPixel)
+	,m_TileSize(InTileSize)
+	,m_bValid(false)
+{
+	if (InWidth == 0 || InHeight == 0 || InBytesPerPixel == 0 || InTileSize == 0) {
+		throw std::runtime_error("failed to create tile diff, invalid frame or tile size!");
+	}
+
+	m_TilesX = (InWidth + InTileSize - 1) / InTileSize;
+	m_TilesY = (InHeight + InTileSize - 1) / InTileSize;
+	m_Hashes.resize((size_t)m_TilesX * m_TilesY);
+}
+
+bool FVulkanTileDiff::Diff(const void * InSrcData, uint32_t InSrcPitch, std::vector<VkRect2D>& OutRects)
+{
+	OutRects.clear();
+
+	const uint8_t* srcData = static_cast<const uint8_t*>(InSrcData);
+	uint64_t changedBytes = 0;
+	uint32_t unchangedTiles = 0;
+
+	for (uint32_t ty = 0; ty < m_TilesY; ty++)
+	{
+		const uint32_t y = ty * m_TileSize;
+		const uint32_t height = std::min(m_TileSize, m_Height - y);
+
+		// Start of the run of changed tiles in this row, m_TilesX while there is none
+		uint32_t runStart = m_TilesX;
+		for (uint32_t tx = 0; tx <= m_TilesX; tx++)
+		{
+			bool bChanged = false;
+			if (tx < m_TilesX) {
+				const uint32_t x = tx * m_TileSize;
+				const uint32_t width = std::min(m_TileSize, m_Width - x);
+				const uint64_t hash = FVulkanPixelConvert::HashRect(srcData + (size_t)y * InSrcPitch + (size_t)x * m_BytesPerPixel, InSrcPitch, width * m_BytesPerPixel, height);
+
+				uint64_t& previous = m_Hashes[(size_t)ty * m_TilesX + tx];
+				bChanged = !m_bValid || hash != previous;
+				previous = hash;
+
+				if (bChanged) {
+					changedBytes += (uint64_t)width * height * m_BytesPerPixel;
+				}
+				else {
+					unchangedTiles++;
+				}
+			}
+
+			if (bChanged && runStart == m_TilesX) {
+				runStart = tx;
+			}
+			else if (!bChanged && runStart != m_TilesX) {
+				VkRect2D rect;
+				rect.offset = { static_cast<int32_t>(runStart * m_TileSize), static_cast<int32_t>(y) };
+				rect.extent = { std::min(tx * m_TileSize, m_Width) - runStart * m_TileSize, height };
+				OutRects.push_back(rect);
+				runStart = m_TilesX;
+			}
+		}
+	}
+	m_bValid = true;
+
+	m_Stats.Frames++;
+	m_Stats.Tiles += m_Hashes.size();
+	m_Stats.UnchangedTiles += unchangedTiles;
+	m_Stats.FrameBytes += (uint64_t)m_Width * m_Height * m_BytesPerPixel;
+	m_Stats.ChangedBytes += changedBytes;
+	if (OutRects.empty()) {
+		m_Stats.IdenticalFrames++;
+	}
+
+	return !OutRects.empty();
+}
+
+void FVulkanTileDiff::Reset()
+{
+	m_bValid = false;
+}
+
+void FVulkanTileDiff::ResetStats()
+{
+	m_Stats = FStats();
+}
+
+void FVulkanTileDiff::PrintStats(const char * InName) const
+{
+	if (m_Stats.Frames == 0) return;
+
+	const double tileHitRate = 100.0 * m_Stats.UnchangedTiles / m_Stats.Tiles;
+	const double savedMB = (m_Stats.FrameBytes - m_Stats.ChangedBytes) / (1024.0 * 1024.0);
+	const double savedRate = 100.0 * (m_Stats.FrameBytes - m_Stats.ChangedBytes) / m_Stats.FrameBytes;
+	printf("%s: %llu frames, %llu identical, tile hit rate %.1f%%, %.1f MB (%.1f%%) of uploads saved\n", InName,
+		(unsigned long long)m_Stats.Frames, (unsigned long long)m_Stats.IdenticalFrames, tileHitRate, savedMB, savedRate);
+}
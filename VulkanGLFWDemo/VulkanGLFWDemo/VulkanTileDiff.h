@@ -0,0 +1,57 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <vulkan/vulkan.h>
+
+// Finds the parts of a streamed frame that changed since the previous one. The frame is cut into
+// square tiles whose hashes (FVulkanPixelConvert::HashRect) are kept from frame to frame, changed tiles
+// next to each other in a tile row are merged into one rectangle for FVulkanTexture2D::UpdateRegions.
+// Only hashes are kept, not the previous frame. A 64 bit hash collision would keep a stale tile, which is
+// unlikely enough to ignore for video, not for data where every texel matters.
+class FVulkanTileDiff
+{
+public:
+	FVulkanTileDiff(uint32_t InWidth, uint32_t InHeight, uint32_t InBytesPerPixel, uint32_t InTileSize = 64);
+
+	struct FStats
+	{
+		uint64_t Frames = 0;
+		uint64_t IdenticalFrames = 0;
+		uint64_t Tiles = 0;
+		uint64_t UnchangedTiles = 0;
+		uint64_t FrameBytes = 0;
+		uint64_t ChangedBytes = 0;
+	};
+
+	inline uint32_t GetTileSize() const
+	{
+		return m_TileSize;
+	}
+	inline const FStats& GetStats() const
+	{
+		return m_Stats;
+	}
+
+	// Hashes a frame of rows InSrcPitch bytes apart and fills OutRects with what changed since the last call.
+	// Returns false when nothing did. The first frame, and the first after Reset(), changes everywhere.
+	bool Diff(const void* InSrcData, uint32_t InSrcPitch, std::vector<VkRect2D>& OutRects);
+
+	// Forgets the previous frame, e.g. when the texture was written some other way
+	void Reset();
+	void ResetStats();
+	// Hit rate and upload bytes saved so far
+	void PrintStats(const char* InName) const;
+
+private:
+	uint32_t m_Width;
+	uint32_t m_Height;
+	uint32_t m_BytesPerPixel;
+	uint32_t m_TileSize;
+	uint32_t m_TilesX;
+	uint32_t m_TilesY;
+
+	bool m_bValid;
+	std::vector<uint64_t> m_Hashes;
+
+	FStats m_Stats;
+};
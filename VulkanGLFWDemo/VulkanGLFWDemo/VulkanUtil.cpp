@@ -73,43 +73,81 @@ FVulkanUtil::QueueFamilyIndices FVulkanUtil::FindQueueFamilies(const VkPhysicalD
 	std::vector<VkQueueFamilyProperties> queueFamilies(queueFamilyCount);
 	vkGetPhysicalDeviceQueueFamilyProperties(InDevice, &queueFamilyCount, queueFamilies.data());
 
+	QueueFamilyIndices indices;
+
+	// Without a surface (headless) "present" happens on the graphics family
 	// look for an family index that supports both graphics and present
 	for (size_t i = 0; i < queueFamilyCount; i++) {
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(InDevice, i, InSurface, &presentSupport);
+		VkBool32 presentSupport = InSurface == VK_NULL_HANDLE;
+		if (InSurface != VK_NULL_HANDLE) {
+			vkGetPhysicalDeviceSurfaceSupportKHR(InDevice, i, InSurface, &presentSupport);
+		}
 
 		if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT && presentSupport) {
 			/*m_GraphicsFamilyIndex = static_cast<uint32_t>(i);
 			m_PresentFamilyIndex = static_cast<uint32_t>(i);*/
-			return QueueFamilyIndices(i, i);
+			indices.GraphicsIndex = i;
+			indices.PresentIndex = i;
+			break;
 		}
 	}
 
-	QueueFamilyIndices indices;
-
 	// there's nothing like a single family index that supports both graphics and present -> look for an other family index that supports present
+	if (indices.GraphicsIndex < 0) {
+		for (size_t i = 0; i < queueFamilyCount; i++) {
+			VkBool32 presentSupport = false;
+			if (InSurface != VK_NULL_HANDLE) {
+				vkGetPhysicalDeviceSurfaceSupportKHR(InDevice, i, InSurface, &presentSupport);
+			}
+
+			if (queueFamilies[i].queueCount > 0 && presentSupport) {
+				indices.PresentIndex = i;
+			}
+
+
+			if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
+				indices.GraphicsIndex = i;
+			}
+
+			if (indices.PresentIndex >= 0 && indices.GraphicsIndex >= 0) {
+				/*m_GraphicsFamilyIndex = static_cast<uint32_t>(t_g_index);
+				m_PresentFamilyIndex = static_cast<uint32_t>(t_p_index);*/
+				break;
+			}
+		}
 
-	for (size_t i = 0; i < queueFamilyCount; i++) {
-		VkBool32 presentSupport = false;
-		vkGetPhysicalDeviceSurfaceSupportKHR(InDevice, i, InSurface, &presentSupport);
-
-		if (queueFamilies[i].queueCount > 0 && presentSupport) {
-			indices.PresentIndex = i;
+		if (indices.PresentIndex < 0 || indices.GraphicsIndex < 0) {
+			return QueueFamilyIndices();
 		}
+	}
 
+	// Transfer queue: prefer a transfer only family (the copy engines), then any family without graphics.
+	// Stays -1 when there is none, uploads then go through the graphics queue.
+	indices.TransferIndex = FindDedicatedQueueFamily(queueFamilies, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT | VK_QUEUE_COMPUTE_BIT);
+	if (indices.TransferIndex < 0) {
+		indices.TransferIndex = FindDedicatedQueueFamily(queueFamilies, VK_QUEUE_TRANSFER_BIT, VK_QUEUE_GRAPHICS_BIT);
+	}
 
-		if (queueFamilies[i].queueCount > 0 && queueFamilies[i].queueFlags & VK_QUEUE_GRAPHICS_BIT) {
-			indices.GraphicsIndex = i;
-		}
+	// Compute queue: a family without graphics runs async next to the graphics queue,
+	// otherwise compute shares the graphics family
+	indices.ComputeIndex = FindDedicatedQueueFamily(queueFamilies, VK_QUEUE_COMPUTE_BIT, VK_QUEUE_GRAPHICS_BIT);
+	if (indices.ComputeIndex < 0 && (queueFamilies[indices.GraphicsIndex].queueFlags & VK_QUEUE_COMPUTE_BIT)) {
+		indices.ComputeIndex = indices.GraphicsIndex;
+	}
+
+	return indices;
+}
 
-		if (indices.PresentIndex >= 0 && indices.GraphicsIndex >= 0) {
-			/*m_GraphicsFamilyIndex = static_cast<uint32_t>(t_g_index);
-			m_PresentFamilyIndex = static_cast<uint32_t>(t_p_index);*/
-			return indices;
+int FVulkanUtil::FindDedicatedQueueFamily(const std::vector<VkQueueFamilyProperties>& InQueueFamilies, VkQueueFlags InRequiredFlags, VkQueueFlags InExcludedFlags)
+{
+	for (size_t i = 0; i < InQueueFamilies.size(); i++) {
+		if (InQueueFamilies[i].queueCount > 0 &&
+			(InQueueFamilies[i].queueFlags & InRequiredFlags) == InRequiredFlags &&
+			(InQueueFamilies[i].queueFlags & InExcludedFlags) == 0) {
+			return static_cast<int>(i);
 		}
 	}
-
-	return QueueFamilyIndices();
+	return -1;
 }
 
 FVulkanUtil::SwapChainSupportDetails FVulkanUtil::QuerySwapChainSupport(const VkPhysicalDevice & InDevice, const VkSurfaceKHR& InSurface)
@@ -165,9 +203,11 @@ bool FVulkanUtil::CheckDeviceSuitable(const VkPhysicalDevice & InDevice, const V
 	if (!CheckDeviceExtensionSupport(InDevice, InDeviceExtensions))
 		return false;
 
-	SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(InDevice, InSurface);
-	if (swapChainSupport.Formats.empty() && swapChainSupport.PresentModes.empty())
-		return false;
+	if (InSurface != VK_NULL_HANDLE) {
+		SwapChainSupportDetails swapChainSupport = QuerySwapChainSupport(InDevice, InSurface);
+		if (swapChainSupport.Formats.empty() && swapChainSupport.PresentModes.empty())
+			return false;
+	}
 
 	VkPhysicalDeviceFeatures supportedFeatures;
 	vkGetPhysicalDeviceFeatures(InDevice, &supportedFeatures);
@@ -194,9 +234,11 @@ void FVulkanUtil::GetInstanceExtensions(std::vector<const char*>& OutExtensions)
 #endif
 }
 
-void FVulkanUtil::GetDeviceExtensions(std::vector<const char*>& OutExtensions)
+void FVulkanUtil::GetDeviceExtensions(std::vector<const char*>& OutExtensions, bool bInPresent)
 {
-	OutExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	if (bInPresent) {
+		OutExtensions.push_back(VK_KHR_SWAPCHAIN_EXTENSION_NAME);
+	}
 }
 
 uint32_t FVulkanUtil::FindMemoryType(const VkPhysicalDevice & InDevice, uint32_t InTypeFilter, VkMemoryPropertyFlags InProperties)
@@ -41,12 +41,13 @@ public:
 	static VkResult QueryLayerProperties(std::vector<LayerProperties>& OutPropertiesArray);
 
 	static QueueFamilyIndices FindQueueFamilies(const VkPhysicalDevice& InDevice, const VkSurfaceKHR& InSurface);
+	static int FindDedicatedQueueFamily(const std::vector<VkQueueFamilyProperties>& InQueueFamilies, VkQueueFlags InRequiredFlags, VkQueueFlags InExcludedFlags);
 	static SwapChainSupportDetails QuerySwapChainSupport(const VkPhysicalDevice& InDevice, const VkSurfaceKHR& InSurface);
 	static bool CheckDeviceExtensionSupport(const VkPhysicalDevice& InDevice, const std::vector<const char*>& InDeviceExtensions);
 	static bool CheckDeviceSuitable(const VkPhysicalDevice& InDevice, const VkSurfaceKHR& InSurface, const std::vector<const char*>& InDeviceExtensions);
 
 	static void GetInstanceExtensions(std::vector<const char*>& OutExtensions);
-	static void GetDeviceExtensions(std::vector<const char*>& OutExtensions);
+	static void GetDeviceExtensions(std::vector<const char*>& OutExtensions, bool bInPresent = true);
 
 
 	struct Vertex {
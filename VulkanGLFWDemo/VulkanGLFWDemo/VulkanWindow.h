@@ -9,4 +9,10 @@ public:
 
 	virtual bool GetWindowSize(uint32_t& OutWidth, uint32_t& OutHeight) const = 0;
 	virtual VkResult CreateVulkanSurface(const VkInstance& InInstance, VkSurfaceKHR& OutSurface) const = 0;
+
+	// Headless windows create no surface and need no surface or swap chain extensions
+	virtual bool IsHeadless() const
+	{
+		return false;
+	}
 };
@@ -0,0 +1,25 @@
+#include "VulkanWindowHeadless.h"
+
+
+void FVulkanWindowHeadless::SetWindowSize(uint32_t InWidth, uint32_t InHeight)
+{
+	m_Width = InWidth;
+	m_Height = InHeight;
+}
+
+bool FVulkanWindowHeadless::GetWindowSize(uint32_t & OutWidth, uint32_t & OutHeight) const
+{
+	if (m_Width > 0 && m_Height > 0) {
+		OutWidth = m_Width;
+		OutHeight = m_Height;
+		return true;
+	}
+	return false;
+}
+
+VkResult FVulkanWindowHeadless::CreateVulkanSurface(const VkInstance & /*InInstance*/, VkSurfaceKHR & OutSurface) const
+{
+	// Nothing to present to, FVulkanSwapChain sees the null surface and renders offscreen
+	OutSurface = VK_NULL_HANDLE;
+	return VK_SUCCESS;
+}
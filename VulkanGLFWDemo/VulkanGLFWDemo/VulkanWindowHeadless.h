@@ -0,0 +1,28 @@
+#pragma once
+#include "VulkanWindow.h"
+
+
+// Window without a display. There is no surface, FVulkanSwapChain renders into an offscreen
+// image ring instead and can read every presented image back to the host.
+class FVulkanWindowHeadless : public FVulkanWindow
+{
+public:
+	FVulkanWindowHeadless(uint32_t InWidth = 1920, uint32_t InHeight = 1080)
+		:m_Width(InWidth), m_Height(InHeight)
+	{};
+	~FVulkanWindowHeadless() {};
+
+	// Acts like a window resize, the swap chain picks the size up when it is recreated
+	void SetWindowSize(uint32_t InWidth, uint32_t InHeight);
+
+	bool GetWindowSize(uint32_t& OutWidth, uint32_t& OutHeight) const;
+	VkResult CreateVulkanSurface(const VkInstance& InInstance, VkSurfaceKHR& OutSurface) const;
+
+	bool IsHeadless() const
+	{
+		return true;
+	}
+
+private:
+	uint32_t m_Width, m_Height;
+};
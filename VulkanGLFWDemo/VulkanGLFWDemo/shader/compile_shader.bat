@@ -1,3 +1,4 @@
 glslangValidator.exe -V shader.vert -o shader_vert.spv
 glslangValidator.exe -V shader.frag -o shader_frag.spv
+glslangValidator.exe -V mipgen.comp -o mipgen_comp.spv
 pause
\ No newline at end of file